@@ -0,0 +1,731 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <thread>
+#include "ac_solver.h"
+#include "calc.h"
+#include "si_value.h"
+
+const int AC_CHUNK_POINTS = 64;            // frequency points per work item
+const int AC_PIVOT_CANDIDATE_COLUMNS = 4;  // sparsest columns searched for each Markowitz pivot
+const double AC_PIVOT_THRESHOLD = 0.1;     // planned pivot must be this fraction of its column's largest entry
+const double AC_PIVOT_TOLERANCE = 1e-13;   // replayed pivots smaller than this times the largest stamp fall back
+const int AC_DENSE_MAX_UNKNOWNS = 2000;    // no dense fallback above this
+
+typedef std::complex<double> Complex;
+
+// Written out so the inner loops don't call the library's NaN-safe complex helpers
+static inline Complex multiply(Complex a, Complex b) {
+    return Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+static inline Complex reciprocal(Complex a) {
+    double norm = a.real() * a.real() + a.imag() * a.imag();
+    return Complex(a.real() / norm, -a.imag() / norm);
+}
+
+static inline double magnitude(Complex a) {
+    return std::abs(a.real()) + std::abs(a.imag()); // cheap stand-in for |a|, within a factor of sqrt(2)
+}
+
+int ac_node(const AcCircuit& circuit, const std::string& name) {
+    if (name == "0" || name == "gnd" || name == "GND") {
+        return 0;
+    }
+    auto it = circuit.node_index.find(name);
+    return it == circuit.node_index.end() ? -1 : it->second;
+}
+
+// Function to look up a node by name, adding it if new
+static int add_node(AcCircuit& circuit, const std::string& name) {
+    int node = ac_node(circuit, name);
+    if (node >= 0) {
+        return node;
+    }
+    node = circuit.num_nodes++;
+    circuit.node_index[name] = node;
+    circuit.node_names.push_back(name);
+    return node;
+}
+
+bool parse_ac_netlist(std::istream& in, AcCircuit& circuit, std::string& error) {
+    circuit = AcCircuit();
+    circuit.node_names.push_back("0");
+    std::vector<std::string> control_names; // per element, resolved once every source is known
+    std::vector<int> control_lines;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(in, line)) {
+        line_number++;
+        std::istringstream stream(line);
+        std::vector<std::string> tokens;
+        std::string token;
+        while (stream >> token) {
+            tokens.push_back(token);
+        }
+        if (tokens.empty() || tokens[0][0] == '*' || tokens[0][0] == '#' || tokens[0] == ".end") {
+            continue;
+        }
+        std::string where = "line " + std::to_string(line_number) + ": ";
+        AcElement element = { AC_RESISTOR, { 0, 0, 0, 0 }, 0, 0, -1, tokens[0] };
+        int num_nodes = 2;
+        const char* usage = "expected <name> <node> <node> <value>";
+        switch (tokens[0][0]) {
+        case 'R': case 'r': element.kind = AC_RESISTOR; break;
+        case 'C': case 'c': element.kind = AC_CAPACITOR; break;
+        case 'L': case 'l': element.kind = AC_INDUCTOR; break;
+        case 'V': case 'v':
+            element.kind = AC_VOLTAGE_SOURCE;
+            usage = "expected <name> <node> <node> [AC] <magnitude> [phase]";
+            break;
+        case 'I': case 'i':
+            element.kind = AC_CURRENT_SOURCE;
+            usage = "expected <name> <node> <node> [AC] <magnitude> [phase]";
+            break;
+        case 'E': case 'e':
+            element.kind = AC_VCVS;
+            num_nodes = 4;
+            usage = "expected <name> <node> <node> <control node> <control node> <gain>";
+            break;
+        case 'G': case 'g':
+            element.kind = AC_VCCS;
+            num_nodes = 4;
+            usage = "expected <name> <node> <node> <control node> <control node> <transconductance>";
+            break;
+        case 'F': case 'f':
+            element.kind = AC_CCCS;
+            usage = "expected <name> <node> <node> <voltage source> <gain>";
+            break;
+        case 'H': case 'h':
+            element.kind = AC_CCVS;
+            usage = "expected <name> <node> <node> <voltage source> <transresistance>";
+            break;
+        case 'O': case 'o':
+            element.kind = AC_OPAMP;
+            num_nodes = 3;
+            usage = "expected <name> <out> <in+> <in-> [open-loop gain [gain-bandwidth]]";
+            break;
+        default:
+            error = where + "unknown element " + tokens[0];
+            return false;
+        }
+
+        size_t next = 1 + num_nodes;
+        bool controlled_by_current = element.kind == AC_CCCS || element.kind == AC_CCVS;
+        std::string control = controlled_by_current && tokens.size() > next ? tokens[next++] : "";
+        if ((element.kind == AC_VOLTAGE_SOURCE || element.kind == AC_CURRENT_SOURCE) && tokens.size() > next &&
+            (tokens[next] == "AC" || tokens[next] == "ac")) {
+            next++;
+        }
+        size_t max_values = element.kind == AC_VOLTAGE_SOURCE || element.kind == AC_CURRENT_SOURCE ||
+                            element.kind == AC_OPAMP ? 2 : 1;
+        size_t min_values = element.kind == AC_OPAMP ? 0 : 1;
+        double values[2] = { 0, 0 };
+        bool ok = tokens.size() >= next + min_values && tokens.size() <= next + max_values;
+        for (size_t i = next; ok && i < tokens.size(); i++) {
+            ok = parse_value(tokens[i], values[i - next]);
+        }
+        if (!ok) {
+            error = where + usage;
+            return false;
+        }
+        element.value = values[0];
+        element.value2 = values[1];
+        for (int i = 0; i < num_nodes; i++) {
+            element.nodes[i] = add_node(circuit, tokens[1 + i]);
+        }
+
+        if (element.kind == AC_RESISTOR && element.value == 0) {
+            error = where + "zero resistance, use a 0 V source for a short";
+            return false;
+        }
+        if (element.kind == AC_OPAMP && (element.nodes[0] == 0 || element.value < 0 || element.value2 < 0)) {
+            error = where + (element.nodes[0] == 0 ? "op-amp output can't be ground"
+                                                   : "open-loop gain and gain-bandwidth can't be negative");
+            return false;
+        }
+        circuit.elements.push_back(element);
+        control_names.push_back(control);
+        control_lines.push_back(line_number);
+    }
+
+    for (size_t i = 0; i < circuit.elements.size(); i++) {
+        if (control_names[i].empty()) {
+            continue;
+        }
+        for (size_t j = 0; j < circuit.elements.size(); j++) {
+            if (circuit.elements[j].kind == AC_VOLTAGE_SOURCE && circuit.elements[j].name == control_names[i]) {
+                circuit.elements[i].control = static_cast<int>(j);
+                break;
+            }
+        }
+        if (circuit.elements[i].control < 0) {
+            error = "line " + std::to_string(control_lines[i]) + ": no voltage source named " + control_names[i];
+            return false;
+        }
+    }
+    return true;
+}
+
+// One contribution g + s*c to the matrix entry at (row, column)
+struct AcStamp {
+    int row;
+    int column;
+    double g;
+    double c;
+};
+
+// Function to give every element with a current unknown its index, after the node voltages
+static int assign_branches(const AcCircuit& circuit, std::vector<int>& branch) {
+    int unknowns = circuit.num_nodes - 1;
+    branch.assign(circuit.elements.size(), -1);
+    for (size_t i = 0; i < circuit.elements.size(); i++) {
+        AcElementKind kind = circuit.elements[i].kind;
+        if (kind == AC_INDUCTOR || kind == AC_VOLTAGE_SOURCE || kind == AC_VCVS || kind == AC_CCVS || kind == AC_OPAMP) {
+            branch[i] = unknowns++;
+        }
+    }
+    return unknowns;
+}
+
+// Function to stamp every element. The stamps depend only on the topology, never on element
+// values (a zero value still stamps its entry), so a restamp lines up with the first build.
+static void stamp_circuit(const AcCircuit& circuit, const std::vector<int>& branch,
+                          std::vector<AcStamp>& stamps, std::vector<Complex>& rhs) {
+    stamps.clear();
+    // Node n is unknown n - 1; ground rows and columns are dropped
+    auto add = [&stamps](int row, int column, double g, double c) {
+        if (row >= 0 && column >= 0) {
+            stamps.push_back({ row, column, g, c });
+        }
+    };
+    auto admittance = [&add](int a, int b, double g, double c) {
+        add(a - 1, a - 1, g, c);
+        add(b - 1, b - 1, g, c);
+        add(a - 1, b - 1, -g, -c);
+        add(b - 1, a - 1, -g, -c);
+    };
+    // Branch current k leaves node a and enters node b through the element
+    auto branch_current = [&add](int a, int b, int k) {
+        add(a - 1, k, 1, 0);
+        add(b - 1, k, -1, 0);
+    };
+    // Branch equation V(a) - V(b) = ...
+    auto branch_voltage = [&add](int k, int a, int b) {
+        add(k, a - 1, 1, 0);
+        add(k, b - 1, -1, 0);
+    };
+
+    for (size_t i = 0; i < circuit.elements.size(); i++) {
+        const AcElement& element = circuit.elements[i];
+        int a = element.nodes[0], b = element.nodes[1], c = element.nodes[2], d = element.nodes[3];
+        int k = branch[i];
+        switch (element.kind) {
+        case AC_RESISTOR:
+            admittance(a, b, 1 / element.value, 0);
+            break;
+        case AC_CAPACITOR:
+            admittance(a, b, 0, element.value);
+            break;
+        case AC_INDUCTOR:
+            branch_current(a, b, k);
+            branch_voltage(k, a, b);
+            add(k, k, 0, -element.value);
+            break;
+        case AC_VOLTAGE_SOURCE:
+            branch_current(a, b, k);
+            branch_voltage(k, a, b);
+            rhs[k] += std::polar(element.value, element.value2 * PI / 180);
+            break;
+        case AC_CURRENT_SOURCE: {
+            Complex current = std::polar(element.value, element.value2 * PI / 180);
+            if (a > 0) rhs[a - 1] -= current;
+            if (b > 0) rhs[b - 1] += current;
+            break;
+        }
+        case AC_VCVS:
+            branch_current(a, b, k);
+            branch_voltage(k, a, b);
+            add(k, c - 1, -element.value, 0);
+            add(k, d - 1, element.value, 0);
+            break;
+        case AC_VCCS:
+            add(a - 1, c - 1, element.value, 0);
+            add(a - 1, d - 1, -element.value, 0);
+            add(b - 1, c - 1, -element.value, 0);
+            add(b - 1, d - 1, element.value, 0);
+            break;
+        case AC_CCCS:
+            add(a - 1, branch[element.control], element.value, 0);
+            add(b - 1, branch[element.control], -element.value, 0);
+            break;
+        case AC_CCVS:
+            branch_current(a, b, k);
+            branch_voltage(k, a, b);
+            add(k, branch[element.control], -element.value, 0);
+            break;
+        case AC_OPAMP: {
+            // V(in+) - V(in-) = (1 / A0 + s / (2 pi GBW)) V(out), the single-pole model
+            // A(s) = A0 / (1 + s A0 / (2 pi GBW)); the output current k flows into out
+            add(a - 1, k, -1, 0);
+            branch_voltage(k, b, c);
+            add(k, a - 1, element.value > 0 ? -1 / element.value : 0,
+                element.value2 > 0 ? -1 / (2 * PI * element.value2) : 0);
+            break;
+        }
+        }
+    }
+
+    // One slot per position, in row-major order
+    std::sort(stamps.begin(), stamps.end(), [](const AcStamp& x, const AcStamp& y) {
+        return x.row != y.row ? x.row < y.row : x.column < y.column;
+    });
+    size_t merged = 0;
+    for (size_t i = 0; i < stamps.size(); i++) {
+        if (merged > 0 && stamps[merged - 1].row == stamps[i].row && stamps[merged - 1].column == stamps[i].column) {
+            stamps[merged - 1].g += stamps[i].g;
+            stamps[merged - 1].c += stamps[i].c;
+        }
+        else {
+            stamps[merged++] = stamps[i];
+        }
+    }
+    stamps.resize(merged);
+}
+
+// Active part of one row during the symbolic factorisation, sorted by column
+struct PlanEntry {
+    int column;
+    Complex value;
+};
+
+// Function to find the value at (row, column), nullptr if the position is empty
+static PlanEntry* find_entry(std::vector<PlanEntry>& row, int column) {
+    auto it = std::lower_bound(row.begin(), row.end(), column,
+                               [](const PlanEntry& entry, int c) { return entry.column < c; });
+    return it != row.end() && it->column == column ? &*it : nullptr;
+}
+
+// Function to eliminate at the reference frequency with threshold Markowitz pivoting,
+// recording the pivot order and every L and U position including fill
+static bool plan_factorisation(const std::vector<AcStamp>& stamps, double reference_hz, AcSystem& system,
+                               std::string& error) {
+    int n = system.unknowns;
+    Complex s(0, 2 * PI * reference_hz);
+    std::vector<std::vector<PlanEntry>> rows(n);
+    std::vector<std::vector<int>> column_rows(n); // rows with an entry in each column; may hold finished rows
+    std::vector<int> column_count(n, 0);          // active rows in each column
+    std::set<std::pair<int, int>> by_count;       // (count, column) of the active columns
+    auto change_count = [&column_count, &by_count](int column, int change) {
+        by_count.erase({ column_count[column], column });
+        column_count[column] += change;
+        by_count.insert({ column_count[column], column });
+    };
+    for (const AcStamp& stamp : stamps) {
+        rows[stamp.row].push_back({ stamp.column, stamp.g + s * stamp.c });
+        column_rows[stamp.column].push_back(stamp.row);
+        column_count[stamp.column]++;
+    }
+    for (int j = 0; j < n; j++) {
+        by_count.insert({ column_count[j], j });
+    }
+
+    std::vector<int> row_step(n, -1), column_step(n, -1);
+    std::vector<std::vector<int>> step_l_rows(n), step_u_columns(n);
+    std::vector<PlanEntry> merged;
+    system.row_order.assign(n, -1);
+    system.column_order.assign(n, -1);
+    for (int k = 0; k < n; k++) {
+        // Few sparsest columns still active
+        int candidates[AC_PIVOT_CANDIDATE_COLUMNS];
+        int num_candidates = 0;
+        for (auto it = by_count.begin(); it != by_count.end() && num_candidates < AC_PIVOT_CANDIDATE_COLUMNS; ++it) {
+            candidates[num_candidates++] = it->second;
+        }
+
+        // Cheapest (row count - 1) * (column count - 1) among entries that pass the threshold
+        int pivot_row = -1, pivot_column = -1;
+        long long best_cost = std::numeric_limits<long long>::max();
+        double best_size = 0;
+        auto search_column = [&](int j) {
+            std::vector<int>& in_column = column_rows[j];
+            in_column.erase(std::remove_if(in_column.begin(), in_column.end(),
+                                           [&row_step](int r) { return row_step[r] >= 0; }), in_column.end());
+            double largest = 0;
+            for (int r : in_column) {
+                largest = std::max(largest, magnitude(find_entry(rows[r], j)->value));
+            }
+            for (int r : in_column) {
+                double size = magnitude(find_entry(rows[r], j)->value);
+                long long cost = static_cast<long long>(rows[r].size() - 1) * (in_column.size() - 1);
+                if (size > 0 && size >= AC_PIVOT_THRESHOLD * largest &&
+                    (cost < best_cost || (cost == best_cost && size > best_size))) {
+                    pivot_row = r;
+                    pivot_column = j;
+                    best_cost = cost;
+                    best_size = size;
+                }
+            }
+        };
+        for (int m = 0; m < num_candidates; m++) {
+            search_column(candidates[m]);
+        }
+        // The sparsest columns can all be zero at the reference frequency; then try the rest
+        for (int j = 0; pivot_row < 0 && j < n; j++) {
+            if (column_step[j] < 0) {
+                search_column(j);
+            }
+        }
+        if (pivot_row < 0) {
+            error = "circuit is singular at the reference frequency (floating node or loop of sources?)";
+            return false;
+        }
+
+        system.row_order[k] = pivot_row;
+        system.column_order[k] = pivot_column;
+        row_step[pivot_row] = k;
+        column_step[pivot_column] = k;
+        std::vector<PlanEntry>& pivot_entries = rows[pivot_row];
+        Complex pivot = find_entry(pivot_entries, pivot_column)->value;
+        for (const PlanEntry& entry : pivot_entries) {
+            if (entry.column != pivot_column) {
+                step_u_columns[k].push_back(entry.column);
+                change_count(entry.column, -1);
+            }
+        }
+
+        // Row r -= (a_rj / pivot) * pivot row, merging the sorted patterns
+        for (int r : column_rows[pivot_column]) {
+            if (r == pivot_row) {
+                continue;
+            }
+            step_l_rows[k].push_back(r);
+            std::vector<PlanEntry>& target = rows[r];
+            Complex factor = find_entry(target, pivot_column)->value / pivot;
+            merged.clear();
+            size_t x = 0, y = 0;
+            while (x < target.size() || y < pivot_entries.size()) {
+                int tc = x < target.size() ? target[x].column : n;
+                int pc = y < pivot_entries.size() ? pivot_entries[y].column : n;
+                if (tc == pivot_column) {
+                    x++;
+                    if (pc == pivot_column) {
+                        y++;
+                    }
+                }
+                else if (pc == pivot_column) {
+                    y++;
+                }
+                else if (tc == pc) {
+                    merged.push_back({ tc, target[x++].value - factor * pivot_entries[y++].value });
+                }
+                else if (tc < pc) {
+                    merged.push_back(target[x++]);
+                }
+                else {
+                    // Fill
+                    merged.push_back({ pc, -factor * pivot_entries[y++].value });
+                    column_rows[pc].push_back(r);
+                    change_count(pc, 1);
+                }
+            }
+            target.swap(merged);
+        }
+        by_count.erase({ column_count[pivot_column], pivot_column });
+        pivot_entries.clear();
+        std::vector<PlanEntry>().swap(pivot_entries);
+    }
+
+    // Entries are numbered step by step: pivot, L entries, U entries. Each step's rows and
+    // columns are sorted, so an entry is found by binary search in the step that owns it.
+    system.pivot.assign(n, 0);
+    system.l_start.assign(n + 1, 0);
+    system.u_start.assign(n + 1, 0);
+    system.l_rows.clear();
+    system.l_entries.clear();
+    system.u_columns.clear();
+    system.u_entries.clear();
+    int entry = 0;
+    for (int k = 0; k < n; k++) {
+        std::sort(step_l_rows[k].begin(), step_l_rows[k].end());
+        std::sort(step_u_columns[k].begin(), step_u_columns[k].end());
+        system.pivot[k] = entry++;
+        system.l_start[k] = static_cast<int>(system.l_rows.size());
+        for (int r : step_l_rows[k]) {
+            system.l_rows.push_back(r);
+            system.l_entries.push_back(entry++);
+        }
+        system.u_start[k] = static_cast<int>(system.u_columns.size());
+        for (int c : step_u_columns[k]) {
+            system.u_columns.push_back(c);
+            system.u_entries.push_back(entry++);
+        }
+    }
+    system.l_start[n] = static_cast<int>(system.l_rows.size());
+    system.u_start[n] = static_cast<int>(system.u_columns.size());
+    system.num_entries = entry;
+
+    auto entry_at = [&system, &row_step, &column_step](int row, int column) {
+        int k = std::min(row_step[row], column_step[column]);
+        if (row_step[row] == column_step[column]) {
+            return system.pivot[k];
+        }
+        if (column_step[column] == k) {
+            auto first = system.l_rows.begin() + system.l_start[k], last = system.l_rows.begin() + system.l_start[k + 1];
+            return system.l_entries[std::lower_bound(first, last, row) - system.l_rows.begin()];
+        }
+        auto first = system.u_columns.begin() + system.u_start[k], last = system.u_columns.begin() + system.u_start[k + 1];
+        return system.u_entries[std::lower_bound(first, last, column) - system.u_columns.begin()];
+    };
+    system.update_start.assign(n + 1, 0);
+    system.update_targets.clear();
+    for (int k = 0; k < n; k++) {
+        system.update_start[k] = static_cast<int>(system.update_targets.size());
+        for (int l = system.l_start[k]; l < system.l_start[k + 1]; l++) {
+            for (int u = system.u_start[k]; u < system.u_start[k + 1]; u++) {
+                system.update_targets.push_back(entry_at(system.l_rows[l], system.u_columns[u]));
+            }
+        }
+    }
+    system.update_start[n] = static_cast<int>(system.update_targets.size());
+
+    system.slot_entry.resize(stamps.size());
+    for (size_t i = 0; i < stamps.size(); i++) {
+        system.slot_entry[i] = entry_at(stamps[i].row, stamps[i].column);
+    }
+    return true;
+}
+
+bool build_ac_system(const AcCircuit& circuit, double reference_hz, AcSystem& system, std::string& error) {
+    system = AcSystem();
+    for (const AcElement& element : circuit.elements) {
+        int used = element.kind == AC_VCVS || element.kind == AC_VCCS ? 4 : element.kind == AC_OPAMP ? 3 : 2;
+        for (int i = 0; i < used; i++) {
+            if (element.nodes[i] < 0 || element.nodes[i] >= circuit.num_nodes) {
+                error = element.name + ": node " + std::to_string(element.nodes[i]) + " doesn't exist";
+                return false;
+            }
+        }
+        bool controlled_by_current = element.kind == AC_CCCS || element.kind == AC_CCVS;
+        if (controlled_by_current && (element.control < 0 || element.control >= static_cast<int>(circuit.elements.size()) ||
+                                      circuit.elements[element.control].kind != AC_VOLTAGE_SOURCE)) {
+            error = element.name + ": control must be a voltage source";
+            return false;
+        }
+        if (element.kind == AC_RESISTOR && element.value == 0) {
+            error = element.name + ": zero resistance";
+            return false;
+        }
+    }
+    if (!(reference_hz >= 0)) {
+        error = "reference frequency must not be negative";
+        return false;
+    }
+
+    std::vector<int> branch;
+    system.num_nodes = circuit.num_nodes;
+    system.unknowns = assign_branches(circuit, branch);
+    if (system.unknowns == 0) {
+        error = "circuit has no nodes besides ground";
+        return false;
+    }
+    std::vector<AcStamp> stamps;
+    system.rhs.assign(system.unknowns, 0);
+    stamp_circuit(circuit, branch, stamps, system.rhs);
+    system.slot_row.resize(stamps.size());
+    system.slot_column.resize(stamps.size());
+    system.slot_g.resize(stamps.size());
+    system.slot_c.resize(stamps.size());
+    for (size_t i = 0; i < stamps.size(); i++) {
+        system.slot_row[i] = stamps[i].row;
+        system.slot_column[i] = stamps[i].column;
+        system.slot_g[i] = stamps[i].g;
+        system.slot_c[i] = stamps[i].c;
+    }
+    if (!plan_factorisation(stamps, reference_hz, system, error)) {
+        system = AcSystem();
+        return false;
+    }
+    return true;
+}
+
+void restamp_ac_system(const AcCircuit& circuit, AcSystem& system) {
+    std::vector<int> branch;
+    std::vector<AcStamp> stamps;
+    assign_branches(circuit, branch);
+    std::fill(system.rhs.begin(), system.rhs.end(), Complex(0));
+    stamp_circuit(circuit, branch, stamps, system.rhs);
+    for (size_t i = 0; i < stamps.size() && i < system.slot_g.size(); i++) {
+        system.slot_g[i] = stamps[i].g;
+        system.slot_c[i] = stamps[i].c;
+    }
+}
+
+// Per-thread buffers for solving single points
+struct AcWorkspace {
+    std::vector<Complex> entries;
+    std::vector<Complex> b;
+    std::vector<Complex> x;
+    std::vector<Complex> dense; // fallback matrix, row-major, allocated on first use
+};
+
+// Function to solve at one frequency by replaying the planned factorisation; false if a
+// pivot is too small relative to the stamped values
+static bool solve_planned(const AcSystem& system, Complex s, AcWorkspace& work) {
+    int n = system.unknowns;
+    std::fill(work.entries.begin(), work.entries.end(), Complex(0));
+    double scale = 0;
+    for (size_t i = 0; i < system.slot_entry.size(); i++) {
+        Complex value = Complex(system.slot_g[i], 0) + multiply(s, Complex(system.slot_c[i], 0));
+        work.entries[system.slot_entry[i]] = value;
+        scale = std::max(scale, magnitude(value));
+    }
+    Complex* e = work.entries.data();
+    const int* targets = system.update_targets.data();
+    for (int k = 0; k < n; k++) {
+        Complex pivot = e[system.pivot[k]];
+        if (!(magnitude(pivot) > AC_PIVOT_TOLERANCE * scale)) {
+            return false;
+        }
+        Complex inverse = reciprocal(pivot);
+        int l_first = system.l_start[k], l_last = system.l_start[k + 1];
+        int u_first = system.u_start[k], u_last = system.u_start[k + 1];
+        const int* target = targets + system.update_start[k];
+        for (int l = l_first; l < l_last; l++) {
+            Complex multiplier = multiply(e[system.l_entries[l]], inverse);
+            e[system.l_entries[l]] = multiplier;
+            for (int u = u_first; u < u_last; u++) {
+                e[*target++] -= multiply(multiplier, e[system.u_entries[u]]);
+            }
+        }
+    }
+
+    // Forward substitution in pivot order, then back substitution into the unknowns
+    std::copy(system.rhs.begin(), system.rhs.end(), work.b.begin());
+    for (int k = 0; k < n; k++) {
+        Complex value = work.b[system.row_order[k]];
+        for (int l = system.l_start[k]; l < system.l_start[k + 1]; l++) {
+            work.b[system.l_rows[l]] -= multiply(e[system.l_entries[l]], value);
+        }
+    }
+    for (int k = n - 1; k >= 0; k--) {
+        Complex sum = work.b[system.row_order[k]];
+        for (int u = system.u_start[k]; u < system.u_start[k + 1]; u++) {
+            sum -= multiply(e[system.u_entries[u]], work.x[system.u_columns[u]]);
+        }
+        Complex value = multiply(sum, reciprocal(e[system.pivot[k]]));
+        if (!std::isfinite(value.real()) || !std::isfinite(value.imag())) {
+            return false;
+        }
+        work.x[system.column_order[k]] = value;
+    }
+    return true;
+}
+
+// Function to solve at one frequency by dense LU with partial pivoting; false if singular
+static bool solve_dense(const AcSystem& system, Complex s, AcWorkspace& work) {
+    int n = system.unknowns;
+    if (n > AC_DENSE_MAX_UNKNOWNS) {
+        return false;
+    }
+    work.dense.assign(static_cast<size_t>(n) * n, Complex(0));
+    Complex* a = work.dense.data();
+    for (size_t i = 0; i < system.slot_entry.size(); i++) {
+        a[static_cast<size_t>(system.slot_row[i]) * n + system.slot_column[i]] =
+            Complex(system.slot_g[i], 0) + multiply(s, Complex(system.slot_c[i], 0));
+    }
+    std::copy(system.rhs.begin(), system.rhs.end(), work.b.begin());
+    for (int k = 0; k < n; k++) {
+        int best = k;
+        for (int r = k + 1; r < n; r++) {
+            if (std::abs(a[static_cast<size_t>(r) * n + k]) > std::abs(a[static_cast<size_t>(best) * n + k])) {
+                best = r;
+            }
+        }
+        Complex* pivot_row = a + static_cast<size_t>(best) * n;
+        if (pivot_row[k] == Complex(0)) {
+            return false;
+        }
+        if (best != k) {
+            std::swap_ranges(pivot_row, pivot_row + n, a + static_cast<size_t>(k) * n);
+            std::swap(work.b[best], work.b[k]);
+            pivot_row = a + static_cast<size_t>(k) * n;
+        }
+        Complex inverse = reciprocal(pivot_row[k]);
+        for (int r = k + 1; r < n; r++) {
+            Complex* row = a + static_cast<size_t>(r) * n;
+            if (row[k] == Complex(0)) {
+                continue;
+            }
+            Complex multiplier = multiply(row[k], inverse);
+            for (int c = k + 1; c < n; c++) {
+                row[c] -= multiply(multiplier, pivot_row[c]);
+            }
+            work.b[r] -= multiply(multiplier, work.b[k]);
+        }
+    }
+    for (int k = n - 1; k >= 0; k--) {
+        const Complex* row = a + static_cast<size_t>(k) * n;
+        Complex sum = work.b[k];
+        for (int c = k + 1; c < n; c++) {
+            sum -= multiply(row[c], work.x[c]);
+        }
+        work.x[k] = multiply(sum, reciprocal(row[k]));
+    }
+    return true;
+}
+
+int ac_sweep(const AcSystem& system, const double* freq, int count, const int* probes, int num_probes,
+             Complex* out, const AcOptions& options) {
+    if (system.unknowns == 0 || count <= 0) {
+        return 0;
+    }
+    int num_chunks = (count + AC_CHUNK_POINTS - 1) / AC_CHUNK_POINTS;
+    int num_threads = options.num_threads > 0 ? options.num_threads
+                                              : static_cast<int>(std::thread::hardware_concurrency());
+    num_threads = std::max(1, std::min(num_threads, num_chunks));
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    std::atomic<int> next_chunk(0), fallbacks(0);
+    std::atomic<bool> singular(false);
+    auto work = [&]() {
+        AcWorkspace workspace;
+        workspace.entries.resize(system.num_entries);
+        workspace.b.resize(system.unknowns);
+        workspace.x.resize(system.unknowns);
+        int chunk_fallbacks = 0;
+        for (int chunk = next_chunk++; chunk < num_chunks; chunk = next_chunk++) {
+            int last = std::min(count, (chunk + 1) * AC_CHUNK_POINTS);
+            for (int point = chunk * AC_CHUNK_POINTS; point < last; point++) {
+                Complex s(0, 2 * PI * freq[point]);
+                bool solved = solve_planned(system, s, workspace);
+                if (!solved) {
+                    chunk_fallbacks++;
+                    solved = solve_dense(system, s, workspace);
+                }
+                if (!solved) {
+                    singular = true;
+                }
+                Complex* values = out + static_cast<size_t>(point) * num_probes;
+                for (int p = 0; p < num_probes; p++) {
+                    int node = probes[p];
+                    values[p] = !solved || node < 0 || node >= system.num_nodes ? Complex(nan, nan)
+                              : node == 0 ? Complex(0) : workspace.x[node - 1];
+                }
+            }
+        }
+        fallbacks += chunk_fallbacks;
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; i++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return singular ? -1 : fallbacks.load();
+}
@@ -0,0 +1,92 @@
+#ifndef AC_SOLVER_H
+#define AC_SOLVER_H
+
+#include <complex>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Small-signal AC analysis of linear circuits by modified nodal analysis.
+// Every matrix entry is g + s*c, so a circuit is stamped once into per-entry (g, c) pairs.
+// The sparse LU pivot order and fill pattern are worked out once per topology (Markowitz
+// pivoting with a threshold, at a reference frequency) and compiled into flat operation
+// lists. Each frequency point then only refills the entries and replays those lists,
+// falling back to dense partial pivoting at any point where a planned pivot gets too
+// small. Frequency points are split across threads in fixed chunks.
+
+enum AcElementKind {
+    AC_RESISTOR,       // R n+ n- ohms
+    AC_CAPACITOR,      // C n+ n- farads
+    AC_INDUCTOR,       // L n+ n- henries
+    AC_VOLTAGE_SOURCE, // V n+ n- [AC] magnitude [phase degrees]
+    AC_CURRENT_SOURCE, // I n+ n- [AC] magnitude [phase degrees], flowing n+ -> source -> n-
+    AC_VCVS,           // E n+ n- nc+ nc- gain
+    AC_VCCS,           // G n+ n- nc+ nc- transconductance
+    AC_CCCS,           // F n+ n- Vcontrol gain
+    AC_CCVS,           // H n+ n- Vcontrol transresistance
+    AC_OPAMP           // O out in+ in- [open-loop gain [gain-bandwidth Hz]], ideal without them
+};
+
+struct AcElement {
+    AcElementKind kind;
+    int nodes[4];   // n+, n-, nc+, nc- (op-amp: out, in+, in-)
+    double value;   // element value, source magnitude or op-amp open-loop gain (0 = ideal)
+    double value2;  // source phase in degrees or op-amp gain-bandwidth (0 = no pole)
+    int control;    // element index of the controlling voltage source for F and H
+    std::string name;
+};
+
+struct AcCircuit {
+    int num_nodes = 1; // node 0 is ground
+    std::vector<AcElement> elements;
+    std::vector<std::string> node_names;
+    std::unordered_map<std::string, int> node_index;
+};
+
+// SPICE-style netlist as listed above, "*" starts a comment, node "0" (or "gnd") is ground
+bool parse_ac_netlist(std::istream& in, AcCircuit& circuit, std::string& error);
+// Node index from its name, -1 if the netlist has no such node
+int ac_node(const AcCircuit& circuit, const std::string& name);
+
+// Compiled analysis of one topology
+struct AcSystem {
+    int unknowns = 0;                   // nodes other than ground, then branch currents
+    int num_nodes = 0;
+    std::vector<int> slot_entry;        // stamped entry -> position in the factor
+    std::vector<int> slot_row;          // stamped entry -> row and column, for the dense fallback
+    std::vector<int> slot_column;
+    std::vector<double> slot_g;         // value at s is g + s*c
+    std::vector<double> slot_c;
+    std::vector<std::complex<double>> rhs;
+    int num_entries = 0;                // L and U entries including fill
+    std::vector<int> pivot;             // entry of each pivot
+    std::vector<int> l_start;           // per step: entries below the pivot and their rows
+    std::vector<int> l_entries;
+    std::vector<int> l_rows;
+    std::vector<int> u_start;           // per step: entries right of the pivot and their columns
+    std::vector<int> u_entries;
+    std::vector<int> u_columns;
+    std::vector<int> update_start;      // per step: targets of every (l, u) product, l outer
+    std::vector<int> update_targets;
+    std::vector<int> row_order;         // step -> equation
+    std::vector<int> column_order;      // step -> unknown
+};
+
+// Stamps the circuit and plans the factorisation at reference_hz; false with an error if
+// the circuit is invalid or singular there
+bool build_ac_system(const AcCircuit& circuit, double reference_hz, AcSystem& system, std::string& error);
+// Re-stamps changed element values into a system built from the same topology
+void restamp_ac_system(const AcCircuit& circuit, AcSystem& system);
+
+struct AcOptions {
+    int num_threads = 0; // 0 uses every core
+};
+
+// Complex node voltages at every frequency for the probe nodes, point-major:
+// out[point * num_probes + probe]. Returns the number of points that needed the dense
+// fallback, or -1 if some point was singular (its values are NaN).
+int ac_sweep(const AcSystem& system, const double* freq, int count, const int* probes, int num_probes,
+             std::complex<double>* out, const AcOptions& options = AcOptions());
+
+#endif
@@ -0,0 +1,1080 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <map>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include "ac_solver.h"
+#include "calc.h"
+#include "catalog.h"
+#include "color_code.h"
+#include "dc_solver.h"
+#include "eseries.h"
+#include "npv_search.h"
+#include "poles.h"
+#include "synth.h"
+#include "filter_design.h"
+#include "response.h"
+#include "network.h"
+#include "memo_store.h"
+#include "result_cache.h"
+#include "si_value.h"
+#include "tolerance.h"
+#include "batch.h"
+
+const size_t BATCH_CACHE_BYTES = 64 << 20;  // default budget of the result cache
+const int BATCH_CACHE_MAX_NAMED = 16;       // requests with more key=value arguments aren't cached
+const uint32_t BATCH_MEMO_VERSION = 1;      // bump when a memoised calculation or its output changes
+const double BATCH_MAX_POINTS = 1e6;        // sweep points per request; each takes a few arrays of doubles
+const double BATCH_MAX_TRIALS = 1e9;        // Monte Carlo trials per request, about a minute per core
+
+// Function to read key=value arguments of a request into a map
+static bool parse_arguments(std::istringstream& tokens, std::map<std::string, double>& args, std::vector<double>& values, std::vector<std::string>& words) {
+    std::string token;
+    while (tokens >> token) {
+        size_t equals = token.find('=');
+        double value;
+        if (equals == std::string::npos) {
+            if (parse_value(token, value)) {
+                values.push_back(value);
+            }
+            else {
+                words.push_back(token);
+            }
+            continue;
+        }
+        if (!parse_value(token.substr(equals + 1), value)) {
+            return false;
+        }
+        args[token.substr(0, equals)] = value;
+    }
+    return true;
+}
+
+// Function to list the bare tokens of a request as written, numbers included, for
+// netlists whose node names ("0", "2") would otherwise be read as values
+static std::vector<std::string> bare_tokens(const std::string& line) {
+    std::istringstream tokens(line);
+    std::vector<std::string> names;
+    std::string token;
+    tokens >> token; // the command
+    while (tokens >> token) {
+        if (token.find('=') == std::string::npos) {
+            names.push_back(token);
+        }
+    }
+    return names;
+}
+
+// Function to fetch a required argument, reporting the missing key
+static bool require(const std::map<std::string, double>& args, const std::string& key, double& value, std::ostream& out) {
+    auto it = args.find(key);
+    if (it == args.end()) {
+        out << "error: missing " << key << "\n";
+        return false;
+    }
+    if (it->second <= 0 && key != "vin") {
+        out << "error: " << key << " must be positive\n";
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+// Comma-separated colour names of a packed code
+static void write_color_bands(PackedBands bands, std::ostream& out) {
+    for (int i = 0; i < packed_band_count(bands); i++) {
+        out << (i > 0 ? "," : "") << band_color_name(packed_band(bands, i));
+    }
+}
+
+// Function to read a filter family name as a ripple: butterworth is 0, cheb<dB> (cheb0.5, cheb2, ...) is the ripple,
+// up to MAX_RIPPLE_DB
+static bool parse_family(const std::string& name, double& ripple_db) {
+    if (name == "butterworth") {
+        ripple_db = 0;
+        return true;
+    }
+    return name.compare(0, 4, "cheb") == 0 && parse_value(name.substr(4), ripple_db) &&
+           ripple_db > 0 && ripple_db <= MAX_RIPPLE_DB;
+}
+
+// Whole-cascade optimiser, e.g. "sallen-key-opt cheb0.5 poles=6 fc=1k high E24 E12 lines=6"
+static bool run_sallen_key_opt(const std::vector<std::string>& words, const std::map<std::string, double>& args, std::ostream& out) {
+    CascadeOptions options;
+    if (words.empty() || !parse_family(words[0], options.ripple_db)) {
+        out << "error: sallen-key-opt needs a family (butterworth or cheb<dB> up to cheb" << MAX_RIPPLE_DB << ")\n";
+        return false;
+    }
+    int series_given = 0;
+    for (size_t i = 1; i < words.size(); i++) {
+        if (words[i] == "high" || words[i] == "low") {
+            options.high_pass = (words[i] == "high");
+        }
+        else if (!parse_eseries(words[i], series_given++ == 0 ? options.r_series : options.c_series)) {
+            out << "error: unknown option " << words[i] << "\n";
+            return false;
+        }
+    }
+    double poles;
+    if (!require(args, "poles", poles, out) || !require(args, "fc", options.cutoff_freq, out)) {
+        return false;
+    }
+    options.num_poles = static_cast<int>(poles);
+    auto lines = args.find("lines");
+    if (lines != args.end()) {
+        options.max_distinct_values = static_cast<int>(lines->second);
+    }
+
+    CascadeDesign design = optimise_sallen_key_cascade(options);
+    if (design.num_stages == 0) {
+        out << "error: no design for these poles and limits\n";
+        return false;
+    }
+    for (int i = 0; i < design.num_stages; ++i) {
+        const CascadeStage& stage = design.stages[i];
+        out << (i > 0 ? "; " : "") << "pair=" << i + 1 << " r=" << stage.r << " c=" << stage.c
+            << " ra=" << stage.ra << " rb=" << stage.rb << " f0=" << stage.achieved_freq << " q=" << stage.achieved_q;
+    }
+    out << "; lines=" << design.distinct_values << " err=" << design.total_error << "\n";
+    return true;
+}
+
+// Sallen-Key request: same gains and cutoff maths as butterworth_filter/chebyshev_filter
+static bool run_sallen_key(const std::vector<std::string>& words, const std::map<std::string, double>& args, std::ostream& out) {
+    if (words.empty()) {
+        out << "error: sallen-key needs a family (butterworth, cheb0.5, cheb2, ...)\n";
+        return false;
+    }
+    double poles, r, c, rb;
+    if (!require(args, "poles", poles, out) || !require(args, "r", r, out) ||
+        !require(args, "c", c, out) || !require(args, "rb", rb, out)) {
+        return false;
+    }
+
+    double ripple_db;
+    if (!parse_family(words[0], ripple_db)) {
+        out << "error: unknown filter family " << words[0] << " (butterworth or cheb<dB> up to cheb" << MAX_RIPPLE_DB << ")\n";
+        return false;
+    }
+
+    SallenKeyDesign design = sallen_key_design(ripple_db, static_cast<int>(poles), r, c, rb);
+    if (design.num_stages == 0) {
+        out << "error: poles must be 1 to " << MAX_FILTER_ORDER << "\n";
+        return false;
+    }
+    for (int i = 0; i < design.num_stages; ++i) {
+        const SallenKeyStage& stage = design.stages[i];
+        if (i > 0) {
+            out << "; ";
+        }
+        out << "pair=" << i + 1 << " gain=" << stage.gain << " ra=" << stage.ra;
+        // A first-order section is a plain follower, so it has no RA/RB to pick
+        if (stage.ra > 0) {
+            out << " ra_npv=" << nearest_npv_resistor(stage.ra);
+            // Best E12 RA/RB ratio within a decade of the requested RB
+            ResistorRatio ra_rb;
+            if (best_ratio_pairs(stage.gain - 1, E12, rb / 10, rb * 10, 1, &ra_rb) == 1) {
+                out << " ra_rb=" << ra_rb.numerator << "/" << ra_rb.denominator;
+            }
+        }
+        out << " fc=" << stage.cutoff_freq;
+    }
+    out << "\n";
+    return true;
+}
+
+// Frequency response summary of an RC or ideal Sallen-Key filter,
+// e.g. "sweep rc r=10k c=10n high points=1e5" or "sweep cheb0.5 poles=6 fc=1k from=10 to=100k"
+static bool run_sweep(const std::vector<std::string>& words, const std::map<std::string, double>& args, std::ostream& out) {
+    if (words.empty()) {
+        out << "error: sweep needs rc or a family (butterworth, cheb0.5, cheb2, ...)\n";
+        return false;
+    }
+    bool high_pass = false;
+    for (size_t i = 1; i < words.size(); i++) {
+        if (words[i] != "high" && words[i] != "low") {
+            out << "error: unknown option " << words[i] << "\n";
+            return false;
+        }
+        high_pass = (words[i] == "high");
+    }
+
+    StageSet stages;
+    double fc;
+    if (words[0] == "rc") {
+        double r, c;
+        if (!require(args, "r", r, out) || !require(args, "c", c, out)) {
+            return false;
+        }
+        fc = calculate_cutoff_frequency(r, c);
+        add_rc_stage(stages, r, c, high_pass);
+    }
+    else {
+        double ripple_db, poles;
+        if (!parse_family(words[0], ripple_db)) {
+            out << "error: unknown filter family " << words[0] << " (butterworth or cheb<dB> up to cheb" << MAX_RIPPLE_DB << ")\n";
+            return false;
+        }
+        if (!require(args, "poles", poles, out) || !require(args, "fc", fc, out)) {
+            return false;
+        }
+        stages = ideal_filter_stages(static_cast<int>(poles), ripple_db, fc, high_pass);
+        if (stages.num_stages == 0) {
+            out << "error: poles must be 1 to " << MAX_FILTER_ORDER << "\n";
+            return false;
+        }
+    }
+
+    double start = args.count("from") ? args.at("from") : fc / 100;
+    double stop = args.count("to") ? args.at("to") : fc * 100;
+    double points = args.count("points") ? args.at("points") : 1000;
+    if (start <= 0 || stop <= start || points < 2 || points > BATCH_MAX_POINTS) {
+        out << "error: sweep needs 0 < from < to and 2 to " << BATCH_MAX_POINTS << " points\n";
+        return false;
+    }
+    int num_points = static_cast<int>(points);
+    std::vector<double> freq(num_points), magnitude(num_points), phase(num_points), delay(num_points);
+    log_frequencies(start, stop, num_points, freq.data());
+    sweep_response(stages, freq.data(), num_points, magnitude.data(), phase.data(), delay.data());
+
+    // -3 dB point: first point 3 dB under the peak, walking away from the passband
+    int peak = 0, most_delay = 0;
+    for (int i = 1; i < num_points; i++) {
+        if (magnitude[i] > magnitude[peak]) peak = i;
+        if (delay[i] > delay[most_delay]) most_delay = i;
+    }
+    int edge = peak;
+    while (edge >= 0 && edge < num_points && magnitude[edge] > magnitude[peak] - 3) {
+        edge += high_pass ? -1 : 1;
+    }
+    out << "kernel=" << sweep_kernel_name() << " points=" << num_points
+        << " peak_db=" << magnitude[peak] << " peak_f=" << freq[peak];
+    if (edge >= 0 && edge < num_points) {
+        out << " f3db=" << freq[edge];
+    }
+    out << " max_gd=" << delay[most_delay] << " max_gd_f=" << freq[most_delay]
+        << " phase_end=" << phase[num_points - 1] << "\n";
+    return true;
+}
+
+// Monte Carlo tolerance run, e.g. "tolerance rc r=10k c=10n rtol=0.05 ctol=0.1 min=1.5k max=1.7k trials=1e6",
+// "tolerance inverting vin=1 rf=100k rin=10k", "tolerance sallen-key r=10k c=10n ra=5.6k rb=10k high qmin=0.6"
+static bool run_tolerance(const std::vector<std::string>& words, const std::map<std::string, double>& args, std::ostream& out) {
+    if (words.empty()) {
+        out << "error: tolerance needs rc, inverting, non-inverting or sallen-key\n";
+        return false;
+    }
+    MonteCarloOptions options;
+    bool high_pass = false;
+    for (size_t i = 1; i < words.size(); i++) {
+        if (words[i] == "uniform" || words[i] == "gaussian") {
+            ToleranceDistribution distribution = words[i] == "uniform" ? UNIFORM_TOLERANCE : GAUSSIAN_TOLERANCE;
+            options.resistor.distribution = distribution;
+            options.capacitor.distribution = distribution;
+        }
+        else if (words[i] == "high" || words[i] == "low") {
+            high_pass = (words[i] == "high");
+        }
+        else {
+            out << "error: unknown option " << words[i] << "\n";
+            return false;
+        }
+    }
+    if (args.count("rtol")) options.resistor.tolerance = args.at("rtol");
+    if (args.count("ctol")) options.capacitor.tolerance = args.at("ctol");
+    if (args.count("trials")) {
+        double trials = args.at("trials");
+        if (!(trials >= 1 && trials <= BATCH_MAX_TRIALS)) {
+            out << "error: tolerance needs 1 to " << BATCH_MAX_TRIALS << " trials\n";
+            return false;
+        }
+        options.trials = static_cast<long long>(trials);
+    }
+    if (args.count("seed")) options.seed = static_cast<unsigned long long>(args.at("seed"));
+    if (args.count("threads")) options.num_threads = static_cast<int>(args.at("threads"));
+    // min/max bound the main output (fc, vout or f0), qmin/qmax the Sallen-Key Q
+    MetricSpec spec, q_spec;
+    if (args.count("min")) spec.min = args.at("min");
+    if (args.count("max")) spec.max = args.at("max");
+    if (args.count("qmin")) q_spec.min = args.at("qmin");
+    if (args.count("qmax")) q_spec.max = args.at("qmax");
+
+    MonteCarloResult result;
+    const char* const* names;
+    double r, c, ra, rb, vin, rf, rin;
+    if (words[0] == "rc") {
+        static const char* const rc_names[] = { "fc" };
+        if (!require(args, "r", r, out) || !require(args, "c", c, out)) return false;
+        result = monte_carlo_rc(r, c, spec, options);
+        names = rc_names;
+    }
+    else if (words[0] == "inverting" || words[0] == "non-inverting") {
+        static const char* const amp_names[] = { "gain", "vout" };
+        const char* ground_key = words[0] == "inverting" ? "rin" : "rg";
+        if (!require(args, "vin", vin, out) || !require(args, "rf", rf, out) || !require(args, ground_key, rin, out)) return false;
+        result = words[0] == "inverting" ? monte_carlo_inverting(vin, rf, rin, spec, options)
+                                         : monte_carlo_non_inverting(vin, rf, rin, spec, options);
+        names = amp_names;
+    }
+    else if (words[0] == "sallen-key") {
+        static const char* const stage_names[] = { "f0", "q", "gain" };
+        if (!require(args, "r", r, out) || !require(args, "c", c, out) ||
+            !require(args, "ra", ra, out) || !require(args, "rb", rb, out)) return false;
+        result = monte_carlo_sallen_key(r, c, ra, rb, high_pass, spec, q_spec, options);
+        names = stage_names;
+    }
+    else {
+        out << "error: unknown design " << words[0] << "\n";
+        return false;
+    }
+    if (result.num_metrics == 0) {
+        out << "error: tolerance needs positive parts and trials\n";
+        return false;
+    }
+    for (int m = 0; m < result.num_metrics; m++) {
+        const MetricStats& stats = result.metrics[m];
+        out << names[m] << "_mean=" << stats.mean << " " << names[m] << "_std=" << stats.stddev
+            << " " << names[m] << "_p1=" << stats.percentile_1 << " " << names[m] << "_p99=" << stats.percentile_99 << " ";
+    }
+    out << "trials=" << result.trials << " yield=" << result.yield << "\n";
+    return true;
+}
+
+// Parts catalog, if one was given; opened before the first request and only read after that
+static PartsCatalog batch_catalog;
+
+// Function to take a bare word such as "stock" out of a request's words
+static bool take_word(std::vector<std::string>& words, const char* word) {
+    auto found = std::find(words.begin(), words.end(), word);
+    if (found == words.end()) {
+        return false;
+    }
+    words.erase(found);
+    return true;
+}
+
+// Function to read which catalog parts a request may use: qtymin (default 1, so only
+// what we stock; 0 allows parts we'd have to order), tolmax and pricemax
+static bool stock_filter(const std::map<std::string, double>& args, PartFilter& filter, std::ostream& out) {
+    if (!batch_catalog.header) {
+        out << "error: no parts catalog, set ENGINUITY_CATALOG\n";
+        return false;
+    }
+    auto it = args.find("qtymin");
+    if (it != args.end()) filter.min_quantity = it->second;
+    it = args.find("tolmax");
+    if (it != args.end()) filter.max_tolerance = it->second;
+    it = args.find("pricemax");
+    if (it != args.end()) filter.max_price = it->second;
+    return true;
+}
+
+static void write_catalog_part(const char* name, const CatalogPart& part, std::ostream& out) {
+    out << " " << name << "=" << catalog_string(batch_catalog, part.sku) << " package=" << catalog_string(batch_catalog, part.package)
+        << " tol=" << 100 * part.tolerance << "% price=" << part.price << " qty=" << part.quantity;
+}
+
+// Function to answer a nearest-value request from the catalog, e.g. "part capacitor 47n tolmax=0.05"
+static bool run_part(const char* name, PartKind kind, double value, const std::map<std::string, double>& args, std::ostream& out) {
+    PartFilter filter;
+    if (!stock_filter(args, filter, out)) {
+        return false;
+    }
+    const CatalogPart* down;
+    const CatalogPart* up;
+    const CatalogPart* part = nearest_catalog_part(batch_catalog, kind, value, filter, &down, &up);
+    if (!part) {
+        out << "error: no part in the catalog matches\n";
+        return false;
+    }
+    // down or up is left out when nothing allowed lies on that side
+    out << name << "=" << part->value;
+    if (down) out << " down=" << down->value;
+    if (up) out << " up=" << up->value;
+    write_catalog_part("sku", *part, out);
+    out << "\n";
+    return true;
+}
+
+// One cache for every thread running requests: batch input, one-shot commands and the daemon's workers
+static ResultCache& batch_cache() {
+    static ResultCache cache(BATCH_CACHE_BYTES);
+    return cache;
+}
+
+// Persistent memo, if a file was given; the flag saves a lock per request when there isn't one
+static MemoStore& batch_memo() {
+    static MemoStore memo;
+    return memo;
+}
+static std::atomic<bool> batch_memo_open(false);
+
+// Function to tell whether a request is worth keeping on disk: the preferred-value
+// searches, the Sallen-Key designs and the Monte Carlo runs
+static bool memo_worthy(const std::string& key) {
+    std::string_view command(key.data(), std::min(key.size(), key.find_first_of("#\"=")));
+    // Answers from the parts catalog change with the stock, so they stay out of the memo
+    return (command == "pairs" || command == "rc-pairs" || command == "gain" || command == "sallen-key" ||
+            command == "sallen-key-opt" || command == "tolerance") && key.find("\"stock ") == std::string::npos;
+}
+
+static inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// Function to build the cache key of a request from what parse_arguments would make of it:
+// the command, each bare token in order (a value as its double, so 10k and 10000 match, a
+// word as written), then the key=value arguments sorted by name, the last one winning.
+// False for requests that mustn't be cached: netlist files can change between requests,
+// the network search stops on a time limit, and invalid values are errors anyway.
+static bool batch_cache_key(const std::string& line, std::string& key) {
+    const char* p = line.data();
+    const char* end = p + line.size();
+    const char* start = p;
+    auto next_token = [&p, &start, end]() {
+        while (p < end && is_space(*p)) {
+            p++;
+        }
+        start = p;
+        while (p < end && !is_space(*p)) {
+            p++;
+        }
+        return p > start;
+    };
+    if (!next_token()) {
+        return false;
+    }
+    std::string_view command(start, p - start);
+    if (command == "dc" || command == "dc-req" || command == "ac" || command == "network" || command == "cache-stats") {
+        return false;
+    }
+    key.reserve(line.size() + 16);
+    key.assign(command);
+
+    std::pair<std::string_view, double> named[BATCH_CACHE_MAX_NAMED];
+    int num_named = 0;
+    while (next_token()) {
+        const char* equals = static_cast<const char*>(std::memchr(start, '=', p - start));
+        double value;
+        if (!equals) {
+            if (parse_si_value(start, p, value)) {
+                key += '#';
+                key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+            }
+            else {
+                key += '"';
+                key.append(start, p - start);
+                key += ' ';
+            }
+            continue;
+        }
+        if (num_named == BATCH_CACHE_MAX_NAMED || !parse_si_value(equals + 1, p, value)) {
+            return false;
+        }
+        // Insertion sort by name keeps repeated names in request order
+        int i = num_named++;
+        std::string_view name(start, equals - start);
+        for (; i > 0 && named[i - 1].first > name; i--) {
+            named[i] = named[i - 1];
+        }
+        named[i] = { name, value };
+    }
+    for (int i = 0; i < num_named; i++) {
+        if (i + 1 < num_named && named[i + 1].first == named[i].first) {
+            continue;
+        }
+        key += '=';
+        key.append(named[i].first);
+        key += ' ';
+        key.append(reinterpret_cast<const char*>(&named[i].second), sizeof(double));
+    }
+    return true;
+}
+
+// Function to run one request without the cache
+static bool run_request(const std::string& line, std::ostream& out) {
+    std::istringstream tokens(line);
+    std::string command;
+    tokens >> command;
+
+    std::map<std::string, double> args;
+    std::vector<double> values;
+    std::vector<std::string> words;
+    if (!parse_arguments(tokens, args, values, words)) {
+        out << "error: invalid value in '" << line << "'\n";
+        return false;
+    }
+
+    double r, c, fc, vin, rf, rin;
+    if (command == "rc-cutoff") {
+        if (!require(args, "r", r, out) || !require(args, "c", c, out)) return false;
+        out << "fc=" << calculate_cutoff_frequency(r, c, 1.0) << "\n";
+    }
+    else if (command == "rc-r") {
+        if (!require(args, "c", c, out) || !require(args, "fc", fc, out)) return false;
+        out << "r=" << required_resistance(c, fc) << "\n";
+    }
+    else if (command == "rc-c") {
+        if (!require(args, "r", r, out) || !require(args, "fc", fc, out)) return false;
+        out << "c=" << required_capacitance(r, fc) << "\n";
+    }
+    else if (command == "rc-pairs") {
+        // Preferred R and C for a cutoff, e.g. "rc-pairs fc=1k E24 E12 rmin=1k rmax=100k cmin=1n cmax=1u",
+        // or from the catalog with "stock" in place of the series
+        ESeries r_series = E24, c_series = E6;
+        bool stock = take_word(words, "stock");
+        PartFilter filter;
+        if (stock && !words.empty()) {
+            out << "error: stock replaces the series\n";
+            return false;
+        }
+        if (stock && !stock_filter(args, filter, out)) return false;
+        if ((words.size() > 0 && !parse_eseries(words[0], r_series)) ||
+            (words.size() > 1 && !parse_eseries(words[1], c_series))) {
+            out << "error: unknown series\n";
+            return false;
+        }
+        if (!require(args, "fc", fc, out)) return false;
+        const int max_pairs = 16;
+        int k = args.count("k") ? static_cast<int>(args["k"]) : 3;
+        if (k < 1 || k > max_pairs) {
+            out << "error: k must be between 1 and " << max_pairs << "\n";
+            return false;
+        }
+        RcPair pairs[max_pairs];
+        double min_r = args.count("rmin") ? args["rmin"] : 1e3, max_r = args.count("rmax") ? args["rmax"] : 1e6;
+        double min_c = args.count("cmin") ? args["cmin"] : 10e-12, max_c = args.count("cmax") ? args["cmax"] : 10e-6;
+        int found;
+        if (stock) {
+            std::vector<double> r_scratch, c_scratch;
+            int r_count, c_count;
+            const double* resistors = catalog_values(batch_catalog, PART_RESISTOR, filter, r_scratch, r_count);
+            const double* capacitors = catalog_values(batch_catalog, PART_CAPACITOR, filter, c_scratch, c_count);
+            found = best_rc_pairs(fc, resistors, r_count, capacitors, c_count, min_r, max_r, min_c, max_c, k, pairs);
+        }
+        else {
+            found = best_rc_pairs(fc, r_series, c_series, min_r, max_r, min_c, max_c, k, pairs);
+        }
+        if (found == 0) {
+            out << "error: no R and C pair in range\n";
+            return false;
+        }
+        out << "r/c=";
+        for (int i = 0; i < found; i++) {
+            out << (i > 0 ? "," : "") << pairs[i].r << "/" << pairs[i].c << ":" << 100 * pairs[i].error << "%";
+        }
+        if (stock) {
+            out << " skus=";
+            for (int i = 0; i < found; i++) {
+                out << (i > 0 ? "," : "")
+                    << catalog_string(batch_catalog, catalog_part_for_value(batch_catalog, PART_RESISTOR, pairs[i].r, filter)->sku) << "/"
+                    << catalog_string(batch_catalog, catalog_part_for_value(batch_catalog, PART_CAPACITOR, pairs[i].c, filter)->sku);
+            }
+        }
+        out << "\n";
+    }
+    else if (command == "npv") {
+        if (values.size() != 1 || values[0] <= 0) {
+            out << "error: npv needs one positive resistance\n";
+            return false;
+        }
+        // Optional series name, e.g. "npv 4321 E96", or the nearest resistor in the catalog, "npv 4321 stock"
+        if (take_word(words, "stock")) {
+            return run_part("npv", PART_RESISTOR, values[0], args, out);
+        }
+        ESeries series = E12;
+        if (!words.empty() && !parse_eseries(words[0], series)) {
+            out << "error: unknown series " << words[0] << "\n";
+            return false;
+        }
+        PreferredValue npv = nearest_preferred_value(values[0], series);
+        out << "npv=" << npv.nearest << " down=" << npv.next_down << " up=" << npv.next_up;
+        // E48 and up have three significant digits, so they get a 5-band 1% code
+        int mantissa, exponent;
+        eseries_decimal(series, npv.index, mantissa, exponent);
+        PackedBands bands = series >= E48 ? encode_color_bands(mantissa, exponent, 5, BROWN)
+                                          : encode_color_bands(mantissa, exponent, 3, NO_BAND);
+        if (bands != 0) {
+            out << " bands=";
+            write_color_bands(bands, out);
+        }
+        out << "\n";
+    }
+    else if (command == "pairs") {
+        // Best two-resistor series/parallel combinations, e.g. "pairs 4321 E96 k=3", or "pairs 4321 stock"
+        // to combine the resistors in the catalog
+        ESeries series = E12;
+        if (values.size() != 1 || values[0] <= 0) {
+            out << "error: pairs needs one positive resistance\n";
+            return false;
+        }
+        bool stock = take_word(words, "stock");
+        PartFilter filter;
+        const double* stocked = nullptr;
+        int num_stocked = 0;
+        std::vector<double> scratch;
+        if (stock) {
+            if (!words.empty()) {
+                out << "error: stock replaces the series\n";
+                return false;
+            }
+            if (!stock_filter(args, filter, out)) return false;
+            stocked = catalog_values(batch_catalog, PART_RESISTOR, filter, scratch, num_stocked);
+        }
+        if (!words.empty() && !parse_eseries(words[0], series)) {
+            out << "error: unknown series " << words[0] << "\n";
+            return false;
+        }
+        const int max_pairs = 16;
+        int k = args.count("k") ? static_cast<int>(args["k"]) : 3;
+        if (k < 1 || k > max_pairs) {
+            out << "error: k must be between 1 and " << max_pairs << "\n";
+            return false;
+        }
+        ResistorPair pairs[max_pairs], parallel[max_pairs];
+        int found = stock ? best_series_pairs(values[0], stocked, num_stocked, k, pairs) : best_series_pairs(values[0], series, k, pairs);
+        int found_parallel = stock ? best_parallel_pairs(values[0], stocked, num_stocked, k, parallel)
+                                   : best_parallel_pairs(values[0], series, k, parallel);
+        out << "series=";
+        for (int i = 0; i < found; i++) {
+            out << (i > 0 ? "," : "") << pairs[i].r1 << "+" << pairs[i].r2 << ":" << 100 * pairs[i].error << "%";
+        }
+        out << " parallel=";
+        for (int i = 0; i < found_parallel; i++) {
+            out << (i > 0 ? "," : "") << parallel[i].r1 << "||" << parallel[i].r2 << ":" << 100 * parallel[i].error << "%";
+        }
+        if (stock) {
+            // The cheapest SKU of each value, series pairs first
+            auto sku = [&filter](double value) {
+                return catalog_string(batch_catalog, catalog_part_for_value(batch_catalog, PART_RESISTOR, value, filter)->sku);
+            };
+            out << " skus=";
+            for (int i = 0; i < found; i++) {
+                out << (i > 0 ? "," : "") << sku(pairs[i].r1) << "+" << sku(pairs[i].r2);
+            }
+            for (int i = 0; i < found_parallel; i++) {
+                out << (i > 0 || found > 0 ? "," : "") << sku(parallel[i].r1) << "||" << sku(parallel[i].r2);
+            }
+        }
+        out << "\n";
+    }
+    else if (command == "part") {
+        // Nearest catalog part of a kind, e.g. "part capacitor 47n tolmax=0.05 pricemax=0.1"
+        PartKind kind;
+        if (values.size() != 1 || values[0] <= 0 || words.size() != 1 || !parse_part_kind(words[0], kind)) {
+            out << "error: part needs a kind (resistor, capacitor or opamp) and one positive value\n";
+            return false;
+        }
+        return run_part("part", kind, values[0], args, out);
+    }
+    else if (command == "network") {
+        // Resistor network synthesis, e.g. "network 4321 E24 parts=4 tol=1e-4 ms=200"
+        SynthesisOptions options;
+        if (values.size() != 1 || values[0] <= 0) {
+            out << "error: network needs one positive resistance\n";
+            return false;
+        }
+        if (!words.empty() && !parse_eseries(words[0], options.series)) {
+            out << "error: unknown series " << words[0] << "\n";
+            return false;
+        }
+        if (args.count("parts")) options.max_parts = static_cast<int>(args["parts"]);
+        if (args.count("tol")) options.tolerance = args["tol"];
+        if (args.count("ms")) options.time_budget_ms = args["ms"];
+        options.max_solutions = 1;
+        SynthesisResult result = synthesize_network(values[0], options);
+        if (result.solutions.empty()) {
+            out << "error: no network in range\n";
+            return false;
+        }
+        const NetworkSolution& solution = result.solutions[0];
+        out << "network=\"" << solution.expression << "\" r=" << solution.value << " parts=" << solution.parts
+            << " err=" << solution.error << " met=" << (result.met_tolerance ? 1 : 0) << "\n";
+    }
+    else if (command == "gain") {
+        // Resistor pairs for an op-amp gain, e.g. "gain 10 E96 inverting rmin=1k rmax=100k k=3"
+        ESeries series = E12;
+        bool inverting = true;
+        for (const std::string& word : words) {
+            if (word == "inverting" || word == "non-inverting") {
+                inverting = (word == "inverting");
+            }
+            else if (!parse_eseries(word, series)) {
+                out << "error: unknown option " << word << "\n";
+                return false;
+            }
+        }
+        if (values.size() != 1 || values[0] <= 0 || (!inverting && values[0] <= 1)) {
+            out << "error: gain needs one gain magnitude (above 1 for non-inverting)\n";
+            return false;
+        }
+        const int max_pairs = 16;
+        int k = args.count("k") ? static_cast<int>(args["k"]) : 3;
+        double min_resistance = args.count("rmin") ? args["rmin"] : 1e3;
+        double max_resistance = args.count("rmax") ? args["rmax"] : 1e6;
+        if (k < 1 || k > max_pairs) {
+            out << "error: k must be between 1 and " << max_pairs << "\n";
+            return false;
+        }
+        ResistorRatio pairs[max_pairs];
+        int found = best_ratio_pairs(inverting ? values[0] : values[0] - 1, series,
+                                     min_resistance, max_resistance, k, pairs);
+        if (found == 0) {
+            out << "error: gain not reachable in the resistor range\n";
+            return false;
+        }
+        out << (inverting ? "rf/rin=" : "rf/rg=");
+        for (int i = 0; i < found; i++) {
+            double achieved = inverting ? pairs[i].ratio : 1 + pairs[i].ratio;
+            out << (i > 0 ? "," : "") << pairs[i].numerator << "/" << pairs[i].denominator << ":"
+                << 100 * (achieved - values[0]) / values[0] << "%";
+        }
+        out << "\n";
+    }
+    else if (command == "color") {
+        // 3 to 6 bands, e.g. "color brown black black red brown" (5 band, 1k 1%)
+        int count = static_cast<int>(words.size());
+        if (count < MIN_BANDS || count > MAX_BANDS) {
+            out << "error: color needs " << MIN_BANDS << " to " << MAX_BANDS << " bands\n";
+            return false;
+        }
+        BandColor bands[MAX_BANDS];
+        for (int i = 0; i < count; i++) {
+            bands[i] = parse_band_color(words[i]);
+        }
+        ResistorCode code;
+        if (!decode_color_bands(pack_color_bands(bands, count), code)) {
+            out << "error: invalid color code\n";
+            return false;
+        }
+        out << "r=" << code.resistance;
+        if (count > MIN_BANDS) {
+            out << " tol=" << 100 * code.tolerance << "%";
+        }
+        if (code.tempco > 0) {
+            out << " tempco=" << code.tempco;
+        }
+        out << "\n";
+    }
+    else if (command == "bands") {
+        // Colour codes of a list of resistances, e.g. "bands 4k7 8k2 n=5 brown"
+        int num_bands = args.count("n") ? static_cast<int>(args["n"]) : 3;
+        BandColor tolerance = num_bands == 3 ? NO_BAND : GOLD;
+        if (words.size() > 1 || (!words.empty() && (tolerance = parse_band_color(words[0])) == INVALID_COLOR)) {
+            out << "error: bands takes one tolerance colour\n";
+            return false;
+        }
+        std::vector<PackedBands> codes(values.size());
+        int count = static_cast<int>(values.size());
+        if (count == 0 || encode_color_bands(values.data(), count, num_bands, tolerance, codes.data()) != count) {
+            out << "error: bands needs resistances with a 3, 4 or 5 band code\n";
+            return false;
+        }
+        for (int i = 0; i < count; i++) {
+            out << "r=" << values[i] << " bands=";
+            write_color_bands(codes[i], out);
+            out << "\n";
+        }
+    }
+    else if (command == "combine") {
+        // Series/parallel network as an expression or JSON tree, with optional named parts:
+        // "combine (R1 + R2) || 22k R1=4k7 R2=10k", "combine {"series": ["4k7", {"parallel": [10e3, "22k"]}]}"
+        std::istringstream rest(line);
+        std::string token, text;
+        rest >> token;
+        while (rest >> token) {
+            if (token.find('=') == std::string::npos) {
+                text += text.empty() ? token : " " + token;
+            }
+        }
+        ResistorNetwork network;
+        std::string error;
+        bool parsed = !text.empty() && text[0] == '{' ? parse_network_json(text, args, network, error)
+                                                      : parse_network_expression(text, args, network, error);
+        if (!parsed) {
+            out << "error: " << error << "\n";
+            return false;
+        }
+        out << "r=" << evaluate_network(network) << " parts=" << network.parts << "\n";
+    }
+    else if (command == "dc" || command == "dc-req") {
+        // Netlist file analysis, e.g. "dc bridge.cir a b R5 V1" prints v(a), v(b), i(R5), i(V1);
+        // "dc-req bridge.cir a b" prints the resistance between a and b
+        words = bare_tokens(line);
+        if (words.empty()) {
+            out << "error: " << command << " needs a netlist file\n";
+            return false;
+        }
+        std::ifstream file(words[0]);
+        DcCircuit circuit;
+        std::string error;
+        if (!file) {
+            out << "error: cannot open " << words[0] << "\n";
+            return false;
+        }
+        if (!parse_dc_netlist(file, circuit, error)) {
+            out << "error: " << error << "\n";
+            return false;
+        }
+        DcOptions options;
+        options.num_threads = args.count("threads") ? static_cast<int>(args["threads"]) : 0;
+        if (command == "dc-req") {
+            int a = words.size() == 3 ? dc_node(circuit, words[1]) : -1;
+            int b = words.size() == 3 ? dc_node(circuit, words[2]) : -1;
+            if (a < 0 || b < 0) {
+                out << "error: dc-req needs two nodes of the netlist\n";
+                return false;
+            }
+            DcSolveInfo info;
+            double resistance = dc_equivalent_resistance(circuit, a, b, options, &info);
+            out << "r=" << resistance << " unknowns=" << info.unknowns << " iterations=" << info.iterations << "\n";
+            return resistance >= 0;
+        }
+        // Every name must be a node or an element, checked before anything is printed
+        for (size_t i = 1; i < words.size(); i++) {
+            const std::string& name = words[i];
+            bool found = dc_node(circuit, name) >= 0;
+            for (size_t k = 0; k < circuit.resistors.size() && !found; k++) found = circuit.resistors[k].name == name;
+            for (size_t k = 0; k < circuit.voltage_sources.size() && !found; k++) found = circuit.voltage_sources[k].name == name;
+            for (size_t k = 0; k < circuit.current_sources.size() && !found; k++) found = circuit.current_sources[k].name == name;
+            if (!found) {
+                out << "error: no node or element " << name << "\n";
+                return false;
+            }
+        }
+        DcSolution solution = solve_dc(circuit, options);
+        if (!solution.solved) {
+            out << "error: " << solution.error << "\n";
+            return false;
+        }
+        for (size_t i = 1; i < words.size(); i++) {
+            const std::string& name = words[i];
+            int node = dc_node(circuit, name);
+            if (node >= 0) {
+                out << "v(" << name << ")=" << solution.node_voltages[node] << " ";
+                continue;
+            }
+            double current = 0;
+            bool found = false;
+            for (size_t k = 0; k < circuit.resistors.size() && !found; k++) {
+                found = circuit.resistors[k].name == name;
+                current = solution.resistor_currents[k];
+            }
+            for (size_t k = 0; k < circuit.voltage_sources.size() && !found; k++) {
+                found = circuit.voltage_sources[k].name == name;
+                current = solution.voltage_source_currents[k];
+            }
+            for (size_t k = 0; k < circuit.current_sources.size() && !found; k++) {
+                found = circuit.current_sources[k].name == name;
+                current = circuit.current_sources[k].current;
+            }
+            out << "i(" << name << ")=" << current << " ";
+        }
+        out << "unknowns=" << solution.info.unknowns << " iterations=" << solution.info.iterations
+            << " solver=" << (solution.info.direct ? "direct" : "pcg") << "\n";
+    }
+    else if (command == "ac") {
+        // Small-signal sweep of a netlist, e.g. "ac filter.cir out from=10 to=1M points=1000";
+        // a second node makes the response v(out) / v(in) instead of v(out)
+        words = bare_tokens(line);
+        if (words.size() < 2 || words.size() > 3) {
+            out << "error: ac needs a netlist file, an output node and optionally an input node\n";
+            return false;
+        }
+        std::ifstream file(words[0]);
+        AcCircuit circuit;
+        std::string error;
+        if (!file) {
+            out << "error: cannot open " << words[0] << "\n";
+            return false;
+        }
+        if (!parse_ac_netlist(file, circuit, error)) {
+            out << "error: " << error << "\n";
+            return false;
+        }
+        int probes[2] = { ac_node(circuit, words[1]), words.size() == 3 ? ac_node(circuit, words[2]) : 0 };
+        if (probes[0] < 0 || probes[1] < 0) {
+            out << "error: no node " << (probes[0] < 0 ? words[1] : words[2]) << "\n";
+            return false;
+        }
+        double start = args.count("from") ? args["from"] : 10;
+        double stop = args.count("to") ? args["to"] : 1e6;
+        double points = args.count("points") ? args["points"] : 1000;
+        if (start <= 0 || stop <= start || points < 2 || points > BATCH_MAX_POINTS) {
+            out << "error: ac needs 0 < from < to and 2 to " << BATCH_MAX_POINTS << " points\n";
+            return false;
+        }
+        AcSystem system;
+        if (!build_ac_system(circuit, std::sqrt(start * stop), system, error)) {
+            out << "error: " << error << "\n";
+            return false;
+        }
+        int num_points = static_cast<int>(points);
+        std::vector<double> freq(num_points), magnitude(num_points), phase(num_points);
+        std::vector<std::complex<double>> response(2 * static_cast<size_t>(num_points));
+        log_frequencies(start, stop, num_points, freq.data());
+        AcOptions options;
+        options.num_threads = args.count("threads") ? static_cast<int>(args["threads"]) : 0;
+        int fallbacks = ac_sweep(system, freq.data(), num_points, probes, 2, response.data(), options);
+        if (fallbacks < 0) {
+            out << "error: circuit is singular at some frequencies\n";
+            return false;
+        }
+
+        // Phase is unwrapped along the sweep so it reads like the filter sweeps
+        int peak = 0;
+        for (int i = 0; i < num_points; i++) {
+            std::complex<double> value = response[2 * i];
+            if (words.size() == 3) {
+                value /= response[2 * i + 1];
+            }
+            magnitude[i] = 20 * std::log10(std::abs(value));
+            phase[i] = std::arg(value) * 180 / PI;
+            if (i > 0) {
+                phase[i] -= 360 * std::round((phase[i] - phase[i - 1]) / 360);
+            }
+            if (magnitude[i] > magnitude[peak]) peak = i;
+        }
+        int upper = peak, lower = peak;
+        while (upper < num_points && magnitude[upper] > magnitude[peak] - 3) upper++;
+        while (lower >= 0 && magnitude[lower] > magnitude[peak] - 3) lower--;
+        out << "unknowns=" << system.unknowns << " points=" << num_points
+            << " peak_db=" << magnitude[peak] << " peak_f=" << freq[peak];
+        if (lower >= 0) {
+            out << " f3db_low=" << freq[lower];
+        }
+        if (upper < num_points) {
+            out << " f3db=" << freq[upper];
+        }
+        out << " phase_end=" << phase[num_points - 1] << " fallback=" << fallbacks << "\n";
+    }
+    else if (command == "inverting") {
+        if (!require(args, "vin", vin, out) || !require(args, "rf", rf, out) || !require(args, "rin", rin, out)) return false;
+        OpAmpResult result = inverting_amplifier(vin, rf, rin);
+        out << "gain=" << result.gain << " vout=" << result.output_voltage << "\n";
+    }
+    else if (command == "non-inverting") {
+        if (!require(args, "vin", vin, out) || !require(args, "rf", rf, out) || !require(args, "rg", rin, out)) return false;
+        OpAmpResult result = non_inverting_amplifier(vin, rf, rin);
+        out << "gain=" << result.gain << " vout=" << result.output_voltage << "\n";
+    }
+    else if (command == "series" || command == "parallel") {
+        int count = static_cast<int>(values.size());
+        double total = (command == "series") ? series_resistance(values.data(), count)
+                                             : parallel_resistance(values.data(), count);
+        if (total < 0) {
+            out << "error: " << command << " needs positive resistances\n";
+            return false;
+        }
+        out << "r=" << total << "\n";
+    }
+    else if (command == "sallen-key") {
+        return run_sallen_key(words, args, out);
+    }
+    else if (command == "sallen-key-opt") {
+        return run_sallen_key_opt(words, args, out);
+    }
+    else if (command == "sweep") {
+        return run_sweep(words, args, out);
+    }
+    else if (command == "tolerance") {
+        return run_tolerance(words, args, out);
+    }
+    else if (command == "cache-stats") {
+        ResultCacheStats stats = batch_cache().stats();
+        long long lookups = stats.hits + stats.misses;
+        out << "hits=" << stats.hits << " misses=" << stats.misses
+            << " hit_rate=" << (lookups > 0 ? static_cast<double>(stats.hits) / lookups : 0)
+            << " insertions=" << stats.insertions << " evictions=" << stats.evictions
+            << " entries=" << stats.entries << " bytes=" << stats.bytes << " capacity=" << batch_cache().capacity();
+        if (batch_memo_open) {
+            MemoStoreStats memo = batch_memo().stats();
+            out << " memo_hits=" << memo.hits << " memo_misses=" << memo.misses << " memo_appends=" << memo.appends
+                << " memo_entries=" << memo.entries << " memo_bytes=" << memo.bytes;
+        }
+        out << "\n";
+    }
+    else {
+        out << "error: unknown command '" << command << "'\n";
+        return false;
+    }
+    return true;
+}
+
+bool run_batch_line(const std::string& line, std::ostream& out) {
+    ResultCache& cache = batch_cache();
+    bool use_cache = cache.capacity() > 0, use_memo = batch_memo_open;
+    std::string key;
+    if (!(use_cache || use_memo) || !batch_cache_key(line, key)) {
+        return run_request(line, out);
+    }
+    std::string result;
+    if (use_cache && cache.find(key, result)) {
+        out << result;
+        return true;
+    }
+    bool memoised = use_memo && memo_worthy(key);
+    if (memoised && batch_memo().find(key, result)) {
+        if (use_cache) {
+            cache.insert(key, result);
+        }
+        out << result;
+        return true;
+    }
+    // Only successful results are kept; errors are cheap and not worth the space
+    std::ostringstream text;
+    bool ok = run_request(line, text);
+    result = text.str();
+    if (ok && use_cache) {
+        cache.insert(key, result);
+    }
+    if (ok && memoised) {
+        batch_memo().append(key, result);
+    }
+    out << result;
+    return ok;
+}
+
+void set_batch_cache_capacity(size_t bytes) {
+    batch_cache().set_capacity(bytes);
+}
+
+ResultCacheStats batch_cache_stats() {
+    return batch_cache().stats();
+}
+
+bool open_batch_memo(const std::string& path, std::string& error) {
+    batch_memo_open = batch_memo().open(path, BATCH_MEMO_VERSION, error);
+    return batch_memo_open;
+}
+
+MemoStoreStats batch_memo_stats() {
+    return batch_memo().stats();
+}
+
+bool open_batch_catalog(const std::string& path, std::string& error) {
+    return open_catalog(path, batch_catalog, error);
+}
+
+int run_batch(std::istream& in, std::ostream& out) {
+    std::string line;
+    int errors = 0;
+    while (std::getline(in, line)) {
+        // Skip blank lines and comments
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        if (!run_batch_line(line, out)) {
+            ++errors;
+        }
+    }
+    return errors;
+}
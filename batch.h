@@ -0,0 +1,32 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <iostream>
+#include <string>
+#include "memo_store.h"
+#include "result_cache.h"
+
+// Batch mode: one calculation request per input line, one result line per request.
+// Runs the same calculations as the menus but never touches std::cin or clearscreen().
+int run_batch(std::istream& in, std::ostream& out);
+bool run_batch_line(const std::string& line, std::ostream& out);
+
+// Successful results are kept in a sharded LRU cache keyed on the parsed request, so a
+// repeated query ("npv 4k7 E96" or "npv 4700 E96") is answered without recomputing.
+// Netlist requests, which read files, and the time-limited network search always run.
+// The "cache-stats" request prints the counters.
+void set_batch_cache_capacity(size_t bytes); // 0 turns the cache off
+ResultCacheStats batch_cache_stats();
+
+// Optional on-disk memo (see memo_store.h) behind the cache for the expensive requests:
+// pairs, rc-pairs, gain, sallen-key, sallen-key-opt and tolerance. Every process opened
+// on the same file shares its results, and a warm start skips the searches.
+bool open_batch_memo(const std::string& path, std::string& error);
+MemoStoreStats batch_memo_stats();
+
+// Parts catalog (see catalog.h) for requests limited to real parts: "npv <ohms> stock",
+// "pairs <ohms> stock", "rc-pairs fc=<Hz> stock" and "part <kind> <value>", filtered by
+// qtymin, tolmax and pricemax. Open it before running any request.
+bool open_batch_catalog(const std::string& path, std::string& error);
+
+#endif
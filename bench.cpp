@@ -0,0 +1,597 @@
+// Enginuity benchmarks: micro-benchmarks of the calculation kernels behind the menus
+// plus a few batch-sized workloads. Not part of the main program; build it with
+//   make bench
+//
+//   ./bench [--format json|csv] [--filter text] [--min-time ms]
+//           [--baseline file] [--threshold percent]
+//
+// Each line of output is one benchmark with ns/op, ops/s and heap allocations per op.
+// --baseline reads an earlier run (either format) and flags every benchmark that got
+// more than --threshold percent (default 10) slower; the exit code is 1 if any did.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "ac_solver.h"
+#include "calc.h"
+#include "catalog.h"
+#include "cli.h"
+#include "color_code.h"
+#include "dc_solver.h"
+#include "eseries.h"
+#include "network.h"
+#include "npv_search.h"
+#include "filter_design.h"
+#include "response.h"
+#include "rows.h"
+#include "si_value.h"
+#include "tolerance.h"
+#include "batch.h"
+
+// Heap allocation counter: every operator new in the process goes through here
+static std::atomic<long long> allocation_count(0);
+
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* block = std::malloc(size ? size : 1)) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept {
+    std::free(block);
+}
+
+// Keeps the compiler from dropping a result it can see is unused
+template <typename T>
+static void keep(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+struct Benchmark {
+    std::string name;
+    std::function<void(long long)> run; // runs the operation this many times
+};
+
+struct Measurement {
+    std::string name;
+    long long iterations;
+    double ns_per_op;
+    double ops_per_second;
+    double allocations_per_op;
+};
+
+// Inputs that change from one iteration to the next, spread over the usual ranges
+static std::vector<double> log_spread(int count, double low, double high) {
+    std::vector<double> values(count);
+    unsigned state = 12345;
+    for (int i = 0; i < count; i++) {
+        state = state * 1103515245u + 12345u;
+        double position = (state >> 8) / 16777216.0;
+        values[i] = low * std::pow(high / low, position);
+    }
+    return values;
+}
+
+// Function to create an empty file with a unique name under $TMPDIR (or /tmp), so runs
+// side by side don't share files; the caller removes it
+static std::string temporary_file(const char* name) {
+    const char* dir = std::getenv("TMPDIR");
+    std::string path = std::string(dir && *dir ? dir : "/tmp") + "/" + name + "-XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        std::cerr << "bench: cannot create " << path << ": " << std::strerror(errno) << "\n";
+        std::exit(1);
+    }
+    close(fd);
+    return path;
+}
+
+static const int INPUT_COUNT = 1024; // power of two, inputs are picked with i & (INPUT_COUNT - 1)
+
+static std::vector<Benchmark> make_benchmarks() {
+    std::vector<Benchmark> benchmarks;
+    static const std::vector<double> resistances = log_spread(INPUT_COUNT, 1, 10e6);
+    static const std::vector<double> capacitances = log_spread(INPUT_COUNT, 10e-12, 100e-6);
+    static const std::vector<double> frequencies = log_spread(INPUT_COUNT, 10, 1e6);
+    const int mask = INPUT_COUNT - 1;
+
+    // Preferred values (get_npv_and_color_code_for_resistor, find_nearest_npv_resistor)
+    benchmarks.push_back({ "npv/nearest_e12", [](long long n) {
+        for (long long i = 0; i < n; i++) keep(nearest_preferred_value(resistances[i & mask], E12));
+    } });
+    benchmarks.push_back({ "npv/nearest_e96", [](long long n) {
+        for (long long i = 0; i < n; i++) keep(nearest_preferred_value(resistances[i & mask], E96));
+    } });
+    benchmarks.push_back({ "npv/npv_and_color_code", [](long long n) {
+        for (long long i = 0; i < n; i++) keep(npv_and_color_code(resistances[i & mask]));
+    } });
+    // Parts catalog: every E96 value, 100 SKUs of each, half of them stocked
+    static PartsCatalog& catalog = []() -> PartsCatalog& {
+        static PartsCatalog mapped;
+        std::ostringstream csv;
+        int n;
+        const double* e96 = eseries_values(E96, n);
+        for (int sku = 0; sku < 100; sku++) {
+            for (int i = 0; i < n; i++) {
+                csv << "R,R" << sku << "-" << i << "," << e96[i] << ",1%,0603," << 0.001 * (1 + sku % 7) << "," << (sku % 2) * 100 << "\n";
+            }
+        }
+        std::istringstream in(csv.str());
+        std::string path = temporary_file("enginuity-bench-parts");
+        long long count;
+        std::string error;
+        build_catalog(in, path, count, error);
+        open_catalog(path, mapped, error);
+        std::remove(path.c_str()); // the mapping stays valid
+        return mapped;
+    }();
+    benchmarks.push_back({ "npv/nearest_catalog_stocked", [](long long n) {
+        PartFilter filter;
+        for (long long i = 0; i < n; i++) keep(nearest_catalog_part(catalog, PART_RESISTOR, resistances[i & mask], filter));
+    } });
+    benchmarks.push_back({ "pairs/series_catalog_k3", [](long long n) {
+        PartFilter filter;
+        std::vector<double> scratch;
+        int count;
+        const double* values = catalog_values(catalog, PART_RESISTOR, filter, scratch, count);
+        ResistorPair best[3];
+        for (long long i = 0; i < n; i++) keep(best_series_pairs(resistances[i & mask], values, count, 3, best));
+    } });
+    benchmarks.push_back({ "pairs/series_e24_k3", [](long long n) {
+        ResistorPair best[3];
+        for (long long i = 0; i < n; i++) keep(best_series_pairs(resistances[i & mask], E24, 3, best));
+    } });
+    benchmarks.push_back({ "pairs/parallel_e24_k3", [](long long n) {
+        ResistorPair best[3];
+        for (long long i = 0; i < n; i++) keep(best_parallel_pairs(resistances[i & mask], E24, 3, best));
+    } });
+    benchmarks.push_back({ "pairs/ratio_e96_k3", [](long long n) {
+        ResistorRatio best[3];
+        for (long long i = 0; i < n; i++) {
+            keep(best_ratio_pairs(1 + resistances[i & mask] * 1e-6, E96, 1e3, 1e6, 3, best));
+        }
+    } });
+
+    // Colour codes
+    benchmarks.push_back({ "color/decode", [](long long n) {
+        static const std::string bands[][3] = {
+            { "brown", "black", "red" }, { "yellow", "violet", "orange" },
+            { "red", "red", "gold" }, { "blue", "gray", "silver" }
+        };
+        for (long long i = 0; i < n; i++) {
+            const std::string* code = bands[i & 3];
+            keep(resistance_from_color_bands(code[0], code[1], code[2]));
+        }
+    } });
+    benchmarks.push_back({ "color/decode_packed_bulk_1024", [](long long n) {
+        static PackedBands codes[INPUT_COUNT];
+        static ResistorCode decoded[INPUT_COUNT];
+        for (int i = 0; i < INPUT_COUNT; i++) {
+            BandColor bands[] = { static_cast<BandColor>(1 + i % 9), static_cast<BandColor>(i % 10),
+                                  static_cast<BandColor>(i / 10 % 10), static_cast<BandColor>(i % 7), BROWN, RED };
+            codes[i] = pack_color_bands(bands, 3 + i % 4);
+        }
+        for (long long i = 0; i < n; i++) keep(decode_color_bands(codes, INPUT_COUNT, decoded));
+    } });
+    benchmarks.push_back({ "color/encode", [](long long n) {
+        ColorBands bands;
+        for (long long i = 0; i < n; i++) keep(resistor_color_bands(resistances[i & mask], bands));
+    } });
+    benchmarks.push_back({ "color/encode_packed_bulk_1024", [](long long n) {
+        static PackedBands codes[INPUT_COUNT];
+        for (long long i = 0; i < n; i++) keep(encode_color_bands(resistances.data(), INPUT_COUNT, 4, GOLD, codes));
+    } });
+
+    // SI value parsing, shared by batch lines, netlists and the menus
+    benchmarks.push_back({ "parse/si_value", [](long long n) {
+        static const char* const texts[] = { "4k7", "2.2M", "100n", "47pF", "1.5kHz", "10 \xCE\xA9", "1e-6", "470R" };
+        static size_t lengths[8];
+        for (int i = 0; i < 8; i++) lengths[i] = std::strlen(texts[i]);
+        double value;
+        for (long long i = 0; i < n; i++) {
+            parse_si_value(texts[i & 7], texts[i & 7] + lengths[i & 7], value);
+            keep(value);
+        }
+    } });
+
+    // Network expressions (combine_resistors): a 1024-rung R-2R ladder
+    benchmarks.push_back({ "network/ladder_1024", [](long long n) {
+        static const std::string ladder = [] {
+            std::string text = "2k";
+            for (int i = 0; i < 1024; i++) text = "1k+(2k||(" + text + "))";
+            return text;
+        }();
+        static const std::map<std::string, double> no_names;
+        ResistorNetwork network;
+        std::string error;
+        for (long long i = 0; i < n; i++) {
+            parse_network_expression(ladder, no_names, network, error);
+            keep(evaluate_network(network));
+        }
+    } });
+
+    // RC solves
+    benchmarks.push_back({ "rc/cutoff", [](long long n) {
+        for (long long i = 0; i < n; i++) keep(calculate_cutoff_frequency(resistances[i & mask], capacitances[i & mask]));
+    } });
+    benchmarks.push_back({ "rc/required_r", [](long long n) {
+        for (long long i = 0; i < n; i++) keep(required_resistance(capacitances[i & mask], frequencies[i & mask]));
+    } });
+    benchmarks.push_back({ "rc/required_c", [](long long n) {
+        for (long long i = 0; i < n; i++) keep(required_capacitance(resistances[i & mask], frequencies[i & mask]));
+    } });
+    benchmarks.push_back({ "rc/best_pairs_e24_e12_k3", [](long long n) {
+        RcPair best[3];
+        for (long long i = 0; i < n; i++) {
+            keep(best_rc_pairs(frequencies[i & mask], E24, E12, 1e3, 1e6, 100e-12, 10e-6, 3, best));
+        }
+    } });
+
+    // Sallen-Key stages
+    benchmarks.push_back({ "sallen_key/stage", [](long long n) {
+        PolePairData pairs[MAX_POLE_PAIRS];
+        int count = pole_table(CHEBYSHEV_0_5DB, 6, pairs);
+        for (long long i = 0; i < n; i++) {
+            keep(sallen_key_stage(pairs[i % count], resistances[i & mask], capacitances[i & mask], 10e3));
+        }
+    } });
+    benchmarks.push_back({ "sallen_key/design_6_pole", [](long long n) {
+        for (long long i = 0; i < n; i++) {
+            keep(sallen_key_design(0.5, 6, resistances[i & mask], capacitances[i & mask], 10e3));
+        }
+    } });
+    benchmarks.push_back({ "sallen_key/design_9_pole_1db", [](long long n) {
+        for (long long i = 0; i < n; i++) {
+            keep(sallen_key_design(1, 9, resistances[i & mask], capacitances[i & mask], 10e3));
+        }
+    } });
+
+    // Larger workloads
+    benchmarks.push_back({ "macro/sweep_6_pole_100k_points", [](long long n) {
+        static std::vector<double> freq(100000), magnitude(100000), phase(100000), delay(100000);
+        StageSet stages = ideal_filter_stages(6, 0.5, 1e3, false);
+        log_frequencies(10, 100e3, 100000, freq.data());
+        for (long long i = 0; i < n; i++) {
+            sweep_response(stages, freq.data(), 100000, magnitude.data(), phase.data(), delay.data());
+            keep(magnitude[i % 100000]);
+        }
+    } });
+    benchmarks.push_back({ "macro/tolerance_sallen_key_100k", [](long long n) {
+        MonteCarloOptions options;
+        options.num_threads = 1;
+        for (long long i = 0; i < n; i++) {
+            options.seed = static_cast<unsigned long long>(i);
+            keep(monte_carlo_sallen_key(10e3, 10e-9, 12e3, 10e3, false, MetricSpec(), MetricSpec(), options).yield);
+        }
+    } });
+    benchmarks.push_back({ "macro/cascade_opt_butterworth_4", [](long long n) {
+        CascadeOptions options;
+        options.num_poles = 4;
+        options.num_threads = 1;
+        for (long long i = 0; i < n; i++) {
+            options.cutoff_freq = frequencies[i & mask];
+            keep(optimise_sallen_key_cascade(options).total_error);
+        }
+    } });
+    benchmarks.push_back({ "macro/dc_grid_300x300", [](long long n) {
+        // 1 ohm mesh driven at one corner and loaded at the other, solved by PCG
+        static const DcCircuit grid = []() {
+            const int side = 300;
+            DcCircuit circuit;
+            circuit.num_nodes = side * side + 1;
+            for (int i = 0; i < side; i++) {
+                for (int j = 0; j < side; j++) {
+                    int node = 1 + i * side + j;
+                    if (j + 1 < side) circuit.resistors.push_back({ node, node + 1, 1.0, "" });
+                    if (i + 1 < side) circuit.resistors.push_back({ node, node + side, 1.0, "" });
+                }
+            }
+            circuit.voltage_sources.push_back({ 1, 0, 1.0, "V1" });
+            circuit.resistors.push_back({ side * side, 0, 1.0, "RL" });
+            return circuit;
+        }();
+        DcOptions options;
+        options.method = DC_PCG;
+        options.num_threads = 1;
+        for (long long i = 0; i < n; i++) keep(solve_dc(grid, options).voltage_source_currents[0]);
+    } });
+    benchmarks.push_back({ "macro/ac_sweep_sallen_key_1000", [](long long n) {
+        // Two-stage Sallen-Key low-pass with single-pole op-amps, 1000 points on one thread
+        static const AcCircuit circuit = []() {
+            std::istringstream netlist("V1 in 0 AC 1\n"
+                                       "R1 in a 10k\nR2 a b 10k\nC1 a m 30.6n\nC2 b 0 8.3n\nO1 m b m 200k 1M\n"
+                                       "R3 m c 10k\nR4 c d 10k\nC3 c out 13.1n\nC4 d 0 19.3n\nO2 out d out 200k 1M\n");
+            AcCircuit parsed;
+            std::string error;
+            parse_ac_netlist(netlist, parsed, error);
+            return parsed;
+        }();
+        static const AcSystem system = []() {
+            AcSystem built;
+            std::string error;
+            build_ac_system(circuit, 1000, built, error);
+            return built;
+        }();
+        static std::vector<double> freq(1000);
+        static std::vector<std::complex<double>> voltage(1000);
+        log_frequencies(10, 1e5, 1000, freq.data());
+        AcOptions options;
+        options.num_threads = 1;
+        int probe = ac_node(circuit, "out");
+        for (long long i = 0; i < n; i++) {
+            ac_sweep(system, freq.data(), 1000, &probe, 1, voltage.data(), options);
+            keep(voltage[999].real());
+        }
+    } });
+    // The same 1000 lines computed every time, then answered from the result cache
+    static const std::string mixed_jobs = []() {
+        static const char* const templates[] = {
+            "rc-cutoff r=%g c=10n", "npv %g E96", "pairs %g E24", "color yellow violet red",
+            "gain %g E24 non-inverting", "sallen-key cheb0.5 poles=4 r=%g c=10n rb=10k",
+            "series %g 4k7 220", "rc-c r=%g fc=1k"
+        };
+        std::string text;
+        char line[128];
+        for (int i = 0; i < 1000; i++) {
+            std::snprintf(line, sizeof(line), templates[i % 8], 1 + resistances[i & 1023] / 1e3);
+            text += line;
+            text += '\n';
+        }
+        return text;
+    }();
+    benchmarks.push_back({ "macro/batch_mixed_1000_lines", [](long long n) {
+        set_batch_cache_capacity(0);
+        for (long long i = 0; i < n; i++) {
+            std::istringstream in(mixed_jobs);
+            std::ostringstream out;
+            keep(run_batch(in, out));
+        }
+        set_batch_cache_capacity(64 << 20);
+    } });
+    benchmarks.push_back({ "macro/batch_mixed_1000_lines_cached", [](long long n) {
+        for (long long i = 0; i < n; i++) {
+            std::istringstream in(mixed_jobs);
+            std::ostringstream out;
+            keep(run_batch(in, out));
+        }
+    } });
+    benchmarks.push_back({ "macro/rows_npv_100k", [](long long n) {
+        // BOM-style CSV rows through the chunked row executor, same rows as a batch npv would take
+        static const std::string rows = []() {
+            std::string text;
+            char line[64];
+            for (int i = 0; i < 100000; i++) {
+                text.append(line, std::snprintf(line, sizeof(line), "R%d,%.4g,0603\n", i, resistances[i & mask]));
+            }
+            return text;
+        }();
+        RowOptions options;
+        options.columns = { 2 };
+        std::string error;
+        default_row_fields(options, error);
+        for (long long i = 0; i < n; i++) {
+            std::ostringstream out;
+            RowStats stats;
+            run_rows(rows.data(), rows.size(), options, out, stats);
+            keep(stats.rows);
+        }
+    } });
+    benchmarks.push_back({ "cache/hit_1000_entries", [](long long n) {
+        static ResultCache cache(1 << 20);
+        static std::vector<std::string> keys = []() {
+            std::vector<std::string> list;
+            for (int i = 0; i < 1000; i++) {
+                list.push_back("npv#" + std::to_string(resistances[i]));
+                cache.insert(list.back(), "npv=4700 down=4640 up=4750");
+            }
+            return list;
+        }();
+        std::string value;
+        for (long long i = 0; i < n; i++) {
+            keep(cache.find(keys[i % 1000], value));
+        }
+    } });
+    benchmarks.push_back({ "cache/memo_hit_1000_entries", [](long long n) {
+        static MemoStore memo;
+        static std::vector<std::string> keys = []() {
+            std::string path = temporary_file("enginuity-bench-memo");
+            std::string error;
+            memo.open(path, 1, error);
+            std::vector<std::string> list;
+            for (int i = 0; i < 1000; i++) {
+                list.push_back("pairs#" + std::to_string(resistances[i]));
+                memo.append(list.back(), "series=300+3000:0%,1100+2200:0%,1300+2000:0%");
+            }
+            // Hits only read the mapping, so the files can go now
+            std::remove(path.c_str());
+            std::remove((path + ".lock").c_str());
+            return list;
+        }();
+        std::string value;
+        for (long long i = 0; i < n; i++) {
+            keep(memo.find(keys[i % 1000], value));
+        }
+    } });
+    benchmarks.push_back({ "macro/cli_rc_cutoff", [](long long n) {
+        // One-shot command as a build script runs it, minus process startup
+        static const char* const argv[] = { "rc", "cutoff", "--r", "10k", "--c", "100n" };
+        std::ostringstream out, err;
+        for (long long i = 0; i < n; i++) {
+            out.str("");
+            keep(run_cli(6, argv, out, err));
+        }
+    } });
+    return benchmarks;
+}
+
+// Function to time one benchmark: grow the iteration count until a run takes min_time,
+// then take the median of five runs of that size
+static Measurement measure(const Benchmark& benchmark, double min_time_ms) {
+    using clock = std::chrono::steady_clock;
+    auto timed = [&benchmark](long long iterations) {
+        auto start = clock::now();
+        benchmark.run(iterations);
+        return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    };
+
+    long long iterations = 1;
+    double elapsed = timed(iterations);
+    while (elapsed < min_time_ms && iterations < (1LL << 40)) {
+        double scale = elapsed > 0 ? 1.2 * min_time_ms / elapsed : 100;
+        iterations = static_cast<long long>(iterations * std::min(100.0, std::max(2.0, scale)));
+        elapsed = timed(iterations);
+    }
+
+    double runs[5];
+    long long allocations = 0;
+    for (int r = 0; r < 5; r++) {
+        long long before = allocation_count.load();
+        runs[r] = timed(iterations);
+        allocations += allocation_count.load() - before;
+    }
+    std::sort(runs, runs + 5);
+
+    Measurement result;
+    result.name = benchmark.name;
+    result.iterations = iterations;
+    result.ns_per_op = runs[2] * 1e6 / iterations;
+    result.ops_per_second = result.ns_per_op > 0 ? 1e9 / result.ns_per_op : 0;
+    result.allocations_per_op = static_cast<double>(allocations) / (5.0 * iterations);
+    return result;
+}
+
+// Function to read name -> ns/op from an earlier run in either output format
+static std::map<std::string, double> read_baseline(const std::string& path) {
+    std::map<std::string, double> baseline;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t name_start = line.find("\"name\": \"");
+        if (name_start != std::string::npos) {
+            name_start += 9;
+            size_t name_end = line.find('"', name_start);
+            size_t ns_start = line.find("\"ns_per_op\": ");
+            if (name_end != std::string::npos && ns_start != std::string::npos) {
+                baseline[line.substr(name_start, name_end - name_start)] = std::atof(line.c_str() + ns_start + 13);
+            }
+            continue;
+        }
+        size_t comma = line.find(',');
+        if (comma != std::string::npos && line.compare(0, comma, "name") != 0) {
+            baseline[line.substr(0, comma)] = std::atof(line.c_str() + line.find(',', comma + 1) + 1);
+        }
+    }
+    return baseline;
+}
+
+int main(int argc, char const* argv[]) {
+    std::string format = "json", filter, baseline_path;
+    double min_time_ms = 100, threshold = 10;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--format" && has_value) format = argv[++i];
+        else if (arg == "--filter" && has_value) filter = argv[++i];
+        else if (arg == "--min-time" && has_value) min_time_ms = std::atof(argv[++i]);
+        else if (arg == "--baseline" && has_value) baseline_path = argv[++i];
+        else if (arg == "--threshold" && has_value) threshold = std::atof(argv[++i]);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--format json|csv] [--filter text] [--min-time ms]"
+                      << " [--baseline file] [--threshold percent]\n";
+            return 2;
+        }
+    }
+    if (format != "json" && format != "csv") {
+        std::cerr << "Unknown format " << format << "\n";
+        return 2;
+    }
+    std::map<std::string, double> baseline;
+    if (!baseline_path.empty()) {
+        baseline = read_baseline(baseline_path);
+        if (baseline.empty()) {
+            std::cerr << "No benchmarks in baseline " << baseline_path << "\n";
+            return 2;
+        }
+    }
+
+    bool json = (format == "json");
+    bool first = true;
+    int regressions = 0;
+    if (json) {
+        std::cout << "[\n";
+    }
+    else {
+        std::cout << "name,iterations,ns_per_op,ops_per_sec,allocs_per_op"
+                  << (baseline.empty() ? "" : ",baseline_ns_per_op,change_pct,regression") << "\n";
+    }
+    for (const Benchmark& benchmark : make_benchmarks()) {
+        if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        Measurement m = measure(benchmark, min_time_ms);
+        auto old = baseline.find(m.name);
+        bool compared = old != baseline.end() && old->second > 0;
+        double change = compared ? 100 * (m.ns_per_op - old->second) / old->second : 0;
+        bool regression = compared && change > threshold;
+        regressions += regression ? 1 : 0;
+
+        if (json) {
+            std::cout << (first ? "" : ",\n") << "  {\"name\": \"" << m.name << "\", \"iterations\": " << m.iterations
+                      << ", \"ns_per_op\": " << m.ns_per_op << ", \"ops_per_sec\": " << m.ops_per_second
+                      << ", \"allocs_per_op\": " << m.allocations_per_op;
+            if (compared) {
+                std::cout << ", \"baseline_ns_per_op\": " << old->second << ", \"change_pct\": " << change
+                          << ", \"regression\": " << (regression ? "true" : "false");
+            }
+            std::cout << "}";
+        }
+        else {
+            std::cout << m.name << "," << m.iterations << "," << m.ns_per_op << "," << m.ops_per_second
+                      << "," << m.allocations_per_op;
+            if (!baseline.empty()) {
+                if (compared) {
+                    std::cout << "," << old->second << "," << change << "," << (regression ? 1 : 0);
+                }
+                else {
+                    std::cout << ",,,";
+                }
+            }
+            std::cout << "\n";
+        }
+        std::cout.flush();
+        first = false;
+    }
+    if (json) {
+        std::cout << "\n]\n";
+    }
+    if (regressions > 0) {
+        std::cerr << regressions << " benchmark(s) slower than the baseline by more than " << threshold << "%\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include <cmath>
+#include <string>
+#include "calc.h"
+#include "color_code.h"
+#include "eseries.h"
+#include "poles.h"
+
+static const char* const digit_colors[] = {
+    "black", "brown", "red", "orange", "yellow", "green", "blue", "violet", "gray", "white"
+};
+
+// Function to calculate cutoff frequency
+double calculate_cutoff_frequency(double r, double c, double factor) {
+    return 1 / (r * c * 2 * PI * factor);
+}
+
+// Function to calculate the resistance needed for a cutoff frequency
+double required_resistance(double c, double cutoff_freq) {
+    return 1 / (2 * PI * c * cutoff_freq);
+}
+
+// Function to calculate the capacitance needed for a cutoff frequency
+double required_capacitance(double r, double cutoff_freq) {
+    return 1 / (2 * PI * r * cutoff_freq);
+}
+
+OpAmpResult inverting_amplifier(double vin, double feedback_resistor, double input_resistor) {
+    OpAmpResult result;
+    result.gain = -feedback_resistor / input_resistor;
+    result.output_voltage = result.gain * vin;
+    return result;
+}
+
+OpAmpResult non_inverting_amplifier(double vin, double feedback_resistor, double ground_resistor) {
+    OpAmpResult result;
+    result.gain = 1 + (feedback_resistor / ground_resistor);
+    result.output_voltage = result.gain * vin;
+    return result;
+}
+
+double series_resistance(const double* values, int count) {
+    if (count <= 0) {
+        return -1;
+    }
+    double total = 0;
+    for (int i = 0; i < count; i++) {
+        if (values[i] <= 0) {
+            return -1;
+        }
+        total += values[i];
+    }
+    return total;
+}
+
+double parallel_resistance(const double* values, int count) {
+    if (count <= 0) {
+        return -1;
+    }
+    double total_inverse = 0;
+    for (int i = 0; i < count; i++) {
+        if (values[i] <= 0) {
+            return -1; // Resistor value cannot be zero in parallel combination
+        }
+        total_inverse += 1 / values[i];
+    }
+    return 1 / total_inverse;
+}
+
+double combine_series(double r1, double r2) {
+    return r1 + r2;
+}
+
+double combine_parallel(double r1, double r2) {
+    return 1 / ((1 / r1) + (1 / r2));
+}
+
+// Function to find the closest E12 resistor to a value (log scale)
+double nearest_npv_resistor(double resistance) {
+    return nearest_preferred_value(resistance, E12).nearest;
+}
+
+// Unpacks a 3-band code into digit values and the multiplier exponent
+static bool unpack_color_bands(PackedBands packed, ColorBands& bands) {
+    if (packed == 0) {
+        return false;
+    }
+    BandColor multiplier = packed_band(packed, 2);
+    bands.first_digit = packed_band(packed, 0);
+    bands.second_digit = packed_band(packed, 1);
+    bands.multiplier = multiplier <= WHITE ? multiplier : WHITE - multiplier; // gold, silver, pink: -1..-3
+    return true;
+}
+
+// Function to work out the three colour bands of a resistor value, rounded to two digits
+// Returns false if the value has no valid colour code
+bool resistor_color_bands(double resistance, ColorBands& bands) {
+    return unpack_color_bands(encode_color_bands(resistance, 3, NO_BAND), bands);
+}
+
+// The E12 entry is coded from its integer mantissa, so 4.7 and 8.2 come out exact
+NpvResult npv_and_color_code(double resistance) {
+    PreferredValue npv = nearest_preferred_value(resistance, E12);
+    int mantissa, exponent;
+    eseries_decimal(E12, npv.index, mantissa, exponent);
+    NpvResult result;
+    result.value = npv.nearest;
+    result.has_color_code = unpack_color_bands(encode_color_bands(mantissa, exponent, 3, NO_BAND), result.bands);
+    return result;
+}
+
+int color_digit(const std::string& color) {
+    BandColor band = parse_band_color(color);
+    return band <= WHITE ? band : -1;
+}
+
+bool color_multiplier(const std::string& color, double& multiplier) {
+    // A brown-black code scaled by the multiplier band is 10 x multiplier
+    BandColor bands[] = { BROWN, BLACK, parse_band_color(color) };
+    ResistorCode code;
+    if (!decode_color_bands(pack_color_bands(bands, 3), code)) {
+        return false;
+    }
+    multiplier = code.resistance / 10;
+    return true;
+}
+
+// Function to calculate resistance from three colour bands (any case)
+// Returns -1 if any band is not a valid colour
+double resistance_from_color_bands(const std::string& band1, const std::string& band2, const std::string& multiplier) {
+    BandColor bands[] = { parse_band_color(band1), parse_band_color(band2), parse_band_color(multiplier) };
+    ResistorCode code;
+    decode_color_bands(pack_color_bands(bands, 3), code);
+    return code.resistance;
+}
+
+const char* digit_color_name(int digit) {
+    if (digit < 0 || digit > 9) {
+        return "";
+    }
+    return digit_colors[digit];
+}
+
+const char* multiplier_color_name(int exponent) {
+    if (exponent == -1) {
+        return "gold";
+    }
+    if (exponent == -2) {
+        return "silver";
+    }
+    if (exponent == -3) {
+        return "pink";
+    }
+    return digit_color_name(exponent);
+}
+
+// Function to fetch gains and factors based on filter family and poles
+// Fills one entry per section and returns the number of sections (0 if unsupported)
+int pole_table(FilterFamily family, int num_poles, PolePairData* pairs) {
+    if (family != BUTTERWORTH && family != CHEBYSHEV_0_5DB && family != CHEBYSHEV_2DB) {
+        return 0;
+    }
+    return filter_sections(num_poles, family_ripple(family), pairs);
+}
+
+// Function to calculate RA and the cutoff frequency of one pole pair
+SallenKeyStage sallen_key_stage(const PolePairData& pair, double r, double c, double rb) {
+    SallenKeyStage stage;
+    stage.gain = pair.gain;
+    stage.rb = rb;
+    stage.ra = rb * (pair.gain - 1);
+    stage.cutoff_freq = calculate_cutoff_frequency(r * pair.factor_low, c * pair.factor_high);
+    return stage;
+}
+
+SallenKeyDesign sallen_key_design(double ripple_db, int num_poles, double r, double c, double rb) {
+    SallenKeyDesign design;
+    PolePairData pairs[MAX_POLE_PAIRS];
+    design.num_stages = filter_sections(num_poles, ripple_db, pairs);
+    for (int i = 0; i < design.num_stages; i++) {
+        design.stages[i] = sallen_key_stage(pairs[i], r, c, rb);
+    }
+    return design;
+}
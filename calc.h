@@ -0,0 +1,93 @@
+#ifndef CALC_H
+#define CALC_H
+
+#include <string>
+
+// Enginuity calculation library.
+// Everything in here is side-effect free: no std::cin/std::cout, no clearscreen().
+// The menus (funcs.cpp) and batch mode are built on top of it.
+// "make libenginuity.a" builds it as a static library together with the modules it uses
+// (eseries.cpp, color_code.cpp, poles.cpp) and the rest of the non-interactive code.
+
+const double PI = 3.14159265358979323846;
+
+// Highest filter order, and the largest number of Sallen-Key sections in one design
+const int MAX_FILTER_ORDER = 12;
+const int MAX_POLE_PAIRS = (MAX_FILTER_ORDER + 1) / 2;
+
+// Filter families, numbered as in the Sallen-Key menu
+enum FilterFamily {
+    BUTTERWORTH = 1,
+    CHEBYSHEV_0_5DB = 2,
+    CHEBYSHEV_2DB = 3
+};
+
+struct OpAmpResult {
+    double gain;
+    double output_voltage;
+};
+
+// Three band colour code, stored as digit values and a power-of-ten multiplier
+struct ColorBands {
+    int first_digit;
+    int second_digit;
+    int multiplier; // -3 (pink) to 9 (white)
+};
+
+struct NpvResult {
+    double value;       // nearest preferred value in ohms
+    bool has_color_code;
+    ColorBands bands;
+};
+
+// Per pole pair table entry: stage gain and frequency scaling factors
+struct PolePairData {
+    double gain;
+    double factor_low;
+    double factor_high;
+    double q; // 0 for the first-order section of an odd order
+};
+
+struct SallenKeyStage {
+    double gain;
+    double ra;
+    double rb;
+    double cutoff_freq;
+};
+
+struct SallenKeyDesign {
+    int num_stages; // 0 if the order/ripple is not supported
+    SallenKeyStage stages[MAX_POLE_PAIRS];
+};
+
+// RC filters
+double calculate_cutoff_frequency(double r, double c, double factor = 1.0);
+double required_resistance(double c, double cutoff_freq);
+double required_capacitance(double r, double cutoff_freq);
+
+// Op-amps
+OpAmpResult inverting_amplifier(double vin, double feedback_resistor, double input_resistor);
+OpAmpResult non_inverting_amplifier(double vin, double feedback_resistor, double ground_resistor);
+
+// Resistor networks, returns -1 for an empty list or a non-positive value
+double series_resistance(const double* values, int count);
+double parallel_resistance(const double* values, int count);
+double combine_series(double r1, double r2);
+double combine_parallel(double r1, double r2);
+
+// Preferred values and 3-band colour codes, see color_code.h for 4 to 6 bands
+double nearest_npv_resistor(double resistance); // E12, see eseries.h for other series
+bool resistor_color_bands(double resistance, ColorBands& bands);
+NpvResult npv_and_color_code(double resistance);
+int color_digit(const std::string& color);            // -1 if not a digit colour
+bool color_multiplier(const std::string& color, double& multiplier);
+double resistance_from_color_bands(const std::string& band1, const std::string& band2, const std::string& multiplier);
+const char* digit_color_name(int digit);
+const char* multiplier_color_name(int exponent);
+
+// Sallen-Key filters, see poles.h for any order and ripple
+int pole_table(FilterFamily family, int num_poles, PolePairData* pairs);
+SallenKeyStage sallen_key_stage(const PolePairData& pair, double r, double c, double rb);
+SallenKeyDesign sallen_key_design(double ripple_db, int num_poles, double r, double c, double rb);
+
+#endif
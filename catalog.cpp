@@ -0,0 +1,395 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include "si_value.h"
+#include "catalog.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char CATALOG_MAGIC[8] = { 'E', 'N', 'G', 'P', 'A', 'R', 'T', 'S' };
+const uint32_t CATALOG_VERSION = 1;           // layout of the header and tables
+const uint64_t CATALOG_MAX_STRINGS = 1ull << 32; // string offsets are 32-bit
+
+static inline uint64_t align8(uint64_t offset) {
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+bool parse_part_kind(const std::string& name, PartKind& kind) {
+    if (name == "R" || name == "r" || name == "resistor") {
+        kind = PART_RESISTOR;
+    }
+    else if (name == "C" || name == "c" || name == "capacitor") {
+        kind = PART_CAPACITOR;
+    }
+    else if (name == "U" || name == "u" || name == "opamp" || name == "op-amp") {
+        kind = PART_OPAMP;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+// Function to split one CSV line at commas, trimming spaces; no quoting, SKUs don't need it
+static void split_fields(const std::string& line, std::vector<std::string>& fields) {
+    fields.clear();
+    size_t start = 0;
+    while (true) {
+        size_t comma = line.find(',', start);
+        size_t end = comma == std::string::npos ? line.size() : comma;
+        size_t first = line.find_first_not_of(" \t\r", start);
+        size_t last = line.find_last_not_of(" \t\r", end == 0 ? 0 : end - 1);
+        fields.push_back(first < end && last != std::string::npos && last >= first ? line.substr(first, last - first + 1) : "");
+        if (comma == std::string::npos) {
+            return;
+        }
+        start = comma + 1;
+    }
+}
+
+static bool parse_tolerance(const std::string& text, double& tolerance) {
+    if (!text.empty() && text.back() == '%') {
+        if (!parse_value(text.substr(0, text.size() - 1), tolerance)) {
+            return false;
+        }
+        tolerance /= 100;
+        return true;
+    }
+    return parse_value(text, tolerance);
+}
+
+// Function to add a string to the table once, returning its offset
+static uint32_t intern(std::string& strings, std::map<std::string, uint32_t>& seen, const std::string& text) {
+    auto found = seen.find(text);
+    if (found != seen.end()) {
+        return found->second;
+    }
+    uint32_t offset = static_cast<uint32_t>(strings.size());
+    strings.append(text);
+    strings += '\0';
+    seen.emplace(text, offset);
+    return offset;
+}
+
+bool build_catalog(std::istream& csv, const std::string& path, long long& count, std::string& error) {
+    std::vector<CatalogPart> parts;
+    std::string strings;
+    std::map<std::string, uint32_t> packages;
+    std::vector<std::string> fields;
+    std::string line;
+    long long line_number = 0;
+    while (std::getline(csv, line)) {
+        line_number++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos || line[line.find_first_not_of(" \t\r")] == '#') {
+            continue;
+        }
+        split_fields(line, fields);
+        PartKind kind;
+        double value, tolerance, price, quantity;
+        if (fields.size() != 7 || !parse_part_kind(fields[0], kind) || fields[1].empty() ||
+            !parse_value(fields[2], value) || !(value > 0) || !parse_tolerance(fields[3], tolerance) || tolerance < 0 ||
+            !parse_value(fields[5], price) || price < 0 || !parse_value(fields[6], quantity) || quantity < 0 ||
+            quantity > 4294967295.0 || quantity != std::floor(quantity)) {
+            if (parts.empty() && line_number == 1) {
+                continue; // column names
+            }
+            std::ostringstream message;
+            message << "line " << line_number << ": expected kind,sku,value,tolerance,package,price,quantity";
+            error = message.str();
+            return false;
+        }
+        CatalogPart part{};
+        part.value = value;
+        part.tolerance = static_cast<float>(tolerance);
+        part.price = static_cast<float>(price);
+        part.quantity = static_cast<uint32_t>(quantity);
+        part.sku = static_cast<uint32_t>(strings.size());
+        strings.append(fields[1]);
+        strings += '\0';
+        part.package = intern(strings, packages, fields[4]);
+        part.kind = static_cast<uint8_t>(kind);
+        parts.push_back(part);
+        if (strings.size() >= CATALOG_MAX_STRINGS) {
+            error = "too many SKU characters for one catalog";
+            return false;
+        }
+    }
+    if (csv.bad()) {
+        error = "read error";
+        return false;
+    }
+
+    std::sort(parts.begin(), parts.end(), [](const CatalogPart& a, const CatalogPart& b) {
+        if (a.kind != b.kind) return a.kind < b.kind;
+        if (a.value != b.value) return a.value < b.value;
+        return a.price < b.price;
+    });
+    CatalogHeader header{};
+    std::memcpy(header.magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC));
+    header.version = CATALOG_VERSION;
+    std::vector<double> values;
+    for (size_t i = 0; i < parts.size(); i++) {
+        CatalogPart& part = parts[i];
+        if (i == 0 || parts[i - 1].kind != part.kind) {
+            header.parts[part.kind].first = i;
+            header.values[part.kind].first = values.size();
+        }
+        header.parts[part.kind].count++;
+        if (part.quantity > 0 && (values.size() == header.values[part.kind].first || values.back() != part.value)) {
+            values.push_back(part.value);
+            header.values[part.kind].count++;
+        }
+    }
+    header.parts_offset = align8(sizeof(header));
+    header.values_offset = header.parts_offset + parts.size() * sizeof(CatalogPart);
+    header.strings_offset = header.values_offset + values.size() * sizeof(double);
+    header.strings_size = strings.size();
+    header.file_size = header.strings_offset + strings.size();
+
+    std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(std::string(header.parts_offset - sizeof(header), '\0').data(), header.parts_offset - sizeof(header));
+    out.write(reinterpret_cast<const char*>(parts.data()), parts.size() * sizeof(CatalogPart));
+    out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+    out.write(strings.data(), strings.size());
+    out.close();
+    if (!out || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        error = "cannot write " + path + ": " + std::strerror(errno);
+        std::remove(temporary.c_str());
+        return false;
+    }
+    count = static_cast<long long>(parts.size());
+    return true;
+}
+
+// Function to check that every table lies inside the file, so lookups need no bounds checks
+static bool catalog_valid(const char* data, uint64_t size) {
+    if (size < sizeof(CatalogHeader)) {
+        return false;
+    }
+    const CatalogHeader& header = *reinterpret_cast<const CatalogHeader*>(data);
+    if (std::memcmp(header.magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC)) != 0 || header.version != CATALOG_VERSION ||
+        header.file_size != size || header.parts_offset % 8 != 0 || header.values_offset % 8 != 0 ||
+        header.parts_offset < sizeof(header) || header.values_offset < header.parts_offset ||
+        header.strings_offset < header.values_offset || header.strings_offset > size ||
+        header.strings_size != size - header.strings_offset || header.strings_size > CATALOG_MAX_STRINGS ||
+        (header.strings_size > 0 && data[size - 1] != '\0')) {
+        return false;
+    }
+    uint64_t num_parts = (header.values_offset - header.parts_offset) / sizeof(CatalogPart);
+    uint64_t num_values = (header.strings_offset - header.values_offset) / sizeof(double);
+    for (int kind = 0; kind < PART_KINDS; kind++) {
+        const CatalogRange& parts = header.parts[kind];
+        const CatalogRange& values = header.values[kind];
+        if (parts.first > num_parts || parts.count > num_parts - parts.first ||
+            values.first > num_values || values.count > num_values - values.first || values.count > parts.count ||
+            values.count > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+bool open_catalog(const std::string& path, PartsCatalog& catalog, std::string& error) {
+    close_catalog(catalog);
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+    // The pages are read on first use, so opening costs the same for any catalog size
+    uint64_t size = static_cast<uint64_t>(info.st_size);
+    void* bytes = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (bytes == MAP_FAILED || !catalog_valid(static_cast<const char*>(bytes), size)) {
+        error = path + " is not a parts catalog";
+        if (bytes != MAP_FAILED) {
+            munmap(bytes, size);
+        }
+        return false;
+    }
+    catalog.data = static_cast<const char*>(bytes);
+    catalog.size = size;
+    catalog.header = reinterpret_cast<const CatalogHeader*>(catalog.data);
+    return true;
+}
+
+void close_catalog(PartsCatalog& catalog) {
+    if (catalog.data) {
+        munmap(const_cast<char*>(catalog.data), catalog.size);
+    }
+    catalog.data = nullptr;
+    catalog.size = 0;
+    catalog.header = nullptr;
+}
+
+#else
+
+#include <iterator>
+
+// Without mmap the file is read into memory once
+bool open_catalog(const std::string& path, PartsCatalog& catalog, std::string& error) {
+    close_catalog(catalog);
+    std::ifstream in(path, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (!in.eof() || !catalog_valid(bytes.data(), bytes.size())) {
+        error = path + " is not a parts catalog";
+        return false;
+    }
+    char* data = new char[bytes.size()];
+    std::memcpy(data, bytes.data(), bytes.size());
+    catalog.data = data;
+    catalog.size = bytes.size();
+    catalog.header = reinterpret_cast<const CatalogHeader*>(catalog.data);
+    return true;
+}
+
+void close_catalog(PartsCatalog& catalog) {
+    delete[] catalog.data;
+    catalog.data = nullptr;
+    catalog.size = 0;
+    catalog.header = nullptr;
+}
+
+#endif
+
+PartsCatalog::~PartsCatalog() {
+    close_catalog(*this);
+}
+
+const CatalogPart* catalog_parts(const PartsCatalog& catalog, PartKind kind, long long& count) {
+    if (!catalog.header) {
+        count = 0;
+        return nullptr;
+    }
+    const CatalogRange& range = catalog.header->parts[kind];
+    count = static_cast<long long>(range.count);
+    return reinterpret_cast<const CatalogPart*>(catalog.data + catalog.header->parts_offset) + range.first;
+}
+
+const char* catalog_string(const PartsCatalog& catalog, uint32_t offset) {
+    if (!catalog.header || offset >= catalog.header->strings_size) {
+        return "";
+    }
+    return catalog.data + catalog.header->strings_offset + offset;
+}
+
+bool part_matches(const CatalogPart& part, const PartFilter& filter) {
+    // Compared as stored, so tolmax=0.001 keeps the parts listed at 0.1%
+    return part.quantity >= filter.min_quantity && part.tolerance <= static_cast<float>(filter.max_tolerance) &&
+           part.price <= static_cast<float>(filter.max_price);
+}
+
+static inline bool default_filter(const PartFilter& filter) {
+    return filter.min_quantity == 1 && std::isinf(filter.max_tolerance) && std::isinf(filter.max_price);
+}
+
+static inline const CatalogPart* lower_bound_value(const CatalogPart* first, const CatalogPart* last, double value) {
+    return std::lower_bound(first, last, value, [](const CatalogPart& part, double v) { return part.value < v; });
+}
+
+const CatalogPart* nearest_catalog_part(const PartsCatalog& catalog, PartKind kind, double value, const PartFilter& filter,
+                                        const CatalogPart** down, const CatalogPart** up) {
+    // Find the allowed values on each side first, then the cheapest part at each
+    bool has_below = false, has_above = false;
+    double below_value = 0, above_value = 0;
+    if (default_filter(filter)) {
+        // Straight from the stocked value table, without stepping over unstocked SKUs
+        std::vector<double> unused;
+        int count;
+        const double* values = catalog_values(catalog, kind, filter, unused, count);
+        const double* next = std::lower_bound(values, values + count, value);
+        has_above = next < values + count;
+        has_below = (has_above && *next == value) || next > values;
+        above_value = has_above ? *next : 0;
+        below_value = has_above && *next == value ? value : has_below ? next[-1] : 0;
+    }
+    else {
+        // Walk out from the insertion point to the first allowed part on each side
+        long long count;
+        const CatalogPart* parts = catalog_parts(catalog, kind, count);
+        const CatalogPart* end = parts + count;
+        const CatalogPart* at = lower_bound_value(parts, end, value);
+        const CatalogPart* p = at;
+        while (p < end && !part_matches(*p, filter)) {
+            p++;
+        }
+        has_above = p < end;
+        above_value = has_above ? p->value : 0;
+        if (has_above && above_value == value) {
+            has_below = true;
+            below_value = value;
+        }
+        for (p = at; !has_below && p > parts;) {
+            --p;
+            if (part_matches(*p, filter)) {
+                has_below = true;
+                below_value = p->value;
+            }
+        }
+    }
+    const CatalogPart* below = has_below ? catalog_part_for_value(catalog, kind, below_value, filter) : nullptr;
+    const CatalogPart* above = has_above ? catalog_part_for_value(catalog, kind, above_value, filter) : nullptr;
+    if (down) *down = below;
+    if (up) *up = above;
+    if (!below || !above) {
+        return below ? below : above;
+    }
+    return value * value <= below->value * above->value ? below : above;
+}
+
+const CatalogPart* catalog_part_for_value(const PartsCatalog& catalog, PartKind kind, double value, const PartFilter& filter) {
+    long long count;
+    const CatalogPart* parts = catalog_parts(catalog, kind, count);
+    const CatalogPart* best = nullptr;
+    // Records of one value are sorted by price, so the first allowed one is the cheapest
+    for (const CatalogPart* p = lower_bound_value(parts, parts + count, value); p < parts + count && p->value == value; p++) {
+        if (part_matches(*p, filter) && (!best || (p->price == best->price && p->quantity > best->quantity))) {
+            best = p;
+        }
+        else if (best && p->price > best->price) {
+            break;
+        }
+    }
+    return best;
+}
+
+const double* catalog_values(const PartsCatalog& catalog, PartKind kind, const PartFilter& filter,
+                             std::vector<double>& scratch, int& count) {
+    if (!catalog.header) {
+        count = 0;
+        return nullptr;
+    }
+    if (default_filter(filter)) {
+        const CatalogRange& range = catalog.header->values[kind];
+        count = static_cast<int>(range.count);
+        return reinterpret_cast<const double*>(catalog.data + catalog.header->values_offset) + range.first;
+    }
+    long long num_parts;
+    const CatalogPart* parts = catalog_parts(catalog, kind, num_parts);
+    scratch.clear();
+    for (long long i = 0; i < num_parts; i++) {
+        if (part_matches(parts[i], filter) && (scratch.empty() || scratch.back() != parts[i].value)) {
+            scratch.push_back(parts[i].value);
+        }
+    }
+    count = static_cast<int>(std::min<size_t>(scratch.size(), std::numeric_limits<int>::max()));
+    return scratch.data();
+}
@@ -0,0 +1,106 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Parts catalog: the resistors, capacitors and op-amps we stock or can buy, so value
+// searches can be limited to real SKUs. A CSV export is converted once into a binary
+// file that is memory-mapped as it is, with nothing parsed or copied on load:
+//
+//   header       magic, version, counts and offsets of the tables below
+//   parts        CatalogPart records sorted by kind, then value, then price, so each
+//                kind's slice is its own value index for binary searches
+//   values       per kind, the distinct values that have stock, ascending; the
+//                series/parallel and RC searches take these directly
+//   strings      NUL-terminated SKUs and package names, packages stored once
+//
+// Numbers are in native byte order, so a catalog belongs to one architecture.
+
+enum PartKind {
+    PART_RESISTOR,   // value in ohms
+    PART_CAPACITOR,  // value in farads
+    PART_OPAMP,      // value is the gain-bandwidth product in Hz
+    PART_KINDS
+};
+
+struct CatalogPart {
+    double value;
+    float tolerance;     // fraction, 0.01 for 1%
+    float price;         // per unit
+    uint32_t quantity;   // in stock, 0 for parts we could order
+    uint32_t sku;        // offsets into the string table
+    uint32_t package;
+    uint8_t kind;        // PartKind
+    uint8_t reserved[3];
+};
+
+struct CatalogRange {
+    uint64_t first;
+    uint64_t count;
+};
+
+struct CatalogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t file_size;
+    uint64_t parts_offset;
+    uint64_t values_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    CatalogRange parts[PART_KINDS];    // records of each kind
+    CatalogRange values[PART_KINDS];   // stocked values of each kind
+};
+
+// Which parts a query may use. The default, anything in stock, is the precomputed
+// value table; other filters scan the kind's parts.
+struct PartFilter {
+    double min_quantity = 1;
+    double max_tolerance = std::numeric_limits<double>::infinity();
+    double max_price = std::numeric_limits<double>::infinity();
+};
+
+// A mapped catalog file, unmapped on close or destruction. Lookups only read the
+// mapping, so any number of threads may share an open catalog.
+struct PartsCatalog {
+    const char* data = nullptr;
+    uint64_t size = 0;
+    const CatalogHeader* header = nullptr;
+
+    PartsCatalog() = default;
+    ~PartsCatalog();
+    PartsCatalog(const PartsCatalog&) = delete;
+    PartsCatalog& operator=(const PartsCatalog&) = delete;
+};
+
+// Converts "kind,sku,value,tolerance,package,price,quantity" lines into a catalog file.
+// Kinds are R, C and U (or resistor, capacitor, opamp); values take SI prefixes ("4k7",
+// "100n", "10MHz") and tolerances a percent sign ("1%" or 0.01). A header line, blank
+// lines and '#' comments are skipped. The file is written aside and renamed into place.
+bool build_catalog(std::istream& csv, const std::string& path, long long& count, std::string& error);
+
+// Maps a catalog and checks that its tables lie inside the file
+bool open_catalog(const std::string& path, PartsCatalog& catalog, std::string& error);
+void close_catalog(PartsCatalog& catalog);
+bool parse_part_kind(const std::string& name, PartKind& kind);
+
+const CatalogPart* catalog_parts(const PartsCatalog& catalog, PartKind kind, long long& count);
+const char* catalog_string(const PartsCatalog& catalog, uint32_t offset);
+bool part_matches(const CatalogPart& part, const PartFilter& filter);
+
+// Nearest allowed part by ratio, and the nearest at or below and at or above the value;
+// nullptr where there is none
+const CatalogPart* nearest_catalog_part(const PartsCatalog& catalog, PartKind kind, double value, const PartFilter& filter,
+                                        const CatalogPart** down = nullptr, const CatalogPart** up = nullptr);
+// Cheapest allowed part of exactly this value (the most stocked on a tie), nullptr if none
+const CatalogPart* catalog_part_for_value(const PartsCatalog& catalog, PartKind kind, double value, const PartFilter& filter);
+// Distinct allowed values, ascending: the mapped table for the default filter, otherwise
+// collected into scratch
+const double* catalog_values(const PartsCatalog& catalog, PartKind kind, const PartFilter& filter,
+                             std::vector<double>& scratch, int& count);
+
+#endif
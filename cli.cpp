@@ -0,0 +1,241 @@
+#include <cctype>
+#include <cstring>
+#include <string>
+#include "batch.h"
+#include "cli.h"
+
+const int CLI_MAX_WORDS = 3;
+
+// One row of the dispatch table. Options become "key=value" arguments of the batch
+// request, except word options (passed as bare values in table order after any
+// positional values; "name=default" fills the gap when a later one is given) and flags
+// (options without a value, passed as their own name).
+struct CliCommand {
+    const char* path;                 // command words, e.g. "rc cutoff"
+    const char* request;              // batch command it becomes
+    const char* selector;             // the row only applies when this option is given, "" for always
+    const char* words[CLI_MAX_WORDS];
+    const char* flags;                // space-separated
+    const char* usage;
+};
+
+// Rows sharing a path are tried in order, so selected rows come before the default one
+static const CliCommand commands[] = {
+    { "rc cutoff", "rc-cutoff", "", {}, "", "--r <ohms> --c <farads>" },
+    { "rc r", "rc-r", "", {}, "", "--c <farads> --fc <Hz>" },
+    { "rc c", "rc-c", "", {}, "", "--r <ohms> --fc <Hz>" },
+    { "rc pairs", "rc-pairs", "stock", {}, "stock",
+      "--fc <Hz> --stock [--qtymin 1] [--tolmax 0.05] [--pricemax 0.1] [--k 3] [--rmin 1k] [--rmax 1M] [--cmin 10p] [--cmax 10u]" },
+    { "rc pairs", "rc-pairs", "", { "r-series=E24", "c-series=E6" }, "",
+      "--fc <Hz> [--r-series E24] [--c-series E6] [--k 3] [--rmin 1k] [--rmax 1M] [--cmin 10p] [--cmax 10u]" },
+    { "npv", "npv", "", { "series" }, "stock", "<ohms> [--series E12 | --stock [--qtymin 1] [--tolmax 0.01] [--pricemax 0.1]]" },
+    { "pairs", "pairs", "", { "series" }, "stock", "<ohms> [--series E12 | --stock [--qtymin 1] [--tolmax 0.01] [--pricemax 0.1]] [--k 3]" },
+    { "part", "part", "", {}, "", "<resistor | capacitor | opamp> <value> [--qtymin 1] [--tolmax 0.05] [--pricemax 0.1]" },
+    { "network", "network", "", { "series" }, "", "<ohms> [--series E24] [--parts 4] [--tol 1e-4] [--ms 200]" },
+    { "gain", "gain", "", { "series" }, "inverting non-inverting",
+      "<gain> [--series E12] [--inverting | --non-inverting] [--k 3] [--rmin 1k] [--rmax 1M]" },
+    { "color", "color", "", {}, "", "<colour> <colour> <colour> [<colour>...]" },
+    { "bands", "bands", "", { "tolerance" }, "", "<ohms>... [--n 3|4|5] [--tolerance <colour>]" },
+    { "combine", "combine", "", {}, "", "<expression | JSON> [--<name> <ohms>...]" },
+    { "dc req", "dc-req", "", {}, "", "<netlist> <node> <node> [--threads n]" },
+    { "dc", "dc", "", {}, "", "<netlist> [<node> | <element>...] [--threads n]" },
+    { "ac", "ac", "", {}, "", "<netlist> <out> [<in>] [--from 10] [--to 1M] [--points 1000] [--threads n]" },
+    { "inverting", "inverting", "", {}, "", "--vin <volts> --rf <ohms> --rin <ohms>" },
+    { "non-inverting", "non-inverting", "", {}, "", "--vin <volts> --rf <ohms> --rg <ohms>" },
+    { "series", "series", "", {}, "", "<ohms>..." },
+    { "parallel", "parallel", "", {}, "", "<ohms>..." },
+    { "sallen-key", "sallen-key-opt", "fc", { "family", "r-series=E24", "c-series=E12" }, "high low",
+      "--family <butterworth | cheb<dB>> --poles n --fc <Hz> [--high] [--r-series E24] [--c-series E12] [--lines n]" },
+    { "sallen-key", "sallen-key", "", { "family" }, "",
+      "--family <butterworth | cheb<dB>> --poles n --r <ohms> --c <farads> --rb <ohms>" },
+    { "sweep", "sweep", "", { "family" }, "high low",
+      "<rc | butterworth | cheb<dB>> (--r --c | --poles n --fc <Hz>) [--high] [--from Hz] [--to Hz] [--points n]" },
+    { "tolerance", "tolerance", "", {}, "high",
+      "<rc | inverting | non-inverting | sallen-key> [uniform | gaussian] (--r --c | --vin --rf --rin|--rg | --r --c --ra --rb [--high]) "
+      "[--rtol 0.05] [--ctol 0.1] [--min x] [--max x] [--qmin q] [--qmax q] [--trials n] [--seed n] [--threads n]" },
+};
+
+// Function to check whether a space-separated list holds a name of the given length
+static bool in_list(const char* list, const char* name, size_t length) {
+    for (const char* p = list; *p;) {
+        const char* end = std::strchr(p, ' ');
+        size_t word = end ? static_cast<size_t>(end - p) : std::strlen(p);
+        if (word == length && std::memcmp(p, name, length) == 0) {
+            return true;
+        }
+        p += end ? word + 1 : word;
+    }
+    return false;
+}
+
+// Function to find a word option by name, -1 if the command has none of that name
+static int word_slot(const CliCommand& command, const char* name, size_t length) {
+    for (int i = 0; i < CLI_MAX_WORDS && command.words[i]; i++) {
+        const char* word = command.words[i];
+        if (std::strncmp(word, name, length) == 0 && (word[length] == '\0' || word[length] == '=')) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Function to count the words of a table path and check them against the arguments
+static int match_path(const char* path, int argc, const char* const* argv) {
+    int count = 0;
+    for (const char* p = path; *p; count++) {
+        const char* end = std::strchr(p, ' ');
+        size_t length = end ? static_cast<size_t>(end - p) : std::strlen(p);
+        if (count >= argc || std::strlen(argv[count]) != length || std::memcmp(argv[count], p, length) != 0) {
+            return 0;
+        }
+        p += end ? length + 1 : length;
+    }
+    return count;
+}
+
+// Function to check that a command takes an option: a flag, a word option or any
+// "--name" in its usage ("--<name>" in the usage allows every name)
+static bool known_option(const CliCommand& command, const char* name, size_t length) {
+    if (in_list(command.flags, name, length) || word_slot(command, name, length) >= 0) {
+        return true;
+    }
+    for (const char* p = std::strstr(command.usage, "--"); p; p = std::strstr(p + 2, "--")) {
+        if (p[2] == '<') {
+            return true;
+        }
+        char next = p[2 + length];
+        if (std::strncmp(p + 2, name, length) == 0 && !(std::isalnum(static_cast<unsigned char>(next)) || next == '-')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool is_option(const char* arg) {
+    return arg[0] == '-' && arg[1] == '-' && arg[2] != '\0';
+}
+
+static void print_usage(std::ostream& out) {
+    out << "usage: enginuity <command> [values...] [--option value...]\n"
+        << "       enginuity --batch [file]    one request per line\n"
+        << "       enginuity --daemon [socket] [--tcp port] [--threads n] [--cache bytes]\n"
+        << "       enginuity --rows <npv | cutoff | decode> [file] [--columns 1,2 | --keys r,c] [--series E12] [--threads n]\n"
+        << "       enginuity --build-catalog <parts.csv> <catalog>    for ENGINUITY_CATALOG and --stock\n"
+        << "       enginuity                   interactive menus\n\ncommands:\n";
+    for (const CliCommand& command : commands) {
+        out << "  " << command.path << " " << command.usage << "\n";
+    }
+    out << "\nValues take SI prefixes and units: 4k7, 100n, 47pF, 1.5kHz.\n";
+}
+
+int run_cli(int argc, const char* const* argv, std::ostream& out, std::ostream& err) {
+    if (argc == 0 || std::strcmp(argv[0], "--help") == 0 || std::strcmp(argv[0], "-h") == 0 ||
+        std::strcmp(argv[0], "help") == 0) {
+        print_usage(argc == 0 ? err : out);
+        return argc == 0 ? 2 : 0;
+    }
+
+    // First row whose path matches and whose selector option, if any, is present
+    const CliCommand* command = nullptr;
+    int path_words = 0;
+    for (const CliCommand& row : commands) {
+        int words = match_path(row.path, argc, argv);
+        if (words == 0) {
+            continue;
+        }
+        bool selected = row.selector[0] == '\0';
+        for (int i = words; i < argc && !selected; i++) {
+            selected = is_option(argv[i]) && (std::strcmp(argv[i] + 2, row.selector) == 0 ||
+                                              (std::strncmp(argv[i] + 2, row.selector, std::strlen(row.selector)) == 0 &&
+                                               argv[i][2 + std::strlen(row.selector)] == '='));
+        }
+        if (selected) {
+            command = &row;
+            path_words = words;
+            break;
+        }
+    }
+    if (!command) {
+        // Show the rows that start with the given word, e.g. every "rc ..." command
+        size_t length = std::strlen(argv[0]);
+        bool listed = false;
+        for (const CliCommand& row : commands) {
+            if (std::strncmp(row.path, argv[0], length) == 0 && (row.path[length] == ' ' || row.path[length] == '\0')) {
+                err << (listed ? "" : "usage:\n") << "  enginuity " << row.path << " " << row.usage << "\n";
+                listed = true;
+            }
+        }
+        if (!listed) {
+            err << "error: unknown command '" << argv[0] << "', see enginuity --help\n";
+        }
+        return 2;
+    }
+
+    // Positional values, then options: "key=value" for most, bare for word options and flags
+    std::string request(command->request);
+    std::string flags;
+    const char* word_values[CLI_MAX_WORDS] = {};
+    for (int i = path_words; i < argc; i++) {
+        const char* arg = argv[i];
+        if (!is_option(arg)) {
+            request += ' ';
+            request += arg;
+            continue;
+        }
+        const char* name = arg + 2;
+        const char* equals = std::strchr(name, '=');
+        size_t length = equals ? static_cast<size_t>(equals - name) : std::strlen(name);
+        if (length == 4 && std::memcmp(name, "help", 4) == 0) {
+            out << "usage: enginuity " << command->path << " " << command->usage << "\n";
+            return 0;
+        }
+        if (!known_option(*command, name, length)) {
+            err << "error: unknown option --" << std::string(name, length) << "\n"
+                << "usage: enginuity " << command->path << " " << command->usage << "\n";
+            return 2;
+        }
+        if (in_list(command->flags, name, length)) {
+            if (equals) {
+                err << "error: --" << std::string(name, length) << " takes no value\n";
+                return 2;
+            }
+            flags += ' ';
+            flags += name;
+            continue;
+        }
+        const char* value = equals ? equals + 1 : (i + 1 < argc && !is_option(argv[i + 1]) ? argv[++i] : nullptr);
+        if (!value || *value == '\0') {
+            err << "error: --" << std::string(name, length) << " needs a value\n";
+            return 2;
+        }
+        int slot = word_slot(*command, name, length);
+        if (slot >= 0) {
+            word_values[slot] = value;
+            continue;
+        }
+        request += ' ';
+        request.append(name, length);
+        request += '=';
+        request += value;
+    }
+
+    // Word options go in table order, with defaults for any gap before the last one given
+    int last_word = CLI_MAX_WORDS - 1;
+    while (last_word >= 0 && !word_values[last_word]) {
+        last_word--;
+    }
+    for (int i = 0; i <= last_word; i++) {
+        const char* value = word_values[i];
+        if (!value) {
+            value = std::strchr(command->words[i], '=');
+            value = value ? value + 1 : nullptr;
+        }
+        if (value) {
+            request += ' ';
+            request += value;
+        }
+    }
+    request += flags;
+
+    return run_batch_line(request, out) ? 0 : 1;
+}
@@ -0,0 +1,14 @@
+#ifndef CLI_H
+#define CLI_H
+
+#include <iostream>
+
+// One-shot command line: "enginuity <command> [<subcommand>] [values...] [--option value] [--flag]",
+// e.g. "enginuity rc cutoff --r 10k --c 100n", "enginuity npv 3300 --series E96" or
+// "enginuity sallen-key --family cheb0.5 --poles 4 --fc 1k".
+// A dispatch table turns the arguments into one batch request, so every command answers
+// with the same "key=value" line as --batch. "enginuity --help" lists the commands.
+// Returns the exit code: 0 on success, 1 if the calculation failed, 2 for a usage error.
+int run_cli(int argc, const char* const* argv, std::ostream& out, std::ostream& err);
+
+#endif
@@ -0,0 +1,295 @@
+#include <cmath>
+#include "color_code.h"
+
+struct ColorName {
+    const char* name;
+    unsigned char length;
+    BandColor color;
+};
+
+static constexpr ColorName color_names[] = {
+    { "black", 5, BLACK }, { "brown", 5, BROWN }, { "red", 3, RED }, { "orange", 6, ORANGE },
+    { "yellow", 6, YELLOW }, { "green", 5, GREEN }, { "blue", 4, BLUE }, { "violet", 6, VIOLET },
+    { "gray", 4, GRAY }, { "white", 5, WHITE }, { "gold", 4, GOLD }, { "silver", 6, SILVER },
+    { "pink", 4, PINK }, { "none", 4, NO_BAND },
+    // Aliases, after the canonical names so band_color_name() can index the list
+    { "grey", 4, GRAY }, { "purple", 6, VIOLET }
+};
+const int COLOR_NAME_COUNT = sizeof(color_names) / sizeof(color_names[0]);
+
+// Every name above has a different (third letter, last letter) pair, so that pair
+// indexes a dense 26x26 table and one string compare confirms the match
+struct NameTable {
+    unsigned char entry[26 * 26]; // index into color_names, 0xFF if none
+};
+
+static constexpr NameTable make_name_table() {
+    NameTable table{};
+    for (int i = 0; i < 26 * 26; i++) {
+        table.entry[i] = 0xFF;
+    }
+    for (int i = 0; i < COLOR_NAME_COUNT; i++) {
+        const ColorName& name = color_names[i];
+        table.entry[(name.name[2] - 'a') * 26 + (name.name[name.length - 1] - 'a')] = static_cast<unsigned char>(i);
+    }
+    return table;
+}
+
+static constexpr NameTable name_table = make_name_table();
+
+// Dense per-colour tables, INVALID (or 0 tolerance/tempco) where a colour can't appear
+const signed char NOT_A_DIGIT = -1;
+const signed char NOT_A_MULTIPLIER = -99;
+
+static constexpr signed char digit_value[BAND_COLOR_COUNT] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, NOT_A_DIGIT, NOT_A_DIGIT, NOT_A_DIGIT, NOT_A_DIGIT
+};
+static constexpr signed char multiplier_exponent[BAND_COLOR_COUNT] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, -1, -2, -3, NOT_A_MULTIPLIER
+};
+static constexpr double tolerance_value[BAND_COLOR_COUNT] = {
+    0, 0.01, 0.02, 0.0005, 0.0002, 0.005, 0.0025, 0.001, 0.0005, 0, 0.05, 0.1, 0, 0.2
+};
+static constexpr short tempco_value[BAND_COLOR_COUNT] = {
+    250, 100, 50, 15, 25, 20, 10, 5, 1, 0, 0, 0, 0, 0
+};
+static constexpr double powers_of_ten[] = { 1, 10, 100, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+static constexpr long long integer_powers_of_ten[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+    10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL, 100000000000000LL,
+    1000000000000000LL, 10000000000000000LL, 100000000000000000LL, 1000000000000000000LL
+};
+const int INTEGER_POWERS = sizeof(integer_powers_of_ten) / sizeof(integer_powers_of_ten[0]);
+
+// Multiplier band of each exponent from MIN_BAND_EXPONENT
+static constexpr BandColor exponent_color[] = {
+    PINK, SILVER, GOLD, BLACK, BROWN, RED, ORANGE, YELLOW, GREEN, BLUE, VIOLET, GRAY, WHITE
+};
+
+static inline char lower_letter(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+BandColor parse_band_color(const char* name, size_t length) {
+    if (length < 3 || length > 6) {
+        return INVALID_COLOR;
+    }
+    char third = lower_letter(name[2]), last = lower_letter(name[length - 1]);
+    if (third < 'a' || third > 'z' || last < 'a' || last > 'z') {
+        return INVALID_COLOR;
+    }
+    int index = name_table.entry[(third - 'a') * 26 + (last - 'a')];
+    if (index == 0xFF || color_names[index].length != length) {
+        return INVALID_COLOR;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (lower_letter(name[i]) != color_names[index].name[i]) {
+            return INVALID_COLOR;
+        }
+    }
+    return color_names[index].color;
+}
+
+BandColor parse_band_color(const std::string& name) {
+    return parse_band_color(name.data(), name.size());
+}
+
+const char* band_color_name(BandColor color) {
+    if (color >= BAND_COLOR_COUNT) {
+        return "";
+    }
+    return color_names[color].name;
+}
+
+PackedBands pack_color_bands(const BandColor* bands, int count) {
+    if (count < MIN_BANDS || count > MAX_BANDS) {
+        return 0;
+    }
+    PackedBands packed = static_cast<PackedBands>(count) << 24;
+    for (int i = 0; i < count; i++) {
+        if (bands[i] >= BAND_COLOR_COUNT) {
+            return 0;
+        }
+        packed |= static_cast<PackedBands>(bands[i]) << (4 * i);
+    }
+    return packed;
+}
+
+int packed_band_count(PackedBands bands) {
+    return static_cast<int>((bands >> 24) & 0xF);
+}
+
+BandColor packed_band(PackedBands bands, int index) {
+    return static_cast<BandColor>((bands >> (4 * index)) & 0xF);
+}
+
+bool decode_color_bands(PackedBands bands, ResistorCode& code) {
+    code.resistance = -1;
+    code.tolerance = 0;
+    code.tempco = 0;
+    int count = packed_band_count(bands);
+    if (count < MIN_BANDS || count > MAX_BANDS) {
+        return false;
+    }
+    int num_digits = count >= 5 ? 3 : 2;
+    int significand = 0;
+    for (int i = 0; i < num_digits; i++) {
+        BandColor color = packed_band(bands, i);
+        if (color >= BAND_COLOR_COUNT || digit_value[color] == NOT_A_DIGIT) {
+            return false;
+        }
+        significand = significand * 10 + digit_value[color];
+    }
+    BandColor multiplier = packed_band(bands, num_digits);
+    if (multiplier >= BAND_COLOR_COUNT || multiplier_exponent[multiplier] == NOT_A_MULTIPLIER) {
+        return false;
+    }
+    double tolerance = 0.2;
+    if (count >= 4) {
+        BandColor color = packed_band(bands, num_digits + 1);
+        if (color >= BAND_COLOR_COUNT || tolerance_value[color] == 0) {
+            return false;
+        }
+        tolerance = tolerance_value[color];
+    }
+    int tempco = 0;
+    if (count == 6) {
+        BandColor color = packed_band(bands, 5);
+        if (color >= BAND_COLOR_COUNT || tempco_value[color] == 0) {
+            return false;
+        }
+        tempco = tempco_value[color];
+    }
+
+    // Divide for the fractional multipliers so 47 x gold gives exactly the double nearest 4.7
+    int exponent = multiplier_exponent[multiplier];
+    code.resistance = exponent >= 0 ? significand * powers_of_ten[exponent] : significand / powers_of_ten[-exponent];
+    code.tolerance = tolerance;
+    code.tempco = tempco;
+    return true;
+}
+
+int decode_color_bands(const PackedBands* bands, int count, ResistorCode* codes) {
+    int valid = 0;
+    for (int i = 0; i < count; i++) {
+        valid += decode_color_bands(bands[i], codes[i]) ? 1 : 0;
+    }
+    return valid;
+}
+
+// Packs a significand already in range for num_digits digits; 0 if the exponent has no band
+static inline PackedBands pack_significand(long long significand, int exponent, int num_digits,
+                                           PackedBands tolerance_bits) {
+    if (exponent < MIN_BAND_EXPONENT || exponent > MAX_BAND_EXPONENT) {
+        return 0;
+    }
+    int s = static_cast<int>(significand);
+    PackedBands packed = num_digits == 3
+        ? static_cast<PackedBands>(s / 100) | static_cast<PackedBands>(s / 10 % 10) << 4 | static_cast<PackedBands>(s % 10) << 8
+        : static_cast<PackedBands>(s / 10) | static_cast<PackedBands>(s % 10) << 4;
+    return packed | static_cast<PackedBands>(exponent_color[exponent - MIN_BAND_EXPONENT]) << (4 * num_digits) | tolerance_bits;
+}
+
+// Band count and, for 4 and 5 bands, the tolerance band in place; 0 if either is invalid
+static PackedBands code_bits(int num_bands, BandColor tolerance) {
+    if (num_bands == 3) {
+        return static_cast<PackedBands>(3) << 24;
+    }
+    if ((num_bands != 4 && num_bands != 5) || tolerance >= BAND_COLOR_COUNT || tolerance_value[tolerance] == 0) {
+        return 0;
+    }
+    int num_digits = num_bands - 2;
+    return static_cast<PackedBands>(num_bands) << 24 | static_cast<PackedBands>(tolerance) << (4 * (num_digits + 1));
+}
+
+PackedBands encode_color_bands(long long significand, int exponent, int num_bands, BandColor tolerance) {
+    PackedBands bits = code_bits(num_bands, tolerance);
+    if (bits == 0 || significand <= 0) {
+        return 0;
+    }
+    int num_digits = num_bands == 5 ? 3 : 2;
+    long long lower = integer_powers_of_ten[num_digits - 1], upper = integer_powers_of_ten[num_digits];
+
+    // Round off the surplus digits in one step, so 1949 gives 19 rather than 195 then 20
+    int surplus = 0;
+    while (surplus + num_digits < INTEGER_POWERS && significand >= integer_powers_of_ten[surplus + num_digits]) {
+        surplus++;
+    }
+    if (surplus > 0) {
+        long long divisor = integer_powers_of_ten[surplus];
+        significand = (significand + divisor / 2) / divisor;
+        exponent += surplus;
+        if (significand == upper) {
+            significand /= 10;
+            exponent++;
+        }
+    }
+    while (significand < lower) {
+        significand *= 10;
+        exponent--;
+    }
+    return pack_significand(significand, exponent, num_digits, bits);
+}
+
+// Rounds a resistance to num_digits significant digits as significand x 10^exponent.
+// The decimal exponent is estimated from the binary one (1233 / 4096 ~ log10(2)) and
+// the scaled value, divided by an exact power of ten, corrects it by at most a step.
+static inline bool round_resistance(double resistance, int num_digits, long long& significand, int& exponent) {
+    if (!(resistance > 0) || !(resistance < 1e12)) {
+        return false;
+    }
+    int binary_exponent;
+    std::frexp(resistance, &binary_exponent);
+    int e = (((binary_exponent - 1) * 1233) >> 12) - (num_digits - 1);
+    if (e < MIN_BAND_EXPONENT) e = MIN_BAND_EXPONENT;
+    if (e > MAX_BAND_EXPONENT) e = MAX_BAND_EXPONENT;
+    long long lower = integer_powers_of_ten[num_digits - 1], upper = integer_powers_of_ten[num_digits];
+    for (;;) {
+        double scaled = e >= 0 ? resistance / powers_of_ten[e] : resistance * powers_of_ten[-e];
+        long long s = static_cast<long long>(scaled + 0.5);
+        if (s >= upper) {
+            if (e == MAX_BAND_EXPONENT) {
+                return false;
+            }
+            e++;
+        }
+        else if (s < lower) {
+            if (e == MIN_BAND_EXPONENT) {
+                return false;
+            }
+            e--;
+        }
+        else {
+            significand = s;
+            exponent = e;
+            return true;
+        }
+    }
+}
+
+PackedBands encode_color_bands(double resistance, int num_bands, BandColor tolerance) {
+    PackedBands bits = code_bits(num_bands, tolerance);
+    long long significand;
+    int exponent;
+    int num_digits = num_bands == 5 ? 3 : 2;
+    if (bits == 0 || !round_resistance(resistance, num_digits, significand, exponent)) {
+        return 0;
+    }
+    return pack_significand(significand, exponent, num_digits, bits);
+}
+
+int encode_color_bands(const double* resistances, int count, int num_bands, BandColor tolerance, PackedBands* codes) {
+    PackedBands bits = code_bits(num_bands, tolerance);
+    int num_digits = num_bands == 5 ? 3 : 2;
+    int valid = 0;
+    for (int i = 0; i < count; i++) {
+        long long significand;
+        int exponent;
+        codes[i] = 0;
+        if (bits != 0 && round_resistance(resistances[i], num_digits, significand, exponent)) {
+            codes[i] = pack_significand(significand, exponent, num_digits, bits);
+            valid++;
+        }
+    }
+    return valid;
+}
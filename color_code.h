@@ -0,0 +1,66 @@
+#ifndef COLOR_CODE_H
+#define COLOR_CODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// IEC 60062 resistor colour codes with 3 to 6 bands.
+// Colours are small integer IDs; a whole code is packed into one 32-bit word (4 bits per
+// band, first band lowest, band count in bits 24..27), so decoding is a handful of dense
+// table lookups with no strings or allocation. Colour names are matched through a
+// compile-time table keyed on their third and last letters. Encoding rounds to the
+// significant digits of the code in integer arithmetic, without log10 or pow.
+//   3 bands: digit digit multiplier            (20% tolerance)
+//   4 bands: digit digit multiplier tolerance
+//   5 bands: digit digit digit multiplier tolerance
+//   6 bands: digit digit digit multiplier tolerance tempco
+
+enum BandColor : unsigned char {
+    BLACK = 0, BROWN, RED, ORANGE, YELLOW, GREEN, BLUE, VIOLET, GRAY, WHITE,
+    GOLD, SILVER, PINK,
+    NO_BAND,             // the missing fourth band of a 20% part ("none")
+    INVALID_COLOR = 0xFF
+};
+
+const int BAND_COLOR_COUNT = 14;
+const int MIN_BANDS = 3;
+const int MAX_BANDS = 6;
+
+typedef uint32_t PackedBands;
+
+// Case-insensitive, accepts "grey" and "purple" too; INVALID_COLOR if unknown
+BandColor parse_band_color(const char* name, size_t length);
+BandColor parse_band_color(const std::string& name);
+const char* band_color_name(BandColor color);
+
+// 0 if the count is outside 3..6 or a colour is invalid
+PackedBands pack_color_bands(const BandColor* bands, int count);
+int packed_band_count(PackedBands bands);
+BandColor packed_band(PackedBands bands, int index);
+
+struct ResistorCode {
+    double resistance; // ohms, -1 if the code is invalid
+    double tolerance;  // relative, e.g. 0.01 for 1%
+    int tempco;        // ppm/K, 0 without a tempco band
+};
+
+bool decode_color_bands(PackedBands bands, ResistorCode& code);
+// Decodes a whole array and returns how many codes were valid
+int decode_color_bands(const PackedBands* bands, int count, ResistorCode* codes);
+
+// Multiplier band range, 10^-3 (pink) to 10^9 (white)
+const int MIN_BAND_EXPONENT = -3;
+const int MAX_BAND_EXPONENT = 9;
+
+// 3-, 4- or 5-band code of significand x 10^exponent, e.g. an E-series mantissa and
+// decade. The significand is rounded to the 2 (3 for 5 bands) digits of the code;
+// tolerance is the last band of 4- and 5-band codes (NO_BAND is 20% on 4 bands).
+// 0 if the value can't be coded or the bands are invalid.
+PackedBands encode_color_bands(long long significand, int exponent, int num_bands, BandColor tolerance);
+// Same for a resistance in ohms, rounded to the nearest code value (4.7 -> 47 x gold)
+PackedBands encode_color_bands(double resistance, int num_bands, BandColor tolerance);
+// Encodes a whole array, 0 for values without a code, and returns how many were coded
+int encode_color_bands(const double* resistances, int count, int num_bands, BandColor tolerance, PackedBands* codes);
+
+#endif
@@ -0,0 +1,535 @@
+#include <iostream>
+#include "daemon.h"
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "batch.h"
+
+const uint32_t DAEMON_MAX_REQUEST = 1 << 20;  // longest request frame, bytes; longer ones drop the connection
+const uint64_t DAEMON_MAX_PENDING = 4096;     // requests in flight per connection before it stops being read
+const size_t DAEMON_MAX_OUTPUT = 1 << 22;     // unsent response bytes per connection before it stops being read
+const int DAEMON_READ_BYTES = 65536;
+const int DAEMON_EVENTS = 256;
+
+// epoll tags: the daemon's own descriptors, then one per connection from DAEMON_FIRST_CONNECTION
+const uint64_t DAEMON_WAKE = 0, DAEMON_SIGNAL = 1, DAEMON_UNIX = 2, DAEMON_TCP = 3, DAEMON_FIRST_CONNECTION = 16;
+
+// One request on its way through the pool; text is the request line, then the response
+struct DaemonJob {
+    uint64_t connection;
+    uint64_t sequence;
+    std::string text;
+};
+
+struct DaemonConnection {
+    int fd = -1;
+    std::string input;                       // received bytes, frames from input_start on not yet taken
+    size_t input_start = 0;
+    std::string output;                      // framed responses, from output_start on not yet sent
+    size_t output_start = 0;
+    uint64_t next_sequence = 0;              // given to the next request
+    uint64_t next_response = 0;              // the response to send next
+    std::map<uint64_t, std::string> early;   // responses finished before an earlier one
+    bool peer_closed = false;                // the client sent everything it will send
+    uint32_t events = 0;                     // what epoll is watching for
+};
+
+// Fixed pool of calculation threads. The event loop submits jobs; finished ones queue up
+// for collect() and the loop is woken through the eventfd once per batch of results.
+class WorkerPool {
+public:
+    WorkerPool(int num_threads, int wake_fd) : wake_fd(wake_fd) {
+        for (int i = 0; i < num_threads; i++) {
+            workers.emplace_back([this] { worker(); });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (std::thread& thread : workers) {
+            thread.join();
+        }
+    }
+
+    void submit(std::vector<DaemonJob>& jobs) {
+        if (jobs.empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            for (DaemonJob& job : jobs) {
+                pending.push_back(std::move(job));
+            }
+        }
+        if (jobs.size() == 1) {
+            ready.notify_one();
+        }
+        else {
+            ready.notify_all();
+        }
+        jobs.clear();
+    }
+
+    // Swaps the finished jobs into results, which must be empty
+    void collect(std::vector<DaemonJob>& results) {
+        std::lock_guard<std::mutex> lock(finished_mutex);
+        results.swap(finished);
+    }
+
+private:
+    void worker() {
+        std::ostringstream out;
+        for (;;) {
+            DaemonJob job;
+            {
+                std::unique_lock<std::mutex> lock(pending_mutex);
+                ready.wait(lock, [this] { return stopping || !pending.empty(); });
+                if (stopping) {
+                    return;
+                }
+                job = std::move(pending.front());
+                pending.pop_front();
+            }
+            out.str("");
+            out.clear();
+            // A request that throws (out of memory, say) fails on its own, not the whole daemon
+            try {
+                run_batch_line(job.text, out);
+            }
+            catch (const std::exception& e) {
+                out.str("");
+                out.clear();
+                out << "error: " << e.what() << "\n";
+            }
+            job.text = out.str();
+
+            // Only the first result since the last collect() needs to wake the loop
+            bool first;
+            {
+                std::lock_guard<std::mutex> lock(finished_mutex);
+                first = finished.empty();
+                finished.push_back(std::move(job));
+            }
+            if (first) {
+                uint64_t one = 1;
+                ssize_t written = write(wake_fd, &one, sizeof(one));
+                (void)written;
+            }
+        }
+    }
+
+    int wake_fd;
+    std::vector<std::thread> workers;
+    std::mutex pending_mutex;
+    std::condition_variable ready;
+    std::deque<DaemonJob> pending;
+    bool stopping = false;
+    std::mutex finished_mutex;
+    std::vector<DaemonJob> finished;
+};
+
+// Function to listen on a Unix socket path, replacing a stale socket left by a daemon that died
+static int listen_unix(const std::string& path, std::string& error) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        error = "socket path too long: " + path;
+        return -1;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    const sockaddr* name = reinterpret_cast<const sockaddr*>(&address);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = std::string("cannot create a socket: ") + std::strerror(errno);
+        return -1;
+    }
+    bool bound = bind(fd, name, sizeof(address)) == 0;
+    if (!bound && errno == EADDRINUSE) {
+        // A socket nobody accepts on is stale; one that answers belongs to a running daemon
+        struct stat info;
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool live = probe >= 0 && connect(probe, name, sizeof(address)) == 0;
+        if (probe >= 0) {
+            close(probe);
+        }
+        if (live || lstat(path.c_str(), &info) != 0 || !S_ISSOCK(info.st_mode)) {
+            error = path + (live ? " is served by another daemon" : " exists and is not a socket");
+            close(fd);
+            return -1;
+        }
+        unlink(path.c_str());
+        bound = bind(fd, name, sizeof(address)) == 0;
+    }
+    if (!bound || listen(fd, SOMAXCONN) < 0) {
+        error = "cannot listen on " + path + ": " + std::strerror(errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Function to listen on a TCP port of the loopback interface only
+static int listen_tcp(int port, std::string& error) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+        bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        error = "cannot listen on 127.0.0.1:" + std::to_string(port) + ": " + std::strerror(errno);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+static bool watch(int epoll_fd, int fd, uint64_t tag, uint32_t events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = tag;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+// Function to accept every waiting client on a listening socket
+static void accept_clients(int listen_fd, bool tcp, int epoll_fd,
+                           std::unordered_map<uint64_t, DaemonConnection>& connections, uint64_t& next_tag) {
+    for (;;) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        if (tcp) {
+            // Responses are small and awaited, so don't let Nagle hold them back
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        uint64_t tag = next_tag++;
+        if (!watch(epoll_fd, fd, tag, EPOLLIN)) {
+            close(fd);
+            continue;
+        }
+        DaemonConnection& connection = connections[tag];
+        connection.fd = fd;
+        connection.events = EPOLLIN;
+    }
+}
+
+// Function to read what the client has sent; false if the connection failed
+static bool read_input(DaemonConnection& connection, char* buffer) {
+    while (connection.input.size() - connection.input_start < DAEMON_MAX_REQUEST + 4) {
+        ssize_t count = recv(connection.fd, buffer, DAEMON_READ_BYTES, 0);
+        if (count > 0) {
+            connection.input.append(buffer, count);
+            if (count < DAEMON_READ_BYTES) {
+                break;
+            }
+        }
+        else if (count == 0) {
+            connection.peer_closed = true;
+            break;
+        }
+        else if (errno != EINTR) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+    }
+    return true;
+}
+
+// Function to cut complete frames off the input into jobs; false for an oversized frame
+static bool take_requests(DaemonConnection& connection, uint64_t tag, std::vector<DaemonJob>& jobs) {
+    bool ok = true;
+    while (connection.next_sequence - connection.next_response < DAEMON_MAX_PENDING) {
+        size_t available = connection.input.size() - connection.input_start;
+        if (available < 4) {
+            break;
+        }
+        const unsigned char* header = reinterpret_cast<const unsigned char*>(connection.input.data()) + connection.input_start;
+        uint32_t length = static_cast<uint32_t>(header[0]) << 24 | static_cast<uint32_t>(header[1]) << 16 |
+                          static_cast<uint32_t>(header[2]) << 8 | header[3];
+        if (length > DAEMON_MAX_REQUEST) {
+            ok = false;
+            break;
+        }
+        if (available < 4 + static_cast<size_t>(length)) {
+            break;
+        }
+        jobs.push_back({ tag, connection.next_sequence++, connection.input.substr(connection.input_start + 4, length) });
+        connection.input_start += 4 + length;
+    }
+    // Move a partial frame to the front once most of the buffer is used up
+    if (connection.input_start == connection.input.size()) {
+        connection.input.clear();
+        connection.input_start = 0;
+    }
+    else if (connection.input_start > connection.input.size() / 2) {
+        connection.input.erase(0, connection.input_start);
+        connection.input_start = 0;
+    }
+    return ok;
+}
+
+static void append_response(std::string& output, const std::string& text) {
+    uint32_t length = static_cast<uint32_t>(text.size());
+    char header[4] = { static_cast<char>(length >> 24), static_cast<char>(length >> 16),
+                       static_cast<char>(length >> 8), static_cast<char>(length) };
+    output.append(header, 4);
+    output += text;
+}
+
+// Function to queue a finished job's response, keeping the connection's request order
+static void deliver(DaemonConnection& connection, DaemonJob& job) {
+    if (job.sequence != connection.next_response) {
+        connection.early.emplace(job.sequence, std::move(job.text));
+        return;
+    }
+    append_response(connection.output, job.text);
+    connection.next_response++;
+    auto next = connection.early.begin();
+    while (next != connection.early.end() && next->first == connection.next_response) {
+        append_response(connection.output, next->second);
+        connection.next_response++;
+        next = connection.early.erase(next);
+    }
+}
+
+// Function to send queued responses until the socket is full; false if the connection failed
+static bool send_output(DaemonConnection& connection) {
+    while (connection.output_start < connection.output.size()) {
+        ssize_t count = send(connection.fd, connection.output.data() + connection.output_start,
+                             connection.output.size() - connection.output_start, MSG_NOSIGNAL);
+        if (count > 0) {
+            connection.output_start += count;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return true;
+        }
+        else if (errno != EINTR) {
+            return false;
+        }
+    }
+    connection.output.clear();
+    connection.output_start = 0;
+    return true;
+}
+
+// Function to watch for input while the connection has room for more requests, and for
+// output space while responses are waiting
+static bool update_events(int epoll_fd, DaemonConnection& connection, uint64_t tag) {
+    size_t unsent = connection.output.size() - connection.output_start;
+    uint32_t events = 0;
+    if (!connection.peer_closed && connection.next_sequence - connection.next_response < DAEMON_MAX_PENDING &&
+        connection.input.size() - connection.input_start < DAEMON_MAX_REQUEST + 4 && unsent < DAEMON_MAX_OUTPUT) {
+        events |= EPOLLIN;
+    }
+    if (unsent > 0) {
+        events |= EPOLLOUT;
+    }
+    if (events == connection.events) {
+        return true;
+    }
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = tag;
+    connection.events = events;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection.fd, &event) == 0;
+}
+
+int run_daemon(const DaemonOptions& options, std::ostream& log) {
+    if (options.socket_path.empty() && options.tcp_port == 0) {
+        log << "error: the daemon needs a socket path or a TCP port\n";
+        return 1;
+    }
+
+    // Block the stop signals in this thread and, by inheritance, the workers, so they
+    // arrive through the signalfd and the loop can clean up
+    sigset_t stop_signals, old_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &old_signals);
+
+    std::string error;
+    int signal_fd = signalfd(-1, &stop_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    int wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    int unix_fd = -1, tcp_fd = -1;
+    bool ok = signal_fd >= 0 && wake_fd >= 0 && epoll_fd >= 0 && watch(epoll_fd, signal_fd, DAEMON_SIGNAL, EPOLLIN) &&
+              watch(epoll_fd, wake_fd, DAEMON_WAKE, EPOLLIN);
+    if (!ok) {
+        error = std::string("cannot set up the event loop: ") + std::strerror(errno);
+    }
+    if (ok && !options.socket_path.empty()) {
+        unix_fd = listen_unix(options.socket_path, error);
+        ok = unix_fd >= 0 && watch(epoll_fd, unix_fd, DAEMON_UNIX, EPOLLIN);
+    }
+    if (ok && options.tcp_port != 0) {
+        tcp_fd = listen_tcp(options.tcp_port, error);
+        ok = tcp_fd >= 0 && watch(epoll_fd, tcp_fd, DAEMON_TCP, EPOLLIN);
+    }
+
+    if (ok) {
+        int num_threads = options.num_threads > 0 ? options.num_threads
+                                                  : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        log << "listening on";
+        if (unix_fd >= 0) {
+            log << " " << options.socket_path;
+        }
+        if (tcp_fd >= 0) {
+            log << (unix_fd >= 0 ? " and" : "") << " 127.0.0.1:" << options.tcp_port;
+        }
+        log << " with " << num_threads << (num_threads == 1 ? " worker" : " workers") << std::endl;
+
+        WorkerPool pool(num_threads, wake_fd);
+        std::unordered_map<uint64_t, DaemonConnection> connections;
+        uint64_t next_tag = DAEMON_FIRST_CONNECTION;
+        std::vector<epoll_event> events(DAEMON_EVENTS);
+        std::vector<char> buffer(DAEMON_READ_BYTES);
+        std::vector<DaemonJob> jobs, results;
+        std::vector<uint64_t> touched;
+        auto close_connection = [&connections](uint64_t tag) {
+            auto found = connections.find(tag);
+            if (found != connections.end()) {
+                close(found->second.fd);
+                connections.erase(found);
+            }
+        };
+
+        bool running = true;
+        while (running) {
+            int count = epoll_wait(epoll_fd, events.data(), DAEMON_EVENTS, -1);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                log << "error: epoll_wait: " << std::strerror(errno) << "\n";
+                break;
+            }
+            for (int i = 0; i < count; i++) {
+                uint64_t tag = events[i].data.u64;
+                if (tag == DAEMON_SIGNAL) {
+                    // Consume the signal, or it would be delivered once the mask is restored
+                    signalfd_siginfo info{};
+                    ssize_t taken = read(signal_fd, &info, sizeof(info));
+                    (void)taken;
+                    log << "stopping on signal " << info.ssi_signo << std::endl;
+                    running = false;
+                }
+                else if (tag == DAEMON_WAKE) {
+                    // Clear the eventfd before collecting, so a result finished after the
+                    // collect is sure to wake the loop again
+                    uint64_t value;
+                    ssize_t taken = read(wake_fd, &value, sizeof(value));
+                    (void)taken;
+                    pool.collect(results);
+                    for (DaemonJob& job : results) {
+                        auto found = connections.find(job.connection);
+                        if (found != connections.end()) {
+                            deliver(found->second, job);
+                            touched.push_back(job.connection);
+                        }
+                    }
+                    results.clear();
+                }
+                else if (tag == DAEMON_UNIX || tag == DAEMON_TCP) {
+                    accept_clients(tag == DAEMON_UNIX ? unix_fd : tcp_fd, tag == DAEMON_TCP, epoll_fd, connections, next_tag);
+                }
+                else {
+                    auto found = connections.find(tag);
+                    if (found == connections.end()) {
+                        continue;
+                    }
+                    // A hung-up client can't receive its responses
+                    if ((events[i].events & (EPOLLERR | EPOLLHUP)) ||
+                        ((events[i].events & EPOLLIN) && !read_input(found->second, buffer.data()))) {
+                        close_connection(tag);
+                        continue;
+                    }
+                    touched.push_back(tag);
+                }
+            }
+
+            // Take new requests (or ones held back by the in-flight limit), send what is
+            // ready, then close connections that are done or broken
+            std::sort(touched.begin(), touched.end());
+            touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+            for (uint64_t tag : touched) {
+                auto found = connections.find(tag);
+                if (found == connections.end()) {
+                    continue;
+                }
+                DaemonConnection& connection = found->second;
+                bool keep = take_requests(connection, tag, jobs) && send_output(connection) &&
+                            update_events(epoll_fd, connection, tag);
+                bool finished = connection.peer_closed && connection.next_response == connection.next_sequence &&
+                                connection.output.empty();
+                if (!keep || finished) {
+                    close_connection(tag);
+                }
+            }
+            touched.clear();
+            pool.submit(jobs);
+        }
+
+        for (auto& connection : connections) {
+            close(connection.second.fd);
+        }
+    }
+    else {
+        log << "error: " << error << "\n";
+    }
+
+    if (unix_fd >= 0) {
+        close(unix_fd);
+        unlink(options.socket_path.c_str());
+    }
+    for (int fd : { tcp_fd, epoll_fd, wake_fd, signal_fd }) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old_signals, nullptr);
+    return ok ? 0 : 1;
+}
+
+#else
+
+int run_daemon(const DaemonOptions&, std::ostream& log) {
+    log << "error: daemon mode needs Linux (epoll)\n";
+    return 1;
+}
+
+#endif
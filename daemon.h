@@ -0,0 +1,29 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <iostream>
+#include <string>
+
+// Daemon mode: a long-running server for plugins, BOM checkers and CI jobs that would
+// otherwise start a process per calculation. It listens on a Unix domain socket and,
+// optionally, a TCP port on 127.0.0.1.
+//
+// Protocol: each request is a 4-byte big-endian length followed by one batch request
+// line, e.g. "rc-cutoff r=10k c=100n". Each response is a 4-byte big-endian length
+// followed by what --batch prints for that line ("fc=159.155\n" or "error: ...\n").
+// Clients may pipeline: send any number of requests without waiting, and the responses
+// come back in request order on that connection.
+//
+// One thread runs an epoll loop over every socket; a fixed pool of workers runs the
+// calculations. SIGINT or SIGTERM stops the daemon and removes the socket file.
+
+struct DaemonOptions {
+    std::string socket_path;   // Unix socket to listen on, "" for none
+    int tcp_port = 0;          // 127.0.0.1 port to listen on, 0 for none
+    int num_threads = 0;       // workers, 0 for one per hardware thread
+};
+
+// Runs until SIGINT or SIGTERM; returns 0, or 1 if the sockets could not be set up
+int run_daemon(const DaemonOptions& options, std::ostream& log);
+
+#endif
@@ -0,0 +1,1041 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include "dc_solver.h"
+#include "si_value.h"
+
+const int DC_CHUNK_ROWS = 8192; // rows per work item; partial sums are merged in chunk order
+
+// Conductance matrix in compressed sparse row form, diagonal kept separately too
+struct CsrMatrix {
+    int rows = 0;
+    std::vector<int> row_start; // rows + 1 entries
+    std::vector<int> columns;
+    std::vector<double> values;
+    std::vector<double> diagonal;
+};
+
+// Union-find over nodes with potentials: offset[x] = V(x) - V(parent[x])
+struct PotentialSets {
+    std::vector<int> parent;
+    std::vector<double> offset;
+
+    explicit PotentialSets(int n) : parent(n), offset(n, 0) {
+        for (int i = 0; i < n; i++) {
+            parent[i] = i;
+        }
+    }
+
+    // Root of x; afterwards offset[x] = V(x) - V(root). Iterative, so long chains are fine
+    int find(int x) {
+        int root = x;
+        double total = 0;
+        while (parent[root] != root) {
+            total += offset[root];
+            root = parent[root];
+        }
+        while (x != root) {
+            int next = parent[x];
+            double step = offset[x];
+            parent[x] = root;
+            offset[x] = total;
+            total -= step;
+            x = next;
+        }
+        return root;
+    }
+
+    // Records V(a) - V(b) = difference; false if a and b are already joined
+    bool join(int a, int b, double difference) {
+        int root_a = find(a), root_b = find(b);
+        if (root_a == root_b) {
+            return false;
+        }
+        parent[root_a] = root_b;
+        offset[root_a] = difference - offset[a] + offset[b];
+        return true;
+    }
+};
+
+static int find_set(std::vector<int>& parent, int x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+// Fork-join pool: run() hands out chunk indices to the caller and the parked workers
+// and returns once every chunk is done. Workers stay alive across the PCG iterations.
+class ChunkPool {
+public:
+    explicit ChunkPool(int num_threads) {
+        for (int i = 1; i < num_threads; i++) {
+            workers.emplace_back([this] { worker(); });
+        }
+    }
+
+    ~ChunkPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            generation++;
+        }
+        wake.notify_all();
+        for (std::thread& thread : workers) {
+            thread.join();
+        }
+    }
+
+    void run(int chunks, const std::function<void(int)>& fn) {
+        if (workers.empty() || chunks == 1) {
+            for (int c = 0; c < chunks; c++) {
+                fn(c);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = &fn;
+            num_chunks = chunks;
+            next_chunk = 0;
+            busy = static_cast<int>(workers.size());
+            generation++;
+        }
+        wake.notify_all();
+        work();
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busy == 0; });
+    }
+
+private:
+    void work() {
+        for (int c = next_chunk++; c < num_chunks; c = next_chunk++) {
+            (*task)(c);
+        }
+    }
+
+    void worker() {
+        long long seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this, seen] { return generation != seen; });
+                seen = generation;
+                if (stopping) {
+                    return;
+                }
+            }
+            work();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy == 0) {
+                done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int)>* task = nullptr;
+    int num_chunks = 0;
+    std::atomic<int> next_chunk{ 0 };
+    int busy = 0;
+    long long generation = 0;
+    bool stopping = false;
+};
+
+// Reverse Cuthill-McKee order (new index -> row): each component is walked breadth first
+// from a pseudo-peripheral row, neighbours in increasing degree, which keeps the envelope
+// of grid-like matrices down to about one grid row.
+static std::vector<int> reverse_cuthill_mckee(const CsrMatrix& a) {
+    int n = a.rows;
+    std::vector<int> degree(n), order, level(n, -1), neighbours;
+    std::vector<char> placed(n, 0);
+    order.reserve(n);
+    for (int i = 0; i < n; i++) {
+        degree[i] = a.row_start[i + 1] - a.row_start[i] - 1;
+    }
+
+    std::vector<int> queue;
+    queue.reserve(n);
+    for (int seed = 0; seed < n; seed++) {
+        if (placed[seed]) {
+            continue;
+        }
+        // One breadth-first pass from the seed; the start is the lowest-degree row of its last level
+        queue.clear();
+        queue.push_back(seed);
+        level[seed] = 0;
+        for (size_t head = 0; head < queue.size(); head++) {
+            int row = queue[head];
+            for (int k = a.row_start[row]; k < a.row_start[row + 1]; k++) {
+                int column = a.columns[k];
+                if (level[column] < 0) {
+                    level[column] = level[row] + 1;
+                    queue.push_back(column);
+                }
+            }
+        }
+        int start = queue.back();
+        for (size_t i = queue.size(); i-- > 0 && level[queue[i]] == level[queue.back()];) {
+            if (degree[queue[i]] < degree[start]) {
+                start = queue[i];
+            }
+        }
+
+        size_t head = order.size();
+        order.push_back(start);
+        placed[start] = 1;
+        for (; head < order.size(); head++) {
+            int row = order[head];
+            neighbours.clear();
+            for (int k = a.row_start[row]; k < a.row_start[row + 1]; k++) {
+                if (!placed[a.columns[k]]) {
+                    placed[a.columns[k]] = 1;
+                    neighbours.push_back(a.columns[k]);
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end(), [&degree](int x, int y) {
+                return degree[x] < degree[y] || (degree[x] == degree[y] && x < y);
+            });
+            order.insert(order.end(), neighbours.begin(), neighbours.end());
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+// Envelope (variable band) Cholesky factor in RCM order. Row k of L is stored densely
+// from its first non-zero column to the diagonal.
+struct EnvelopeFactor {
+    std::vector<int> order; // new index -> row
+    std::vector<int> first; // first column of each row of L
+    std::vector<long long> start;
+    std::vector<double> l;
+    std::vector<double> scratch;
+};
+
+// False if the envelope is over DC_DIRECT_MAX_ENTRIES or the matrix isn't positive definite
+static bool factor_envelope(const CsrMatrix& a, EnvelopeFactor& factor) {
+    int n = a.rows;
+    factor.order = reverse_cuthill_mckee(a);
+    std::vector<int> position(n);
+    for (int k = 0; k < n; k++) {
+        position[factor.order[k]] = k;
+    }
+
+    std::vector<int>& first = factor.first;
+    std::vector<long long>& start = factor.start;
+    first.resize(n);
+    start.assign(n + 1, 0);
+    for (int k = 0; k < n; k++) {
+        int row = factor.order[k];
+        first[k] = k;
+        for (int j = a.row_start[row]; j < a.row_start[row + 1]; j++) {
+            first[k] = std::min(first[k], position[a.columns[j]]);
+        }
+        start[k + 1] = start[k] + (k - first[k] + 1);
+    }
+    if (start[n] > DC_DIRECT_MAX_ENTRIES) {
+        return false;
+    }
+
+    std::vector<double>& l = factor.l;
+    l.assign(start[n], 0);
+    for (int k = 0; k < n; k++) {
+        int row = factor.order[k];
+        for (int j = a.row_start[row]; j < a.row_start[row + 1]; j++) {
+            int column = position[a.columns[j]];
+            if (column <= k) {
+                l[start[k] + column - first[k]] = a.values[j];
+            }
+        }
+    }
+
+    for (int k = 0; k < n; k++) {
+        double* row_k = &l[start[k]] - first[k]; // row_k[j] is L(k, j) for first[k] <= j <= k
+        for (int j = first[k]; j < k; j++) {
+            const double* row_j = &l[start[j]] - first[j];
+            double value = row_k[j];
+            for (int m = std::max(first[k], first[j]); m < j; m++) {
+                value -= row_k[m] * row_j[m];
+            }
+            row_k[j] = value / row_j[j];
+        }
+        double pivot = row_k[k];
+        for (int m = first[k]; m < k; m++) {
+            pivot -= row_k[m] * row_k[m];
+        }
+        if (!(pivot > 0)) {
+            return false;
+        }
+        row_k[k] = std::sqrt(pivot);
+    }
+    factor.scratch.resize(n);
+    return true;
+}
+
+static void solve_envelope(EnvelopeFactor& factor, const double* b, double* x) {
+    int n = static_cast<int>(factor.order.size());
+    std::vector<double>& y = factor.scratch;
+    for (int k = 0; k < n; k++) {
+        const double* row_k = &factor.l[factor.start[k]] - factor.first[k];
+        double value = b[factor.order[k]];
+        for (int m = factor.first[k]; m < k; m++) {
+            value -= row_k[m] * y[m];
+        }
+        y[k] = value / row_k[k];
+    }
+    for (int k = n - 1; k >= 0; k--) {
+        const double* row_k = &factor.l[factor.start[k]] - factor.first[k];
+        y[k] /= row_k[k];
+        for (int m = factor.first[k]; m < k; m++) {
+            y[m] -= row_k[m] * y[k];
+        }
+    }
+    for (int k = 0; k < n; k++) {
+        x[factor.order[k]] = y[k];
+    }
+}
+
+// Aggregation multigrid, used as the CG preconditioner. Each level groups strongly
+// coupled rows into aggregates of about 5 to 9 and sums them into a coarse row
+// (Galerkin product with a piecewise-constant prolongation). A V-cycle does one forward
+// Gauss-Seidel sweep, restricts the residual, recurses, adds the over-relaxed coarse
+// correction back and finishes with one backward sweep, so the preconditioner stays
+// symmetric. Sweeps are Gauss-Seidel inside each row chunk and Jacobi across chunks,
+// reading other chunks' old values, so they run in parallel and deterministically.
+const int MG_COARSEST_ROWS = 2000;
+const int MG_MAX_LEVELS = 25;
+const double MG_STRONG_COUPLING = 0.25; // -a_ij >= this x the row's largest, counts as strong
+const double MG_CORRECTION_SCALE = 1.8; // piecewise-constant corrections undershoot, scale them up
+
+struct MultigridLevel {
+    const CsrMatrix* a;
+    CsrMatrix coarse_matrix;           // storage for every level but the finest
+    std::vector<int> aggregate;        // row -> row of the next level
+    std::vector<int> member_start;     // next level's row -> rows of this level
+    std::vector<int> members;
+    std::vector<double> x, b, r, old;
+};
+
+struct Multigrid {
+    std::vector<MultigridLevel> levels;
+    EnvelopeFactor coarsest;
+    bool coarsest_factored;
+};
+
+static int row_chunks(int rows) {
+    return (rows + DC_CHUNK_ROWS - 1) / DC_CHUNK_ROWS;
+}
+
+// Greedy aggregation: a row whose strong neighbours are all free starts an aggregate with
+// them, then leftover rows join their most strongly coupled aggregate (or start their own)
+static int aggregate_rows(const CsrMatrix& a, std::vector<int>& aggregate) {
+    int n = a.rows;
+    std::vector<double> threshold(n, 0);
+    for (int i = 0; i < n; i++) {
+        for (int k = a.row_start[i]; k < a.row_start[i + 1]; k++) {
+            if (a.columns[k] != i) {
+                threshold[i] = std::max(threshold[i], -a.values[k]);
+            }
+        }
+        threshold[i] *= MG_STRONG_COUPLING;
+    }
+    auto strong = [&a, &threshold](int i, int k) {
+        return a.columns[k] != i && -a.values[k] >= threshold[i] && -a.values[k] > 0;
+    };
+
+    aggregate.assign(n, -1);
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        if (aggregate[i] >= 0) {
+            continue;
+        }
+        bool free = true;
+        for (int k = a.row_start[i]; k < a.row_start[i + 1] && free; k++) {
+            free = !strong(i, k) || aggregate[a.columns[k]] < 0;
+        }
+        if (!free) {
+            continue;
+        }
+        aggregate[i] = count;
+        for (int k = a.row_start[i]; k < a.row_start[i + 1]; k++) {
+            if (strong(i, k)) {
+                aggregate[a.columns[k]] = count;
+            }
+        }
+        count++;
+    }
+    int first_pass = count;
+    for (int i = 0; i < n; i++) {
+        if (aggregate[i] >= 0) {
+            continue;
+        }
+        int best = -1;
+        double best_coupling = 0;
+        for (int k = a.row_start[i]; k < a.row_start[i + 1]; k++) {
+            int j = a.columns[k];
+            // Only joins aggregates from the first pass, so this pass doesn't chain
+            if (j != i && aggregate[j] >= 0 && aggregate[j] < first_pass && -a.values[k] > best_coupling) {
+                best = aggregate[j];
+                best_coupling = -a.values[k];
+            }
+        }
+        aggregate[i] = best >= 0 ? best : count++;
+    }
+    return count;
+}
+
+// Coarse matrix: entry (I, J) sums a_ij over i in aggregate I and j in aggregate J
+static void galerkin_product(MultigridLevel& level, int coarse_rows) {
+    const CsrMatrix& a = *level.a;
+    level.member_start.assign(coarse_rows + 1, 0);
+    for (int i = 0; i < a.rows; i++) {
+        level.member_start[level.aggregate[i] + 1]++;
+    }
+    for (int c = 0; c < coarse_rows; c++) {
+        level.member_start[c + 1] += level.member_start[c];
+    }
+    level.members.resize(a.rows);
+    std::vector<int> slot(level.member_start.begin(), level.member_start.end() - 1);
+    for (int i = 0; i < a.rows; i++) {
+        level.members[slot[level.aggregate[i]]++] = i;
+    }
+
+    CsrMatrix& coarse = level.coarse_matrix;
+    coarse.rows = coarse_rows;
+    coarse.row_start.assign(1, 0);
+    coarse.columns.clear();
+    coarse.values.clear();
+    coarse.diagonal.assign(coarse_rows, 0);
+    std::vector<int> where(coarse_rows, -1); // position of column J in the row being built
+    for (int c = 0; c < coarse_rows; c++) {
+        int row_begin = static_cast<int>(coarse.columns.size());
+        coarse.columns.push_back(c); // diagonal first, as in the finest matrix
+        coarse.values.push_back(0);
+        where[c] = row_begin;
+        for (int m = level.member_start[c]; m < level.member_start[c + 1]; m++) {
+            int i = level.members[m];
+            for (int k = a.row_start[i]; k < a.row_start[i + 1]; k++) {
+                int column = level.aggregate[a.columns[k]];
+                if (where[column] < row_begin) {
+                    where[column] = static_cast<int>(coarse.columns.size());
+                    coarse.columns.push_back(column);
+                    coarse.values.push_back(0);
+                }
+                coarse.values[where[column]] += a.values[k];
+            }
+        }
+        coarse.diagonal[c] = coarse.values[row_begin];
+        coarse.row_start.push_back(static_cast<int>(coarse.columns.size()));
+    }
+}
+
+static void setup_multigrid(const CsrMatrix& a, Multigrid& mg) {
+    mg.levels.clear();
+    mg.levels.reserve(MG_MAX_LEVELS);
+    mg.levels.emplace_back();
+    mg.levels[0].a = &a;
+    while (true) {
+        MultigridLevel& level = mg.levels.back();
+        int rows = level.a->rows;
+        level.x.resize(rows);
+        level.b.resize(rows);
+        level.r.resize(rows);
+        level.old.resize(rows);
+        if (rows <= MG_COARSEST_ROWS || static_cast<int>(mg.levels.size()) == MG_MAX_LEVELS) {
+            break;
+        }
+        int coarse_rows = aggregate_rows(*level.a, level.aggregate);
+        if (coarse_rows > rows * 0.9) {
+            level.aggregate.clear(); // aggregation has stalled, solve here
+            break;
+        }
+        galerkin_product(level, coarse_rows);
+        const CsrMatrix* coarse = &level.coarse_matrix;
+        mg.levels.emplace_back();
+        mg.levels.back().a = coarse;
+    }
+    mg.coarsest_factored = factor_envelope(*mg.levels.back().a, mg.coarsest);
+}
+
+// One hybrid Gauss-Seidel sweep on level.x for level.b
+static void smooth(MultigridLevel& level, ChunkPool& pool, bool forward) {
+    const CsrMatrix& a = *level.a;
+    level.old = level.x;
+    pool.run(row_chunks(a.rows), [&](int chunk) {
+        int begin = chunk * DC_CHUNK_ROWS, end = std::min(a.rows, begin + DC_CHUNK_ROWS);
+        for (int step = 0; step < end - begin; step++) {
+            int i = forward ? begin + step : end - 1 - step;
+            double value = level.b[i];
+            for (int k = a.row_start[i] + 1; k < a.row_start[i + 1]; k++) {
+                int j = a.columns[k];
+                value -= a.values[k] * (j >= begin && j < end ? level.x[j] : level.old[j]);
+            }
+            level.x[i] = value / a.diagonal[i];
+        }
+    });
+}
+
+// x = V-cycle(b) on level index and below, starting from x = 0
+static void v_cycle(Multigrid& mg, int index, ChunkPool& pool) {
+    MultigridLevel& level = mg.levels[index];
+    const CsrMatrix& a = *level.a;
+    if (index + 1 == static_cast<int>(mg.levels.size())) {
+        if (mg.coarsest_factored) {
+            solve_envelope(mg.coarsest, level.b.data(), level.x.data());
+            return;
+        }
+        std::fill(level.x.begin(), level.x.end(), 0);
+        for (int sweep = 0; sweep < 10; sweep++) {
+            smooth(level, pool, true);
+            smooth(level, pool, false);
+        }
+        return;
+    }
+
+    std::fill(level.x.begin(), level.x.end(), 0);
+    smooth(level, pool, true);
+    MultigridLevel& next = mg.levels[index + 1];
+    pool.run(row_chunks(a.rows), [&](int chunk) {
+        int begin = chunk * DC_CHUNK_ROWS, end = std::min(a.rows, begin + DC_CHUNK_ROWS);
+        for (int i = begin; i < end; i++) {
+            double value = level.b[i];
+            for (int k = a.row_start[i]; k < a.row_start[i + 1]; k++) {
+                value -= a.values[k] * level.x[a.columns[k]];
+            }
+            level.r[i] = value;
+        }
+    });
+    pool.run(row_chunks(next.a->rows), [&](int chunk) {
+        int begin = chunk * DC_CHUNK_ROWS, end = std::min(next.a->rows, begin + DC_CHUNK_ROWS);
+        for (int c = begin; c < end; c++) {
+            double value = 0;
+            for (int m = level.member_start[c]; m < level.member_start[c + 1]; m++) {
+                value += level.r[level.members[m]];
+            }
+            next.b[c] = value;
+        }
+    });
+    v_cycle(mg, index + 1, pool);
+    pool.run(row_chunks(a.rows), [&](int chunk) {
+        int begin = chunk * DC_CHUNK_ROWS, end = std::min(a.rows, begin + DC_CHUNK_ROWS);
+        for (int i = begin; i < end; i++) {
+            level.x[i] += MG_CORRECTION_SCALE * next.x[level.aggregate[i]];
+        }
+    });
+    smooth(level, pool, false);
+}
+
+// Conjugate gradients from x = 0 with the multigrid preconditioner. Vector updates and
+// dot products run over row chunks and partial sums are added in chunk order.
+static bool solve_pcg(const CsrMatrix& a, const std::vector<double>& b, std::vector<double>& x,
+                      const DcOptions& options, ChunkPool& pool, DcSolveInfo& info) {
+    int n = a.rows;
+    int num_chunks = row_chunks(n);
+    Multigrid mg;
+    setup_multigrid(a, mg);
+    std::vector<double>& z = mg.levels[0].x; // the preconditioner's output
+    std::vector<double>& r = mg.levels[0].b; // and input
+    std::vector<double> p(n), q(n);
+    std::vector<double> partial_a(num_chunks), partial_b(num_chunks);
+    r = b;
+    x.assign(n, 0);
+
+    auto sum = [](const std::vector<double>& partial) {
+        double total = 0;
+        for (double value : partial) {
+            total += value;
+        }
+        return total;
+    };
+    // r.r into partial_a and r.z into partial_b
+    auto dot_products = [&](int chunk) {
+        int begin = chunk * DC_CHUNK_ROWS, end = std::min(n, begin + DC_CHUNK_ROWS);
+        double rr = 0, rz = 0;
+        for (int i = begin; i < end; i++) {
+            rr += r[i] * r[i];
+            rz += r[i] * z[i];
+        }
+        partial_a[chunk] = rr;
+        partial_b[chunk] = rz;
+    };
+
+    info.iterations = 0;
+    info.residual = 0;
+    v_cycle(mg, 0, pool);
+    pool.run(num_chunks, dot_products);
+    double b_norm = std::sqrt(sum(partial_a));
+    double rz = sum(partial_b);
+    if (b_norm == 0) {
+        return true;
+    }
+    p = z;
+
+    int max_iterations = options.max_iterations > 0 ? options.max_iterations
+                                                    : static_cast<int>(10 * std::sqrt(static_cast<double>(n))) + 1000;
+    for (int iteration = 1; iteration <= max_iterations; iteration++) {
+        pool.run(num_chunks, [&](int chunk) {
+            int begin = chunk * DC_CHUNK_ROWS, end = std::min(n, begin + DC_CHUNK_ROWS);
+            double pq = 0;
+            for (int i = begin; i < end; i++) {
+                double row = 0;
+                for (int k = a.row_start[i]; k < a.row_start[i + 1]; k++) {
+                    row += a.values[k] * p[a.columns[k]];
+                }
+                q[i] = row;
+                pq += p[i] * row;
+            }
+            partial_a[chunk] = pq;
+        });
+        double pq = sum(partial_a);
+        info.iterations = iteration;
+        if (!(pq > 0)) {
+            return false; // not positive definite
+        }
+        double alpha = rz / pq;
+
+        pool.run(num_chunks, [&](int chunk) {
+            int begin = chunk * DC_CHUNK_ROWS, end = std::min(n, begin + DC_CHUNK_ROWS);
+            double rr = 0;
+            for (int i = begin; i < end; i++) {
+                x[i] += alpha * p[i];
+                r[i] -= alpha * q[i];
+                rr += r[i] * r[i];
+            }
+            partial_a[chunk] = rr;
+        });
+        info.residual = std::sqrt(sum(partial_a)) / b_norm;
+        if (info.residual <= options.tolerance) {
+            return true;
+        }
+
+        v_cycle(mg, 0, pool);
+        pool.run(num_chunks, dot_products);
+        double rz_new = sum(partial_b);
+        double beta = rz_new / rz;
+        rz = rz_new;
+        pool.run(num_chunks, [&](int chunk) {
+            int begin = chunk * DC_CHUNK_ROWS, end = std::min(n, begin + DC_CHUNK_ROWS);
+            for (int i = begin; i < end; i++) {
+                p[i] = z[i] + beta * p[i];
+            }
+        });
+    }
+    return false;
+}
+
+static bool solve_direct(const CsrMatrix& a, const std::vector<double>& b, std::vector<double>& x) {
+    EnvelopeFactor factor;
+    if (!factor_envelope(a, factor)) {
+        return false;
+    }
+    x.resize(a.rows);
+    solve_envelope(factor, b.data(), x.data());
+    return true;
+}
+
+static bool solve_system(const CsrMatrix& a, const std::vector<double>& b, std::vector<double>& x,
+                         const DcOptions& options, DcSolveInfo& info) {
+    info.unknowns = a.rows;
+    info.direct = false;
+    info.iterations = 0;
+    info.residual = 0;
+    if (a.rows == 0) {
+        x.clear();
+        return true;
+    }
+    bool try_direct = options.method == DC_DIRECT || (options.method == DC_AUTO && a.rows <= DC_DIRECT_MAX_UNKNOWNS);
+    if (try_direct && solve_direct(a, b, x)) {
+        info.direct = true;
+        return true;
+    }
+    if (options.method == DC_DIRECT) {
+        return false;
+    }
+
+    int num_threads = options.num_threads > 0 ? options.num_threads
+                                              : static_cast<int>(std::thread::hardware_concurrency());
+    ChunkPool pool(std::max(1, std::min(num_threads, row_chunks(a.rows))));
+    if (solve_pcg(a, b, x, options, pool, info)) {
+        return true;
+    }
+    // PCG stalled: fall back to the factorisation if it fits and hasn't failed already
+    if (options.method == DC_AUTO && !try_direct && solve_direct(a, b, x)) {
+        info.direct = true;
+        return true;
+    }
+    return false;
+}
+
+// Everything the solve needs about one node: unknown >= 0 gives V = x[unknown] + base,
+// FIXED_NODE gives V = base, FLOATING_NODE has no path to the reference
+const int FIXED_NODE = -1;
+const int FLOATING_NODE = -2;
+
+struct NodalSystem {
+    std::vector<int> unknown;
+    std::vector<double> base;
+    CsrMatrix matrix;
+    std::vector<double> rhs;
+};
+
+// Collapses voltage sources (zeroed when with_sources is false), numbers the unknowns
+// relative to the reference node and assembles the conductance matrix.
+// Returns the node where a voltage source loop closes, or -1.
+static int build_system(const DcCircuit& circuit, int reference, bool with_sources, NodalSystem& system) {
+    int n = circuit.num_nodes;
+    PotentialSets sets(n);
+    for (const DcVoltageSource& source : circuit.voltage_sources) {
+        // A loop of zeroed sources is only redundant shorts
+        if (!sets.join(source.plus, source.minus, with_sources ? source.voltage : 0) && with_sources) {
+            return source.plus;
+        }
+    }
+    std::vector<int> root(n);
+    for (int i = 0; i < n; i++) {
+        root[i] = sets.find(i);
+    }
+    int reference_root = root[reference];
+    double reference_offset = sets.offset[reference];
+
+    // Resistors join supernodes into components; only the reference's component is solvable
+    std::vector<int> component(n);
+    for (int i = 0; i < n; i++) {
+        component[i] = i;
+    }
+    for (const DcResistor& resistor : circuit.resistors) {
+        int x = find_set(component, root[resistor.a]), y = find_set(component, root[resistor.b]);
+        if (x != y) {
+            component[x] = y;
+        }
+    }
+    int reference_component = find_set(component, reference_root);
+
+    // One unknown per supernode, numbered in node order for locality
+    std::vector<int> root_unknown(n, -1);
+    system.unknown.assign(n, FLOATING_NODE);
+    system.base.assign(n, 0);
+    int unknowns = 0;
+    for (int i = 0; i < n; i++) {
+        int r = root[i];
+        if (r == reference_root) {
+            system.unknown[i] = FIXED_NODE;
+            system.base[i] = sets.offset[i] - reference_offset;
+        }
+        else if (find_set(component, r) == reference_component) {
+            if (root_unknown[r] < 0) {
+                root_unknown[r] = unknowns++;
+            }
+            system.unknown[i] = root_unknown[r];
+            system.base[i] = sets.offset[i];
+        }
+    }
+
+    // Row sizes first, then entries; duplicates from parallel resistors are merged per row
+    CsrMatrix& a = system.matrix;
+    a.rows = unknowns;
+    a.diagonal.assign(unknowns, 0);
+    system.rhs.assign(unknowns, 0);
+    std::vector<int> fill(unknowns + 1, 1);
+    for (const DcResistor& resistor : circuit.resistors) {
+        int u = system.unknown[resistor.a], v = system.unknown[resistor.b];
+        if (u >= 0 && v >= 0 && u != v) {
+            fill[u]++;
+            fill[v]++;
+        }
+    }
+    a.row_start.assign(unknowns + 1, 0);
+    for (int i = 0; i < unknowns; i++) {
+        a.row_start[i + 1] = a.row_start[i] + fill[i];
+        fill[i] = a.row_start[i] + 1; // slot 0 of each row is the diagonal
+    }
+    a.columns.resize(a.row_start[unknowns]);
+    a.values.assign(a.row_start[unknowns], 0);
+    for (const DcResistor& resistor : circuit.resistors) {
+        int u = system.unknown[resistor.a], v = system.unknown[resistor.b];
+        if (u == v) {
+            continue; // inside one supernode, or both ends fixed or floating
+        }
+        double g = 1 / resistor.resistance;
+        double drop = system.base[resistor.b] - system.base[resistor.a];
+        if (u >= 0) {
+            a.diagonal[u] += g;
+            system.rhs[u] += g * drop;
+        }
+        if (v >= 0) {
+            a.diagonal[v] += g;
+            system.rhs[v] -= g * drop;
+        }
+        if (u >= 0 && v >= 0) {
+            a.columns[fill[u]] = v;
+            a.values[fill[u]++] = -g;
+            a.columns[fill[v]] = u;
+            a.values[fill[v]++] = -g;
+        }
+    }
+
+    int write = 0;
+    for (int i = 0; i < unknowns; i++) {
+        int begin = a.row_start[i], end = a.row_start[i + 1];
+        a.row_start[i] = write;
+        // Rows are short (a few neighbours), so insertion sort then merge equal columns
+        for (int k = begin + 2; k < end; k++) {
+            int column = a.columns[k];
+            double value = a.values[k];
+            int m = k;
+            for (; m > begin + 1 && a.columns[m - 1] > column; m--) {
+                a.columns[m] = a.columns[m - 1];
+                a.values[m] = a.values[m - 1];
+            }
+            a.columns[m] = column;
+            a.values[m] = value;
+        }
+        a.columns[write] = i;
+        a.values[write++] = a.diagonal[i];
+        for (int k = begin + 1; k < end; k++) {
+            if (write > a.row_start[i] + 1 && a.columns[write - 1] == a.columns[k]) {
+                a.values[write - 1] += a.values[k];
+            }
+            else {
+                a.columns[write] = a.columns[k];
+                a.values[write++] = a.values[k];
+            }
+        }
+    }
+    a.row_start[unknowns] = write;
+    a.columns.resize(write);
+    a.values.resize(write);
+    return -1;
+}
+
+static std::string node_label(const DcCircuit& circuit, int node) {
+    return node < static_cast<int>(circuit.node_names.size()) ? circuit.node_names[node] : std::to_string(node);
+}
+
+static bool check_circuit(const DcCircuit& circuit, std::string& error) {
+    auto valid = [&circuit](int node) { return node >= 0 && node < circuit.num_nodes; };
+    for (const DcResistor& resistor : circuit.resistors) {
+        if (!valid(resistor.a) || !valid(resistor.b) || !(resistor.resistance > 0)) {
+            error = "resistor " + resistor.name + " needs two nodes and a positive resistance";
+            return false;
+        }
+    }
+    for (const DcCurrentSource& source : circuit.current_sources) {
+        if (!valid(source.plus) || !valid(source.minus)) {
+            error = "current source " + source.name + " has an invalid node";
+            return false;
+        }
+    }
+    for (const DcVoltageSource& source : circuit.voltage_sources) {
+        if (!valid(source.plus) || !valid(source.minus)) {
+            error = "voltage source " + source.name + " has an invalid node";
+            return false;
+        }
+    }
+    return true;
+}
+
+DcSolution solve_dc(const DcCircuit& circuit, const DcOptions& options) {
+    DcSolution solution;
+    solution.solved = false;
+    solution.info = DcSolveInfo();
+    if (!check_circuit(circuit, solution.error)) {
+        return solution;
+    }
+
+    NodalSystem system;
+    int loop = build_system(circuit, 0, true, system);
+    if (loop >= 0) {
+        solution.error = "voltage sources form a loop at node " + node_label(circuit, loop);
+        return solution;
+    }
+    int n = circuit.num_nodes;
+    for (int i = 0; i < n; i++) {
+        if (system.unknown[i] == FLOATING_NODE) {
+            solution.error = "node " + node_label(circuit, i) + " has no DC path to ground";
+            return solution;
+        }
+    }
+    for (const DcCurrentSource& source : circuit.current_sources) {
+        if (system.unknown[source.minus] >= 0) system.rhs[system.unknown[source.minus]] += source.current;
+        if (system.unknown[source.plus] >= 0) system.rhs[system.unknown[source.plus]] -= source.current;
+    }
+
+    std::vector<double> x;
+    if (!solve_system(system.matrix, system.rhs, x, options, solution.info)) {
+        solution.error = options.method == DC_DIRECT
+            ? "matrix too large for the direct solver"
+            : "solver did not converge in " + std::to_string(solution.info.iterations) + " iterations";
+        return solution;
+    }
+
+    solution.node_voltages.resize(n);
+    for (int i = 0; i < n; i++) {
+        int u = system.unknown[i];
+        solution.node_voltages[i] = (u >= 0 ? x[u] : 0) + system.base[i];
+    }
+    const std::vector<double>& v = solution.node_voltages;
+
+    // Net current leaving each node through resistors and current sources
+    std::vector<double> leaving(n, 0);
+    solution.resistor_currents.resize(circuit.resistors.size());
+    for (size_t i = 0; i < circuit.resistors.size(); i++) {
+        const DcResistor& resistor = circuit.resistors[i];
+        double current = (v[resistor.a] - v[resistor.b]) / resistor.resistance;
+        solution.resistor_currents[i] = current;
+        leaving[resistor.a] += current;
+        leaving[resistor.b] -= current;
+    }
+    for (const DcCurrentSource& source : circuit.current_sources) {
+        leaving[source.plus] += source.current;
+        leaving[source.minus] -= source.current;
+    }
+
+    // Voltage sources form a forest; peel it from the leaves, where KCL leaves a single
+    // unknown source current
+    int num_sources = static_cast<int>(circuit.voltage_sources.size());
+    solution.voltage_source_currents.assign(num_sources, 0);
+    std::vector<int> degree(n, 0), incident_start(n + 1, 0), incident(2 * num_sources);
+    for (const DcVoltageSource& source : circuit.voltage_sources) {
+        incident_start[source.plus + 1]++;
+        incident_start[source.minus + 1]++;
+    }
+    for (int i = 0; i < n; i++) {
+        degree[i] = incident_start[i + 1];
+        incident_start[i + 1] += incident_start[i];
+    }
+    std::vector<int> slot(incident_start.begin(), incident_start.end() - 1);
+    for (int s = 0; s < num_sources; s++) {
+        incident[slot[circuit.voltage_sources[s].plus]++] = s;
+        incident[slot[circuit.voltage_sources[s].minus]++] = s;
+    }
+    std::vector<char> resolved(num_sources, 0);
+    std::vector<int> leaves;
+    for (int i = 0; i < n; i++) {
+        if (degree[i] == 1) {
+            leaves.push_back(i);
+        }
+    }
+    while (!leaves.empty()) {
+        int node = leaves.back();
+        leaves.pop_back();
+        if (degree[node] != 1) {
+            continue;
+        }
+        int s = -1;
+        for (int k = incident_start[node]; k < incident_start[node + 1]; k++) {
+            if (!resolved[incident[k]]) {
+                s = incident[k];
+            }
+        }
+        const DcVoltageSource& source = circuit.voltage_sources[s];
+        // The source carries `current` into plus and out of minus
+        double current = node == source.plus ? -leaving[node] : leaving[node];
+        int other = node == source.plus ? source.minus : source.plus;
+        leaving[other] += other == source.plus ? current : -current;
+        solution.voltage_source_currents[s] = current;
+        resolved[s] = 1;
+        degree[node]--;
+        if (--degree[other] == 1) {
+            leaves.push_back(other);
+        }
+    }
+    solution.solved = true;
+    return solution;
+}
+
+double dc_equivalent_resistance(const DcCircuit& circuit, int a, int b, const DcOptions& options, DcSolveInfo* info) {
+    std::string error;
+    if (!check_circuit(circuit, error) || a < 0 || a >= circuit.num_nodes || b < 0 || b >= circuit.num_nodes) {
+        return -1;
+    }
+    NodalSystem system;
+    build_system(circuit, b, false, system);
+    DcSolveInfo solve_info = DcSolveInfo();
+    double resistance;
+    if (system.unknown[a] == FLOATING_NODE) {
+        resistance = HUGE_VAL;
+    }
+    else if (system.unknown[a] == FIXED_NODE) {
+        resistance = 0; // shorted to b
+    }
+    else {
+        // 1 A into a and out of b leaves V(a) = R
+        system.rhs[system.unknown[a]] += 1;
+        std::vector<double> x;
+        resistance = solve_system(system.matrix, system.rhs, x, options, solve_info) ? x[system.unknown[a]] : -1;
+    }
+    if (info != nullptr) {
+        *info = solve_info;
+    }
+    return resistance;
+}
+
+int dc_node(const DcCircuit& circuit, const std::string& name) {
+    if (name == "0" || name == "gnd" || name == "GND") {
+        return 0;
+    }
+    auto it = circuit.node_index.find(name);
+    return it == circuit.node_index.end() ? -1 : it->second;
+}
+
+// Function to look up a node by name, adding it if new
+static int add_node(DcCircuit& circuit, const std::string& name) {
+    int node = dc_node(circuit, name);
+    if (node >= 0) {
+        return node;
+    }
+    node = circuit.num_nodes++;
+    circuit.node_index[name] = node;
+    circuit.node_names.push_back(name);
+    return node;
+}
+
+bool parse_dc_netlist(std::istream& in, DcCircuit& circuit, std::string& error) {
+    circuit = DcCircuit();
+    circuit.node_names.push_back("0");
+    std::string line;
+    int line_number = 0;
+    while (std::getline(in, line)) {
+        line_number++;
+        std::istringstream tokens(line);
+        std::string name, plus, minus, value_text, extra;
+        if (!(tokens >> name) || name[0] == '*' || name[0] == '#' || name == ".end") {
+            continue;
+        }
+        double value;
+        if (!(tokens >> plus >> minus >> value_text) || (tokens >> extra) || !parse_value(value_text, value)) {
+            error = "line " + std::to_string(line_number) + ": expected <name> <node> <node> <value>";
+            return false;
+        }
+        int a = add_node(circuit, plus), b = add_node(circuit, minus);
+        switch (name[0]) {
+        case 'R': case 'r':
+            if (!(value > 0)) {
+                error = "line " + std::to_string(line_number) + ": resistance must be positive";
+                return false;
+            }
+            circuit.resistors.push_back({ a, b, value, name });
+            break;
+        case 'I': case 'i':
+            circuit.current_sources.push_back({ a, b, value, name });
+            break;
+        case 'V': case 'v':
+            circuit.voltage_sources.push_back({ a, b, value, name });
+            break;
+        default:
+            error = "line " + std::to_string(line_number) + ": unknown element " + name;
+            return false;
+        }
+    }
+    return true;
+}
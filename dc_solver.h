@@ -0,0 +1,96 @@
+#ifndef DC_SOLVER_H
+#define DC_SOLVER_H
+
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// DC nodal analysis of resistor networks with current and voltage sources, for bridges,
+// meshes and grids that series/parallel reduction can't handle.
+// Voltage sources are eliminated before assembly: nodes joined by sources collapse into
+// one unknown plus fixed offsets, and nodes tied to ground become known voltages. What is
+// left is a symmetric positive definite conductance matrix, stored as CSR and solved with
+// conjugate gradients preconditioned by aggregation multigrid (multithreaded, chunked so
+// results don't depend on the thread count) or, for small or stubborn systems, an
+// envelope Cholesky factorisation in reverse Cuthill-McKee order.
+
+struct DcResistor {
+    int a;
+    int b;
+    double resistance; // ohms, > 0
+    std::string name;
+};
+
+// SPICE direction: the current flows from node plus through the source to node minus
+struct DcCurrentSource {
+    int plus;
+    int minus;
+    double current;
+    std::string name;
+};
+
+// V(plus) - V(minus) = voltage
+struct DcVoltageSource {
+    int plus;
+    int minus;
+    double voltage;
+    std::string name;
+};
+
+struct DcCircuit {
+    int num_nodes = 1; // node 0 is ground
+    std::vector<DcResistor> resistors;
+    std::vector<DcCurrentSource> current_sources;
+    std::vector<DcVoltageSource> voltage_sources;
+    // Filled by parse_dc_netlist, empty for circuits built in code
+    std::vector<std::string> node_names;
+    std::unordered_map<std::string, int> node_index;
+};
+
+enum DcMethod {
+    DC_AUTO = 0,  // direct below DC_DIRECT_MAX_UNKNOWNS, else PCG with the direct solver as fallback
+    DC_PCG = 1,
+    DC_DIRECT = 2
+};
+
+const int DC_DIRECT_MAX_UNKNOWNS = 10000;
+const long long DC_DIRECT_MAX_ENTRIES = 1LL << 25; // envelope size limit of the direct solver
+
+struct DcOptions {
+    DcMethod method = DC_AUTO;
+    double tolerance = 1e-10; // PCG stops at |residual| <= tolerance * |rhs|
+    int max_iterations = 0;   // 0 allows 10 * sqrt(unknowns) + 1000
+    int num_threads = 0;      // 0 uses every core
+};
+
+struct DcSolveInfo {
+    int unknowns;
+    bool direct;      // solved by the Cholesky factorisation
+    int iterations;   // PCG iterations, including any that didn't converge before a fallback
+    double residual;  // final relative residual of PCG, 0 for the direct solver
+};
+
+struct DcSolution {
+    bool solved;
+    std::string error;
+    std::vector<double> node_voltages;           // by node, ground is 0
+    std::vector<double> resistor_currents;       // a -> b
+    std::vector<double> voltage_source_currents; // into plus, through the source, out of minus
+    DcSolveInfo info;
+};
+
+DcSolution solve_dc(const DcCircuit& circuit, const DcOptions& options = DcOptions());
+
+// Resistance seen between nodes a and b with every source zeroed (voltage sources short,
+// current sources open); HUGE_VAL if they aren't connected, -1 for an invalid circuit
+double dc_equivalent_resistance(const DcCircuit& circuit, int a, int b, const DcOptions& options = DcOptions(),
+                                DcSolveInfo* info = nullptr);
+
+// SPICE-style netlist, one element per line: "R1 in out 4k7", "I1 n+ n- 1m", "V1 n+ n- 5".
+// Node "0" (or "gnd") is ground, other node names are free text; "*" starts a comment.
+bool parse_dc_netlist(std::istream& in, DcCircuit& circuit, std::string& error);
+// Node index from its name, -1 if the netlist has no such node
+int dc_node(const DcCircuit& circuit, const std::string& name);
+
+#endif
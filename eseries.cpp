@@ -0,0 +1,173 @@
+#include <cmath>
+#include <string>
+#include "eseries.h"
+
+// IEC 60063 mantissas, scaled to three digits
+static const int e6_mantissas[] = { 100, 150, 220, 330, 470, 680 };
+static const int e12_mantissas[] = { 100, 120, 150, 180, 220, 270, 330, 390, 470, 560, 680, 820 };
+static const int e24_mantissas[] = {
+    100, 110, 120, 130, 150, 160, 180, 200, 220, 240, 270, 300,
+    330, 360, 390, 430, 470, 510, 560, 620, 680, 750, 820, 910
+};
+static const int e48_mantissas[] = {
+    100, 105, 110, 115, 121, 127, 133, 140, 147, 154, 162, 169, 178, 187, 196, 205,
+    215, 226, 237, 249, 261, 274, 287, 301, 316, 332, 348, 365, 383, 402, 422, 442,
+    464, 487, 511, 536, 562, 590, 619, 649, 681, 715, 750, 787, 825, 866, 909, 953
+};
+static const int e96_mantissas[] = {
+    100, 102, 105, 107, 110, 113, 115, 118, 121, 124, 127, 130, 133, 137, 140, 143,
+    147, 150, 154, 158, 162, 165, 169, 174, 178, 182, 187, 191, 196, 200, 205, 210,
+    215, 221, 226, 232, 237, 243, 249, 255, 261, 267, 274, 280, 287, 294, 301, 309,
+    316, 324, 332, 340, 348, 357, 365, 374, 383, 392, 402, 412, 422, 432, 442, 453,
+    464, 475, 487, 499, 511, 523, 536, 549, 562, 576, 590, 604, 619, 634, 649, 665,
+    681, 698, 715, 732, 750, 768, 787, 806, 825, 845, 866, 887, 909, 931, 953, 976
+};
+static const int e192_mantissas[] = {
+    100, 101, 102, 104, 105, 106, 107, 109, 110, 111, 113, 114, 115, 117, 118, 120,
+    121, 123, 124, 126, 127, 129, 130, 132, 133, 135, 137, 138, 140, 142, 143, 145,
+    147, 149, 150, 152, 154, 156, 158, 160, 162, 164, 165, 167, 169, 172, 174, 176,
+    178, 180, 182, 184, 187, 189, 191, 193, 196, 198, 200, 203, 205, 208, 210, 213,
+    215, 218, 221, 223, 226, 229, 232, 234, 237, 240, 243, 246, 249, 252, 255, 258,
+    261, 264, 267, 271, 274, 277, 280, 284, 287, 291, 294, 298, 301, 305, 309, 312,
+    316, 320, 324, 328, 332, 336, 340, 344, 348, 352, 357, 361, 365, 370, 374, 379,
+    383, 388, 392, 397, 402, 407, 412, 417, 422, 427, 432, 437, 442, 448, 453, 459,
+    464, 470, 475, 481, 487, 493, 499, 505, 511, 517, 523, 530, 536, 542, 549, 556,
+    562, 569, 576, 583, 590, 597, 604, 612, 619, 626, 634, 642, 649, 657, 665, 673,
+    681, 690, 698, 706, 715, 723, 732, 741, 750, 759, 768, 777, 787, 796, 806, 816,
+    825, 835, 845, 856, 866, 876, 887, 898, 909, 920, 931, 942, 953, 965, 976, 988
+};
+
+// Expanded value tables for every series, built once on first use
+struct ESeriesTables {
+    double e6[6 * ESERIES_DECADES];
+    double e12[12 * ESERIES_DECADES];
+    double e24[24 * ESERIES_DECADES];
+    double e48[48 * ESERIES_DECADES];
+    double e96[96 * ESERIES_DECADES];
+    double e192[192 * ESERIES_DECADES];
+
+    ESeriesTables() {
+        expand(e6_mantissas, 6, e6);
+        expand(e12_mantissas, 12, e12);
+        expand(e24_mantissas, 24, e24);
+        expand(e48_mantissas, 48, e48);
+        expand(e96_mantissas, 96, e96);
+        expand(e192_mantissas, 192, e192);
+    }
+
+    // Mantissa and power of ten are both exact, so each value is the closest double to the decimal
+    static void expand(const int* mantissas, int n, double* values) {
+        for (int d = 0; d < ESERIES_DECADES; d++) {
+            int exponent = ESERIES_MIN_DECADE + d - 2;
+            double scale = 1;
+            for (int i = 0; i < std::abs(exponent); i++) {
+                scale *= 10;
+            }
+            for (int i = 0; i < n; i++) {
+                values[d * n + i] = (exponent >= 0) ? mantissas[i] * scale : mantissas[i] / scale;
+            }
+        }
+    }
+};
+
+static const ESeriesTables& tables() {
+    static const ESeriesTables instance;
+    return instance;
+}
+
+bool parse_eseries(const std::string& name, ESeries& series) {
+    if (name.size() < 2 || (name[0] != 'E' && name[0] != 'e')) {
+        return false;
+    }
+    std::string number = name.substr(1);
+    if (number == "6") series = E6;
+    else if (number == "12") series = E12;
+    else if (number == "24") series = E24;
+    else if (number == "48") series = E48;
+    else if (number == "96") series = E96;
+    else if (number == "192") series = E192;
+    else return false;
+    return true;
+}
+
+const int* eseries_mantissas(ESeries series) {
+    switch (series) {
+    case E6: return e6_mantissas;
+    case E12: return e12_mantissas;
+    case E24: return e24_mantissas;
+    case E48: return e48_mantissas;
+    case E96: return e96_mantissas;
+    default: return e192_mantissas;
+    }
+}
+
+const double* eseries_values(ESeries series, int& count) {
+    const ESeriesTables& t = tables();
+    count = static_cast<int>(series) * ESERIES_DECADES;
+    switch (series) {
+    case E6: return t.e6;
+    case E12: return t.e12;
+    case E24: return t.e24;
+    case E48: return t.e48;
+    case E96: return t.e96;
+    default: return t.e192;
+    }
+}
+
+double eseries_value(ESeries series, int index) {
+    int count;
+    return eseries_values(series, count)[index];
+}
+
+void eseries_decimal(ESeries series, int index, int& mantissa, int& exponent) {
+    int n = static_cast<int>(series);
+    mantissa = eseries_mantissas(series)[index % n];
+    exponent = ESERIES_MIN_DECADE + index / n - 2;
+}
+
+// Function to find the nearest preferred value and the values either side of it.
+// The slot is computed straight from log10 of the value; E24 and below are not
+// exactly geometric, so the guess is corrected by at most a step or two.
+PreferredValue nearest_preferred_value(double value, ESeries series) {
+    int count;
+    const double* values = eseries_values(series, count);
+    int n = static_cast<int>(series);
+
+    PreferredValue result;
+    if (!(value > values[0])) {
+        result.nearest = result.next_down = result.next_up = values[0];
+        result.index = 0;
+        return result;
+    }
+    if (value >= values[count - 1]) {
+        result.nearest = result.next_down = result.next_up = values[count - 1];
+        result.index = count - 1;
+        return result;
+    }
+
+    double log_value = std::log10(value);
+    double decade = std::floor(log_value);
+    int i = static_cast<int>((decade - ESERIES_MIN_DECADE) * n + (log_value - decade) * n);
+    if (i < 0) i = 0;
+    if (i > count - 2) i = count - 2;
+    while (i > 0 && values[i] > value) {
+        i--;
+    }
+    while (i < count - 2 && values[i + 1] <= value) {
+        i++;
+    }
+
+    // values[i] <= value < values[i + 1]
+    result.next_down = values[i];
+    result.next_up = (values[i] == value) ? value : values[i + 1];
+    // Nearer on a log scale: compare value against the geometric mean of the neighbours
+    if (value * value < result.next_down * values[i + 1]) {
+        result.nearest = result.next_down;
+        result.index = i;
+    }
+    else {
+        result.nearest = values[i + 1];
+        result.index = i + 1;
+    }
+    return result;
+}
@@ -0,0 +1,48 @@
+#ifndef ESERIES_H
+#define ESERIES_H
+
+#include <string>
+
+// Preferred value (E-series) index.
+// Each series is stored once as 3-digit mantissas (100..988) and expanded into a
+// static, ascending table covering every decade from 1 milliohm to 9.88 gigaohm.
+// Lookups work in the log domain and never allocate.
+
+enum ESeries {
+    E6 = 6,
+    E12 = 12,
+    E24 = 24,
+    E48 = 48,
+    E96 = 96,
+    E192 = 192
+};
+
+// Decades covered by the index (10^-3 to 10^9)
+const int ESERIES_MIN_DECADE = -3;
+const int ESERIES_MAX_DECADE = 9;
+const int ESERIES_DECADES = ESERIES_MAX_DECADE - ESERIES_MIN_DECADE + 1;
+
+struct PreferredValue {
+    double nearest;   // closest preferred value on a log scale
+    double next_down; // largest preferred value <= target
+    double next_up;   // smallest preferred value >= target
+    int index;        // position of nearest in eseries_values()
+};
+
+// Function to read a series name such as "E24" or "e96"
+bool parse_eseries(const std::string& name, ESeries& series);
+
+// Mantissas of one decade (series entries, 100..988)
+const int* eseries_mantissas(ESeries series);
+
+// Every preferred value of the series over all decades, ascending
+const double* eseries_values(ESeries series, int& count);
+
+// Preferred value from a table index (index must be in range)
+double eseries_value(ESeries series, int index);
+// Same entry as an exact decimal, mantissa (100..988) x 10^exponent
+void eseries_decimal(ESeries series, int index, int& mantissa, int& exponent);
+
+PreferredValue nearest_preferred_value(double value, ESeries series);
+
+#endif
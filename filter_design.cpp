@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "filter_design.h"
+#include "npv_search.h"
+#include "poles.h"
+
+// One ranked choice of parts for a single stage
+struct StageCandidate {
+    double r;
+    double c;
+    double ra;
+    double rb;
+    double freq;
+    double q;
+    double error;
+};
+
+// Function to score a stage: squared log error of f0 plus squared log error of Q
+static double stage_error(double freq, double q, double target_freq, double target_q) {
+    double freq_error = std::log(freq / target_freq);
+    if (target_q == 0) {
+        return freq_error * freq_error; // first-order section, no Q to match
+    }
+    double q_error = std::log(q / target_q);
+    return freq_error * freq_error + q_error * q_error;
+}
+
+// Function to build the ranked candidates of one stage from the RC and ratio searches
+static std::vector<StageCandidate> stage_candidates(const CascadeOptions& options, double target_freq,
+                                                    double target_gain, double target_q) {
+    const int max_pairs = 32;
+    RcPair rc[max_pairs];
+    ResistorRatio ratios[max_pairs];
+    int num_rc = best_rc_pairs(target_freq, options.r_series, options.c_series, options.min_r, options.max_r,
+                               options.min_c, options.max_c, max_pairs, rc);
+
+    std::vector<StageCandidate> candidates;
+    if (target_q == 0) {
+        for (int i = 0; i < num_rc; i++) {
+            candidates.push_back({ rc[i].r, rc[i].c, 0, 0, rc[i].cutoff_freq, 0,
+                                   stage_error(rc[i].cutoff_freq, 0, target_freq, 0) });
+        }
+        return candidates; // already ranked by best_rc_pairs
+    }
+    int num_ratios = best_ratio_pairs(target_gain - 1, options.r_series, options.min_r, options.max_r,
+                                      max_pairs, ratios);
+    for (int i = 0; i < num_rc; i++) {
+        for (int j = 0; j < num_ratios; j++) {
+            double gain = 1 + ratios[j].ratio;
+            if (gain >= 3) {
+                continue; // the equal-component stage is unstable at K >= 3
+            }
+            double q = 1 / (3 - gain);
+            candidates.push_back({ rc[i].r, rc[i].c, ratios[j].numerator, ratios[j].denominator,
+                                   rc[i].cutoff_freq, q, stage_error(rc[i].cutoff_freq, q, target_freq, target_q) });
+        }
+    }
+    // Stable, so equal errors keep the order they were generated in and ties resolve the same way every run
+    std::stable_sort(candidates.begin(), candidates.end(),
+        [](const StageCandidate& a, const StageCandidate& b) { return a.error < b.error; });
+    return candidates;
+}
+
+// Function to cut every stage down to its best candidates. With a line limit the best
+// candidates of different stages rarely share values, so each stage also keeps as many
+// lower-ranked candidates again whose values all appear among the best of the stages
+static void keep_best_candidates(std::vector<std::vector<StageCandidate>>& candidates, const CascadeOptions& options) {
+    size_t keep = static_cast<size_t>(std::max(1, options.candidates_per_stage));
+    std::vector<double> shared; // values of every stage's best candidates, sorted
+    for (const std::vector<StageCandidate>& stage : candidates) {
+        for (size_t i = 0; i < stage.size() && i < keep; i++) {
+            shared.insert(shared.end(), { stage[i].r, stage[i].c, stage[i].ra, stage[i].rb });
+        }
+    }
+    std::sort(shared.begin(), shared.end());
+    auto is_shared = [&shared](double value) {
+        return std::binary_search(shared.begin(), shared.end(), value);
+    };
+
+    for (std::vector<StageCandidate>& stage : candidates) {
+        if (options.max_distinct_values <= 0) {
+            stage.resize(std::min(stage.size(), keep));
+            continue;
+        }
+        std::vector<StageCandidate> kept;
+        size_t extra = 0;
+        for (size_t i = 0; i < stage.size(); i++) {
+            const StageCandidate& candidate = stage[i];
+            if (i < keep) {
+                kept.push_back(candidate);
+            } else if (extra < keep && is_shared(candidate.r) && is_shared(candidate.c) &&
+                       is_shared(candidate.ra) && is_shared(candidate.rb)) {
+                kept.push_back(candidate); // still in error order
+                extra++;
+            }
+        }
+        stage.swap(kept);
+    }
+}
+
+// Small fixed-size set of part values used so far along a search path
+struct PartSet {
+    double resistors[4 * MAX_POLE_PAIRS];
+    double capacitors[MAX_POLE_PAIRS];
+    int num_resistors = 0;
+    int num_capacitors = 0;
+
+    int size() const {
+        return num_resistors + num_capacitors;
+    }
+
+    void add_resistor(double value) {
+        for (int i = 0; i < num_resistors; i++) {
+            if (resistors[i] == value) return;
+        }
+        resistors[num_resistors++] = value;
+    }
+
+    void add_capacitor(double value) {
+        for (int i = 0; i < num_capacitors; i++) {
+            if (capacitors[i] == value) return;
+        }
+        capacitors[num_capacitors++] = value;
+    }
+
+    void add(const StageCandidate& candidate) {
+        add_resistor(candidate.r);
+        if (candidate.rb > 0) {
+            add_resistor(candidate.ra);
+            add_resistor(candidate.rb);
+        }
+        add_capacitor(candidate.c);
+    }
+};
+
+// Shared state of one optimisation: candidates, bounds and the best cascade so far
+struct CascadeSearch {
+    std::vector<std::vector<StageCandidate>> candidates;
+    std::vector<double> remaining_bound; // smallest possible error of stages i..end
+    int max_distinct_values;
+    long long max_nodes;                 // 0 for no limit
+    std::atomic<long long> nodes;        // candidates tried, counted in blocks of 1024
+    std::atomic<bool> stopped;           // max_nodes ran out
+
+    std::mutex best_lock;
+    std::atomic<double> best_error; // read without the lock for pruning
+    int best_choice[MAX_POLE_PAIRS];
+    int best_distinct;
+
+    // Function to tell whether a branch whose error is at least bound can still match the
+    // best; the slack keeps ties whose sums round differently
+    bool can_match(double bound) const {
+        return bound <= best_error.load(std::memory_order_relaxed) * (1 + 1e-12);
+    }
+
+    // Equal errors go to fewer lines, then to the lower candidate indexes, so the answer
+    // doesn't depend on which thread gets there first
+    bool better(double error, int distinct, const int* choice, int num_stages) const {
+        if (error != best_error.load()) {
+            return error < best_error.load();
+        }
+        if (distinct != best_distinct) {
+            return distinct < best_distinct;
+        }
+        return std::lexicographical_compare(choice, choice + num_stages, best_choice, best_choice + num_stages);
+    }
+
+    // Function to count a candidate tried, false once the search is out of nodes
+    bool visit(long long& local_nodes) {
+        if (stopped.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        if ((++local_nodes & 1023) == 0 && max_nodes > 0 && (nodes += 1024) > max_nodes) {
+            stopped = true;
+            return false;
+        }
+        return true;
+    }
+
+    // Depth-first branch-and-bound; error so far plus the best case of the rest must reach the best
+    void search(int stage, double error, const PartSet& parts, int* choice, long long& local_nodes) {
+        int num_stages = static_cast<int>(candidates.size());
+        if (stage == num_stages) {
+            std::lock_guard<std::mutex> guard(best_lock);
+            if (better(error, parts.size(), choice, num_stages)) {
+                best_error = error;
+                best_distinct = parts.size();
+                std::copy(choice, choice + num_stages, best_choice);
+            }
+            return;
+        }
+        for (size_t i = 0; i < candidates[stage].size(); i++) {
+            const StageCandidate& candidate = candidates[stage][i];
+            double bound = error + candidate.error + remaining_bound[stage + 1];
+            if (!can_match(bound)) {
+                break; // candidates are sorted, so the rest are no better
+            }
+            if (!visit(local_nodes)) {
+                return;
+            }
+            PartSet next = parts;
+            next.add(candidate);
+            if (max_distinct_values > 0 && next.size() > max_distinct_values) {
+                continue;
+            }
+            choice[stage] = static_cast<int>(i);
+            search(stage + 1, error + candidate.error, next, choice, local_nodes);
+        }
+    }
+};
+
+// Function to run the branch-and-bound over the search's candidates on num_threads threads,
+// trying at most max_nodes candidates (0 for no limit)
+static void run_cascade_search(CascadeSearch& search, int num_threads, long long max_nodes) {
+    search.max_nodes = max_nodes;
+    search.nodes = 0;
+    search.stopped = false;
+    search.remaining_bound.assign(search.candidates.size() + 1, 0);
+    for (int i = static_cast<int>(search.candidates.size()) - 1; i >= 0; i--) {
+        search.remaining_bound[i] = search.remaining_bound[i + 1] + search.candidates[i][0].error;
+    }
+
+    // First-stage candidates are handed out to the workers one at a time
+    std::atomic<int> next_candidate(0);
+    auto work = [&search, &next_candidate]() {
+        int first_count = static_cast<int>(search.candidates[0].size());
+        int choice[MAX_POLE_PAIRS];
+        long long local_nodes = 0;
+        for (int i = next_candidate++; i < first_count; i = next_candidate++) {
+            const StageCandidate& candidate = search.candidates[0][i];
+            if (!search.can_match(candidate.error + search.remaining_bound[1])) {
+                continue;
+            }
+            PartSet parts;
+            parts.add(candidate);
+            if (search.max_distinct_values > 0 && parts.size() > search.max_distinct_values) {
+                continue;
+            }
+            choice[0] = i;
+            search.search(1, candidate.error, parts, choice, local_nodes);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; i++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+CascadeDesign optimise_sallen_key_cascade(const CascadeOptions& options) {
+    CascadeDesign design;
+    design.num_stages = 0;
+    design.total_error = 0;
+    design.distinct_values = 0;
+
+    PolePairData pairs[MAX_POLE_PAIRS];
+    int num_stages = filter_sections(options.num_poles, options.ripple_db, pairs);
+    if (num_stages == 0 || options.cutoff_freq <= 0) {
+        return design;
+    }
+
+    CascadeSearch search;
+    search.max_distinct_values = options.max_distinct_values;
+    search.best_error = HUGE_VAL;
+    search.best_distinct = 0;
+    double target_freq[MAX_POLE_PAIRS], target_q[MAX_POLE_PAIRS];
+    for (int i = 0; i < num_stages; i++) {
+        // Stage f0 is the cutoff scaled by the table's frequency factor
+        target_freq[i] = options.cutoff_freq * (options.high_pass ? pairs[i].factor_high : pairs[i].factor_low);
+        target_q[i] = pairs[i].q;
+        search.candidates.push_back(stage_candidates(options, target_freq[i], pairs[i].gain, target_q[i]));
+        if (search.candidates.back().empty()) {
+            return design;
+        }
+    }
+    int num_threads = options.num_threads > 0 ? options.num_threads
+                                              : static_cast<int>(std::thread::hardware_concurrency());
+    num_threads = std::max(1, num_threads);
+    std::vector<std::vector<StageCandidate>> all_candidates;
+    if (options.max_distinct_values > 0) {
+        all_candidates = search.candidates;
+    }
+    keep_best_candidates(search.candidates, options);
+    run_cascade_search(search, num_threads, 0);
+    if (search.best_error == HUGE_VAL && options.max_distinct_values > 0) {
+        // The kept candidates can't meet the line limit; only the full lists can tell
+        // whether anything does, and that search can take minutes, so it has a node budget
+        search.candidates.swap(all_candidates);
+        run_cascade_search(search, num_threads, options.max_fallback_nodes);
+        if (search.stopped) {
+            return design; // out of budget: whatever was found so far may not be the best
+        }
+    }
+
+    if (search.best_error == HUGE_VAL) {
+        return design; // the distinct value limit can't be met
+    }
+    design.num_stages = num_stages;
+    design.total_error = search.best_error;
+    design.distinct_values = search.best_distinct;
+    for (int i = 0; i < num_stages; i++) {
+        const StageCandidate& chosen = search.candidates[i][search.best_choice[i]];
+        design.stages[i] = { chosen.r, chosen.c, chosen.ra, chosen.rb,
+                             target_freq[i], chosen.freq, target_q[i], chosen.q };
+    }
+    return design;
+}
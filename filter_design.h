@@ -0,0 +1,51 @@
+#ifndef FILTER_DESIGN_H
+#define FILTER_DESIGN_H
+
+#include "calc.h"
+#include "eseries.h"
+
+// Whole-cascade Sallen-Key design. Every stage uses the equal-component circuit of the
+// Sallen-Key menu (R1 = R2 = R, C1 = C2 = C, gain K = 1 + RA/RB), so a stage has
+// f0 = 1 / (2 pi R C) and Q = 1 / (3 - K). The optimiser picks preferred R, C, RA and RB
+// for all stages together, minimising the summed squared log error of every stage's f0
+// and Q, optionally with a limit on the number of distinct part values (BOM lines).
+// Odd orders add a first-order RC section driving a follower, which has no RA/RB (0).
+
+struct CascadeOptions {
+    double ripple_db = 0; // 0 for Butterworth, else the Chebyshev passband ripple
+    int num_poles = 2;
+    double cutoff_freq = 1e3;
+    bool high_pass = false;
+    ESeries r_series = E24;
+    ESeries c_series = E12;
+    double min_r = 1e3;
+    double max_r = 1e6;
+    double min_c = 100e-12;
+    double max_c = 10e-6;
+    int max_distinct_values = 0;   // 0 means no limit
+    int candidates_per_stage = 64; // best part sets kept for each stage; a line limit keeps more
+    long long max_fallback_nodes = 100000000; // tries before a line-limited search gives up with no design
+    int num_threads = 0;           // 0 uses every core
+};
+
+struct CascadeStage {
+    double r;
+    double c;
+    double ra;
+    double rb;
+    double target_freq;
+    double achieved_freq;
+    double target_q;   // 0 for a first-order section
+    double achieved_q;
+};
+
+struct CascadeDesign {
+    int num_stages; // 0 if no design was found
+    CascadeStage stages[MAX_POLE_PAIRS];
+    double total_error;
+    int distinct_values;
+};
+
+CascadeDesign optimise_sallen_key_cascade(const CascadeOptions& options);
+
+#endif
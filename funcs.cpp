@@ -1,434 +1,508 @@
+#include <charconv>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <limits>
+#include <fstream>
 #include <map>
 #include <vector>
 #include <cmath>
 #include "funcs.h"
+#include "ac_solver.h"
+#include "calc.h"
+#include "color_code.h"
+#include "dc_solver.h"
+#include "eseries.h"
+#include "network.h"
+#include "npv_search.h"
+#include "synth.h"
+#include "filter_design.h"
+#include "poles.h"
+#include "response.h"
+#include "si_value.h"
 #include <algorithm> // For std::transform
 
 
-void press_to_continue() {
-    std::cout << "\nPress Enter to continue...\n";
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    std::cin.get();
+void press_to_continue(Session& session) {
+    session.out << "\nPress Enter to continue...\n";
+    session.in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    session.in.get();
 }
 
-// Function that clears the screen
-void clearscreen() {
+// Function that clears the session's screen with the escape codes clear(1) prints
+void clearscreen(Session& session) {
+    if (!session.clear_screen) {
+        return;
+    }
 #ifdef _WIN32
-    system("cls");  // For Windows
-#elif __APPLE__
-    system("clear");  // For MacOS
-#else
-    system("clear");  // For Linux 
+    if (&session.out == &std::cout) {
+        system("cls");  // the Windows console
+        return;
+    }
 #endif
+    session.out << "\x1B[H\x1B[2J" << std::flush;
 }
 
+static void print_main_menu(Session& session) {
+    session.out << "\n------------------- Enginuity -------------------\n";
+    session.out << "|\t\t\t\t\t\t|\n";
+    session.out << "|\t1. Resistor Calculator           \t|\n";
+    session.out << "|\t2. Op Amp Configurator           \t|\n";
+    session.out << "|\t3. RC Filter Calculator          \t|\n";
+    session.out << "|\t4. Sallen Key Filter Configurator\t|\n";
+    session.out << "|\t5. Exit\t\t\t\t\t|\n";
+    session.out << "|\t\t\t\t\t\t|\n";
+    session.out << "-------------------------------------------------\n";
+}
 
-// Function that only allows a positive input
-bool validate_positive_input(double& value, const std::string& prompt) {
-    std::cout << prompt;
-    std::cin >> value;
-    if (std::cin.fail() || value <= 0) { // checks if input is less than negative
-        std::cin.clear(); // Clear error flag
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Discard invalid input
-        std::cerr << "Error: Value must be a positive number.\n";
-        return false;
+void run_session(Session& session) {
+    while (session.running) {
+        print_main_menu(session);
+        session.out << "\nSelect item: ";
+        switch (read_menu_choice(session, 5)) {
+        case 1:
+            menu_item_1(session);
+            break;
+        case 2:
+            menu_item_2(session);
+            break;
+        case 3:
+            menu_item_3(session);
+            break;
+        case 4:
+            menu_item_4(session);
+            break;
+        default:
+            session.out << "Bye!\n";
+            session.running = false;
+            continue;
+        }
+        go_back_to_main(session);
     }
-    return true;
+    session.out.flush();
+}
+
+
+// Function that reads a menu choice from 1 to num_items, asking again until it gets one;
+// the last item (back or exit) if input runs out
+int read_menu_choice(Session& session, int num_items) {
+    // A number typed where text was expected earlier leaves only the fail bit set
+    if (!session.in.eof()) {
+        session.in.clear();
+    }
+    std::string token;
+    while (session.in >> token) {
+        int choice = 0;
+        const char* first = token.data() + (token[0] == '+' ? 1 : 0);
+        std::from_chars_result result = std::from_chars(first, token.data() + token.size(), choice);
+        if (result.ec == std::errc() && result.ptr == token.data() + token.size() && choice >= 1 && choice <= num_items) {
+            return choice;
+        }
+        session.out << "Invalid input. Please enter a number between 1 and " << num_items << ": ";
+    }
+    return num_items;
 }
 
-// Function to calculate cutoff frequency
-double calculate_cutoff_frequency(double r, double c, double factor = 1.0) {
-    return 1 / (r * c * 2 * 3.14 * factor);
+// Function that only allows a positive input; SI prefixes such as 4k7 or 100n are accepted
+bool validate_positive_input(Session& session, double& value, const std::string& prompt) {
+    return validate_positive_value(session, value, SI_ANY_UNIT, prompt);
 }
 
 // Function to display cutoff frequency with units
-void display_cutoff_frequency(float cutoff_freq) {
+void display_cutoff_frequency(Session& session, float cutoff_freq) {
     if (cutoff_freq > 1e6) {
-        std::cout << "\nThe cutoff frequency is " << cutoff_freq / 1e6 << " MHz\n";
+        session.out << "\nThe cutoff frequency is " << cutoff_freq / 1e6 << " MHz\n";
     }
     else if (cutoff_freq > 1e3) {
-        std::cout << "\nThe cutoff frequency is " << cutoff_freq / 1e3 << " kHz\n";
+        session.out << "\nThe cutoff frequency is " << cutoff_freq / 1e3 << " kHz\n";
     }
     else {
-        std::cout << "\nThe cutoff frequency is " << cutoff_freq << " Hz\n";
+        session.out << "\nThe cutoff frequency is " << cutoff_freq << " Hz\n";
     }
 }
 
-// Function to convert resistance based on the unit
-void resistor_input(double raw_resist, double& resistance, std::string& unit) {
-    bool valid = false;
-    while (!valid) {
-        if (unit == "k" || unit == "K") {
-            resistance = raw_resist * 1e3; // Kilo-ohms to ohms
-            valid = true;
-        }
-        else if (unit == "M" || unit == "m") {
-            resistance = raw_resist * 1e6; // Mega-ohms to ohms
-            valid = true;
-        }
-        else if (unit == "O" || unit == "o") {
-            resistance = raw_resist; // Ohms
-            valid = true;
-        }
-        else {
-            std::cerr << "Invalid unit. Please use 'k' for kilo-ohms, 'M' for mega-ohms, or 'O' for ohms.\n";
-            std::cout << "Enter a valid unit: ";
-            std::cin >> unit; // Re-prompt for the unit
-        }
+// Function that reads a positive value with an optional SI prefix and unit,
+// e.g. "4k7", "100nF" or "1.5 kHz"; a unit other than the expected one is rejected
+bool validate_positive_value(Session& session, double& value, SiUnit unit, const std::string& prompt) {
+    std::string line;
+    session.out << prompt;
+    session.in >> std::ws;
+    std::getline(session.in, line);
+    if (!parse_si_value(line.data(), line.data() + line.size(), value, unit) || !(value > 0)) {
+        session.err << "Error: Value must be a positive number" << (unit == SI_ANY_UNIT || unit == SI_NO_UNIT ? "" : " in ")
+                  << si_unit_name(unit) << ", e.g. 4k7, 2.2M, 100n or 1.5k.\n";
+        return false;
     }
+    return true;
 }
 
-// Function to convert frequency based on the unit
-void Fc_input(double raw_freq, double& frequency, std::string& unit) {
-    bool valid = false; // Validation flag
-    while (!valid) {
-        if (unit == "k" || unit == "K") {
-            frequency = raw_freq * 1e3; // Kilo Hz to Hz
-            valid = true;
-        }
-        else if (unit == "M" || unit == "m") {
-            frequency = raw_freq * 1e6; // Mega Hz to Hz
-            valid = true;
-        }
-        else if (unit == "H" || unit == "h") {
-            frequency = raw_freq; // Hertz
-            valid = true;
-        }
-        else {
-            std::cerr << "Invalid unit. Please use 'k' for Kilo Hz, 'M' for Mega Hz, or 'H' for Hertz.\n";
-            std::cout << "Enter a valid unit: ";
-            std::cin >> unit; // Re-prompt for unit
-        }
-    }
-}
-// Function to convert capacitance based on the unit
-void capacitor_input(double raw_cap, double& capacitance, std::string& unit) {
-    bool valid = false; // Validation flag
-    while (!valid) {
-        if (unit == "u") { // Microfarads to farads
-            capacitance = raw_cap * 1e-6;
-            valid = true;
-        }
-        else if (unit == "n") { // Nanofarads to farads
-            capacitance = raw_cap * 1e-9;
-            valid = true;
-        }
-        else if (unit == "p") { // Picofarads to farads
-            capacitance = raw_cap * 1e-12;
-            valid = true;
-        }
-        else {
-            std::cerr << "Invalid unit. Please use u (microfarads), n (nanofarads), or p (picofarads).\n";
-            std::cout << "Enter a valid unit: ";
-            std::cin >> unit; // Re-prompt for unit
-        }
-    }
-}
-// Function to return to main menu
-void go_back_to_main() {
+// Function to return to main menu; ends the session if the input has run out
+void go_back_to_main(Session& session) {
     std::string input;
     do {
-        std::cout << "\nEnter 'b' or 'B' to go back to main menu: ";
-        std::cin >> input;
-        clearscreen();
+        session.out << "\nEnter 'b' or 'B' to go back to main menu: ";
+        if (!session.in.eof()) {
+            session.in.clear();
+        }
+        if (!(session.in >> input)) {
+            session.running = false;
+            return;
+        }
+        clearscreen(session);
 
     } while (input != "b" && input != "B");
 }
 
 
 
-void menu_item_1() {
+void menu_item_1(Session& session) {
     int choice;
     do {
-        clearscreen();  // Clear the screen at the start of the menu
-        std::cout << "\n--- Resistor Calculator ---\n";
-        std::cout << "1. Calculate resistance from color codes\n";
-        std::cout << "2. Solve Resistor Network\n";
-        std::cout << "3. Find nearest NPV resistor\n";
-        std::cout << "4. Get NPV value and color code for a resistor\n";
-        std::cout << "5. Back to main menu\n";
-        std::cout << "Select an option: ";
-        std::cin >> choice;
-
-        // Block invalid input until correct
-        while (std::cin.fail()) {
-            std::cin.clear();
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            std::cout << "Invalid input. Please enter a number between 1 and 5: ";
-            std::cin >> choice;
-        }
+        clearscreen(session);  // Clear the screen at the start of the menu
+        session.out << "\n--- Resistor Calculator ---\n";
+        session.out << "1. Calculate resistance from color codes\n";
+        session.out << "2. Solve Resistor Network\n";
+        session.out << "3. Find nearest NPV resistor\n";
+        session.out << "4. Get NPV value and color code for a resistor\n";
+        session.out << "5. Design a resistor network for a target value\n";
+        session.out << "6. Back to main menu\n";
+        session.out << "Select an option: ";
+        choice = read_menu_choice(session, 6);
 
         switch (choice) {
             case 1:
-                clearscreen();
-                calculate_resistor_from_color_code();
+                clearscreen(session);
+                calculate_resistor_from_color_code(session);
                 break;
             case 2:
-                clearscreen();
-                combine_resistors();
+                clearscreen(session);
+                combine_resistors(session);
                 break;
             case 3:
-                clearscreen();
-                find_nearest_npv_resistor();
+                clearscreen(session);
+                find_nearest_npv_resistor(session);
                 break;
             case 4: {
-                clearscreen();
+                clearscreen(session);
                 double resistor_value;
-                std::cout << "Enter resistor value (in ohms): ";
-                std::cin >> resistor_value;
-                get_npv_and_color_code_for_resistor(resistor_value);
+                if (validate_positive_value(session, resistor_value, SI_OHM, "Enter resistor value (e.g. 10k, 4k7): ")) {
+                    get_npv_and_color_code_for_resistor(session, resistor_value);
+                }
                 break;
             }
             case 5:
-                clearscreen();
-                std::cout << "Returning to main menu...\n";
+                clearscreen(session);
+                design_resistor_network(session);
+                break;
+            case 6:
+                clearscreen(session);
+                session.out << "Returning to main menu...\n";
                 break;
             default:
-                std::cout << "Invalid option. Try again.\n";
+                session.out << "Invalid option. Try again.\n";
         }
 
-        if (choice != 5) {
-            std::cout << "\nPress Enter to continue...";
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            std::cin.get();
+        if (choice != 6) {
+            session.out << "\nPress Enter to continue...";
+            session.in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            session.in.get();
         }
-    } while (choice != 5);
+    } while (choice != 6);
 }
 
-void calculate_resistor_from_color_code() {
-    clearscreen();  // Clear screen at the beginning of the function
-
-    // Define color-to-value and multiplier maps
-    std::map<std::string, int> color_code = {
-        {"black", 0}, {"brown", 1}, {"red", 2}, {"orange", 3}, {"yellow", 4},
-        {"green", 5}, {"blue", 6}, {"violet", 7}, {"gray", 8}, {"white", 9}
-    };
-    std::map<std::string, double> multipliers = {
-        {"black", 1}, {"brown", 10}, {"red", 100}, {"orange", 1000}, {"yellow", 10000},
-        {"green", 100000}, {"blue", 1000000}, {"gold", 0.1}, {"silver", 0.01}
-    };
-
-    // Helper lambda to convert a string to lowercase
-    auto to_lower = [](std::string& str) {
-        std::transform(str.begin(), str.end(), str.begin(), ::tolower);
-    };
-
-    std::string band1, band2, multiplier;
-    
-    std::cout << "Enter first color band: ";
-    std::cin >> band1;
-    to_lower(band1); // Convert to lowercase
-    std::cout << "Enter second color band: ";
-    std::cin >> band2;
-    to_lower(band2); // Convert to lowercase
-    std::cout << "Enter multiplier band: ";
-    std::cin >> multiplier;
-    to_lower(multiplier); // Convert to lowercase
-
-    // Validate the color bands
-    if (color_code.find(band1) == color_code.end() ||
-        color_code.find(band2) == color_code.end() ||
-        multipliers.find(multiplier) == multipliers.end()) {
-        std::cout << "Invalid color code entered. Please try again.\n";
+void calculate_resistor_from_color_code(Session& session) {
+    clearscreen(session);  // Clear screen at the beginning of the function
+
+    int num_bands;
+    session.out << "Enter the number of bands (" << MIN_BANDS << " to " << MAX_BANDS << "): ";
+    session.in >> num_bands;
+    if (session.in.fail() || num_bands < MIN_BANDS || num_bands > MAX_BANDS) {
+        session.in.clear();
+        session.out << "Invalid number of bands.\n";
         return;
     }
 
+    // Band order: digits, multiplier, then tolerance and tempco on 4-6 band parts
+    int num_digits = num_bands >= 5 ? 3 : 2;
+    BandColor bands[MAX_BANDS];
+    for (int i = 0; i < num_bands; i++) {
+        std::string color;
+        if (i < num_digits) {
+            session.out << "Enter color band " << (i + 1) << " (digit): ";
+        }
+        else if (i == num_digits) {
+            session.out << "Enter multiplier band: ";
+        }
+        else if (i == num_digits + 1) {
+            session.out << "Enter tolerance band: ";
+        }
+        else {
+            session.out << "Enter temperature coefficient band: ";
+        }
+        session.in >> color;
+        bands[i] = parse_band_color(color); // any case
+    }
+
     // Calculate the resistance
-    int significant_digits = color_code[band1] * 10 + color_code[band2];
-    double resistance = significant_digits * multipliers[multiplier];
+    ResistorCode code;
+    if (!decode_color_bands(pack_color_bands(bands, num_bands), code)) {
+        session.out << "Invalid color code entered. Please try again.\n";
+        return;
+    }
     
-    clearscreen();  // Clear screen before displaying the result
+    clearscreen(session);  // Clear screen before displaying the result
 
-    std::cout << "Resistance: " << resistance << " ohms\n";
+    session.out << "Resistance: " << code.resistance << " ohms\n";
+    session.out << "Tolerance: +/-" << 100 * code.tolerance << "%\n";
+    if (code.tempco > 0) {
+        session.out << "Temperature coefficient: " << code.tempco << " ppm/K\n";
+    }
 }
 
 
-void combine_resistors() {
-    clearscreen();  // Clear the screen at the beginning of the function
+void combine_resistors(Session& session) {
+    clearscreen(session);  // Clear the screen at the beginning of the function
+
+    int mode;
+    session.out << "Enter 1 to combine a series group and a parallel group, 2 to enter a whole network,\n"
+              << "or 3 to solve a netlist file (bridges, meshes, sources): ";
+    session.in >> mode;
+    if (mode == 2) {
+        combine_network_expression(session);
+        return;
+    }
+    if (mode == 3) {
+        solve_netlist_file(session);
+        return;
+    }
 
     int num_series, num_parallel;
 
     // Input for series resistors
-    std::cout << "Enter the number of resistors in series: ";
-    std::cin >> num_series;
+    session.out << "Enter the number of resistors in series: ";
+    session.in >> num_series;
 
     std::vector<double> series_resistances(num_series);
-    double total_series_resistance = 0;
 
     for (int i = 0; i < num_series; i++) {
-        std::cout << "Enter value of series resistor " << i + 1 << " (in ohms): ";
-        std::cin >> series_resistances[i];
-        total_series_resistance += series_resistances[i]; // Sum up for series
+        if (!validate_positive_value(session, series_resistances[i], SI_OHM,
+                                     "Enter value of series resistor " + std::to_string(i + 1) + " (e.g. 10k, 4k7): ")) {
+            return;
+        }
     }
-    std::cout << "Total resistance of resistors in series: " << total_series_resistance << " ohms\n";
+    double total_series_resistance = series_resistance(series_resistances.data(), num_series);
+    session.out << "Total resistance of resistors in series: " << total_series_resistance << " ohms\n";
 
     // Input for parallel resistors
-    std::cout << "Enter the number of resistors in parallel: ";
-    std::cin >> num_parallel;
+    session.out << "Enter the number of resistors in parallel: ";
+    session.in >> num_parallel;
 
     std::vector<double> parallel_resistances(num_parallel);
-    double total_inverse_parallel = 0;
 
     for (int i = 0; i < num_parallel; i++) {
-        std::cout << "Enter value of parallel resistor " << i + 1 << " (in ohms): ";
-        std::cin >> parallel_resistances[i];
-        if (parallel_resistances[i] == 0) {
-            std::cout << "Error: Resistor value cannot be zero in parallel combination.\n";
+        if (!validate_positive_value(session, parallel_resistances[i], SI_OHM,
+                                     "Enter value of parallel resistor " + std::to_string(i + 1) + " (e.g. 10k, 4k7): ")) {
             return;
         }
-        total_inverse_parallel += 1 / parallel_resistances[i]; // Sum of inverses for parallel
     }
 
-    double total_parallel_resistance = 1 / total_inverse_parallel;
-    std::cout << "Total resistance of resistors in parallel: " << total_parallel_resistance << " ohms\n";
+    double total_parallel_resistance = parallel_resistance(parallel_resistances.data(), num_parallel);
+    session.out << "Total resistance of resistors in parallel: " << total_parallel_resistance << " ohms\n";
 
-    clearscreen();  // Clear screen before showing the final combination
+    clearscreen(session);  // Clear screen before showing the final combination
 
     // Combine the two results
     int combination_type;
-    std::cout << "Enter 1 to combine the series and parallel resistances in series, or 2 to combine them in parallel: ";
-    std::cin >> combination_type;
+    session.out << "Enter 1 to combine the series and parallel resistances in series, or 2 to combine them in parallel: ";
+    session.in >> combination_type;
 
     if (combination_type == 1) {
         // Combine in series
-        double combined_resistance = total_series_resistance + total_parallel_resistance;
-        std::cout << "Total combined resistance (series): " << combined_resistance << " ohms\n";
+        double combined_resistance = combine_series(total_series_resistance, total_parallel_resistance);
+        session.out << "Total combined resistance (series): " << combined_resistance << " ohms\n";
     }
     else if (combination_type == 2) {
         // Combine in parallel
-        double combined_inverse = (1 / total_series_resistance) + (1 / total_parallel_resistance);
-        double combined_resistance = 1 / combined_inverse;
-        std::cout << "Total combined resistance (parallel): " << combined_resistance << " ohms\n";
+        double combined_resistance = combine_parallel(total_series_resistance, total_parallel_resistance);
+        session.out << "Total combined resistance (parallel): " << combined_resistance << " ohms\n";
     }
     else {
-        std::cout << "Invalid combination type. Try again.\n";
+        session.out << "Invalid combination type. Try again.\n";
     }
 }
 
-void find_nearest_npv_resistor() {
-    clearscreen();  // Clear the screen at the beginning of the function
+// Evaluates a series/parallel expression or JSON tree of any size
+void combine_network_expression(Session& session) {
+    std::string text;
+    session.out << "Enter the network without spaces, e.g. (4k7+10k)||(22k+(1M||470k))\n"
+              << "or {\"series\":[\"4k7\",{\"parallel\":[\"10k\",\"22k\"]}]}: ";
+    session.in >> text;
+
+    ResistorNetwork network;
+    std::string error;
+    const std::map<std::string, double> no_names;
+    bool parsed = !text.empty() && text[0] == '{' ? parse_network_json(text, no_names, network, error)
+                                                  : parse_network_expression(text, no_names, network, error);
+    if (!parsed) {
+        session.out << "Error: " << error << "\n";
+        return;
+    }
+    session.out << "Total resistance of the " << network.parts << " resistor network: " << evaluate_network(network) << " ohms\n";
+}
 
-    std::vector<double> npv_resistors = {
-        1.0, 1.2, 1.5, 1.8, 2.2, 2.7, 3.3, 3.9, 4.7, 5.6, 6.8, 8.2,
-        10, 12, 15, 18, 22, 27, 33, 39, 47, 56, 68, 82,
-        100, 120, 150, 180, 220, 270, 330, 390, 470, 560, 680, 820,
-        1000, 1200, 1500, 1800, 2200, 2700, 3300, 3900, 4700, 5600, 6800, 8200,
-        10000, 12000, 15000, 18000, 22000, 27000, 33000, 39000, 47000, 56000, 68000, 82000,
-        100000, 120000, 150000, 180000, 220000, 270000, 330000, 390000, 470000, 560000, 680000, 820000,
-        1000000, 1200000, 1500000, 1800000, 2200000, 2700000, 3300000, 3900000, 4700000, 5600000, 6800000, 8200000,
-        10000000
-    };
+// DC analysis of a SPICE-style netlist: node voltages, source currents and the
+// resistance between two nodes
+void solve_netlist_file(Session& session) {
+    std::string path;
+    session.out << "Netlist lines look like \"R1 in out 4k7\", \"V1 in 0 5\" or \"I1 0 out 1m\" (node 0 is ground).\n";
+    session.out << "Enter netlist file: ";
+    session.in >> path;
+
+    std::ifstream file(path);
+    DcCircuit circuit;
+    std::string error;
+    if (!file) {
+        session.out << "Error: cannot open " << path << "\n";
+        return;
+    }
+    if (!parse_dc_netlist(file, circuit, error)) {
+        session.out << "Error: " << error << "\n";
+        return;
+    }
+    DcSolution solution = solve_dc(circuit);
+    if (!solution.solved) {
+        session.out << "Error: " << solution.error << "\n";
+        return;
+    }
 
-    double target_resistance;
-    std::cout << "Enter target resistance (in ohms): ";
-    std::cin >> target_resistance;
+    const int MAX_LISTED = 50;
+    session.out << circuit.num_nodes << " nodes solved (" << (solution.info.direct ? "direct" : "iterative") << ")\n";
+    for (int i = 1; i < circuit.num_nodes && i <= MAX_LISTED; i++) {
+        session.out << "V(" << circuit.node_names[i] << ") = " << solution.node_voltages[i] << " V\n";
+    }
+    for (size_t i = 0; i < circuit.voltage_sources.size() && static_cast<int>(i) < MAX_LISTED; i++) {
+        session.out << "I(" << circuit.voltage_sources[i].name << ") = " << solution.voltage_source_currents[i] << " A\n";
+    }
 
-    if (target_resistance <= 0) {
-        std::cout << "Invalid resistance value. Must be greater than zero.\n";
+    std::string from, to;
+    session.out << "Enter two nodes for the resistance between them: ";
+    session.in >> from >> to;
+    int a = dc_node(circuit, from), b = dc_node(circuit, to);
+    if (a < 0 || b < 0) {
+        session.out << "Error: unknown node.\n";
         return;
     }
+    double resistance = dc_equivalent_resistance(circuit, a, b);
+    if (resistance == HUGE_VAL) {
+        session.out << "The nodes are not connected.\n";
+    }
+    else {
+        session.out << "Resistance between " << from << " and " << to << ": " << resistance << " ohms\n";
+    }
+}
 
-    double closest_resistor = npv_resistors[0];
-    double min_difference = std::abs(target_resistance - closest_resistor);
+void find_nearest_npv_resistor(Session& session) {
+    clearscreen(session);  // Clear the screen at the beginning of the function
 
-    for (double resistor : npv_resistors) {
-        double difference = std::abs(target_resistance - resistor);
-        if (difference < min_difference) {
-            closest_resistor = resistor;
-            min_difference = difference;
-        }
+    double target_resistance;
+    if (!validate_positive_value(session, target_resistance, SI_OHM, "Enter target resistance (e.g. 10k, 4k7): ")) {
+        return;
+    }
+
+    std::string series_name;
+    ESeries series;
+    session.out << "Enter E-series (E6, E12, E24, E48, E96 or E192): ";
+    session.in >> series_name;
+    if (!parse_eseries(series_name, series)) {
+        session.out << "Unknown series, using E12.\n";
+        series = E12;
     }
 
-    std::cout << "Nearest NPV resistor: " << closest_resistor << " ohms\n";
+    PreferredValue npv = nearest_preferred_value(target_resistance, series);
+    double closest_resistor = npv.nearest;
+
+    session.out << "Nearest NPV resistor: " << closest_resistor << " ohms\n";
+    session.out << "Next value down: " << npv.next_down << " ohms, next value up: " << npv.next_up << " ohms\n";
 
     // Suggest combination if exact match is not found
     if (closest_resistor != target_resistance) {
-        clearscreen();  // Clear screen before suggesting combinations
-        std::cout << "Suggested combinations: \n";
-        for (double r1 : npv_resistors) {
-            for (double r2 : npv_resistors) {
-                if (std::abs((r1 + r2) - target_resistance) < min_difference) {
-                    std::cout << "Series: " << r1 << " ohms + " << r2 << " ohms\n";
-                }
-                if (std::abs((1 / ((1 / r1) + (1 / r2))) - target_resistance) < min_difference) {
-                    std::cout << "Parallel: " << r1 << " ohms || " << r2 << " ohms\n";
-                }
-            }
+        const int num_suggestions = 5;
+        ResistorPair series_pairs[num_suggestions], parallel_pairs[num_suggestions];
+        int num_series = best_series_pairs(target_resistance, series, num_suggestions, series_pairs);
+        int num_parallel = best_parallel_pairs(target_resistance, series, num_suggestions, parallel_pairs);
+
+        session.out << "\nSuggested combinations (error of single resistor: "
+                  << 100 * (closest_resistor - target_resistance) / target_resistance << "%):\n";
+        for (int i = 0; i < num_series; i++) {
+            session.out << "Series: " << series_pairs[i].r1 << " ohms + " << series_pairs[i].r2 << " ohms = "
+                      << series_pairs[i].value << " ohms (" << 100 * series_pairs[i].error << "%)\n";
+        }
+        for (int i = 0; i < num_parallel; i++) {
+            session.out << "Parallel: " << parallel_pairs[i].r1 << " ohms || " << parallel_pairs[i].r2 << " ohms = "
+                      << parallel_pairs[i].value << " ohms (" << 100 * parallel_pairs[i].error << "%)\n";
         }
     }
 }
 
-void get_npv_and_color_code_for_resistor(double resistance) {
-
-   
-    std::vector<double> npv_resistors = {
-        1.0, 1.2, 1.5, 1.8, 2.2, 2.7, 3.3, 3.9, 4.7, 5.6, 6.8, 8.2,
-        10, 12, 15, 18, 22, 27, 33, 39, 47, 56, 68, 82,
-        100, 120, 150, 180, 220, 270, 330, 390, 470, 560, 680, 820,
-        1000, 1200, 1500, 1800, 2200, 2700, 3300, 3900, 4700, 5600, 6800, 8200,
-        10000, 12000, 15000, 18000, 22000, 27000, 33000, 39000, 47000, 56000, 68000, 82000,
-        100000, 120000, 150000, 180000, 220000, 270000, 330000, 390000, 470000, 560000, 680000, 820000,
-        1000000, 1200000, 1500000, 1800000, 2200000, 2700000, 3300000, 3900000, 4700000, 5600000, 6800000, 8200000,
-        10000000 // E12 series
-    };
-
-    // Maps for color code
-    std::map<int, std::string> digit_to_color = {
-        {0, "black"}, {1, "brown"}, {2, "red"}, {3, "orange"}, {4, "yellow"},
-        {5, "green"}, {6, "blue"}, {7, "violet"}, {8, "gray"}, {9, "white"}
-    };
-    std::map<int, std::string> multiplier_to_color = {
-        {0, "black"}, {1, "brown"}, {2, "red"}, {3, "orange"}, {4, "yellow"},
-        {5, "green"}, {6, "blue"}, {7, "violet"}, {8, "gray"}, {9, "white"},
-        {-1, "gold"}, {-2, "silver"}
-    };
+// Searches series/parallel networks of up to 5 preferred values for a target
+void design_resistor_network(Session& session) {
+    SynthesisOptions options;
+    double target_resistance;
+    std::string series_name;
 
-    // Find the closest NPV resistor
-    double closest_resistor = npv_resistors[0];
-    double min_difference = std::abs(resistance - closest_resistor);
-
-    for (double resistor : npv_resistors) {
-        double difference = std::abs(resistance - resistor);
-        if (difference < min_difference) {
-            closest_resistor = resistor;
-            min_difference = difference;
-        }
+    if (!validate_positive_value(session, target_resistance, SI_OHM, "Enter target resistance (e.g. 10k, 4k7): ")) {
+        return;
     }
-
-    std::cout << "Nearest NPV resistor: " << closest_resistor << " ohms\n";
-
-    // Calculate color code
-    int magnitude = static_cast<int>(std::log10(closest_resistor));
-    double normalized_value = closest_resistor / std::pow(10, magnitude);
-    // Adjust for edge cases where normalized value is exactly 10
-    if (normalized_value >= 10.0) {
-        normalized_value /= 10;
-        ++magnitude;
+    session.out << "Enter E-series (E6, E12, E24, E48, E96 or E192): ";
+    session.in >> series_name;
+    if (!parse_eseries(series_name, options.series)) {
+        session.out << "Unknown series, using E24.\n";
     }
+    session.out << "Enter maximum number of parts (1 to " << SYNTH_MAX_PARTS << "): ";
+    session.in >> options.max_parts;
+    session.out << "Enter tolerance (%): ";
+    session.in >> options.tolerance;
+    if (session.in.fail()) {
+        session.in.clear();
+        session.out << "Invalid input.\n";
+        return;
+    }
+    options.tolerance /= 100;
 
-    int first_digit = static_cast<int>(normalized_value);
-    int second_digit = static_cast<int>((normalized_value - first_digit) * 10);
+    SynthesisResult result = synthesize_network(target_resistance, options);
+    if (result.solutions.empty()) {
+        session.out << "No network found in the E-series range.\n";
+        return;
+    }
+    if (result.timed_out) {
+        session.out << "Search time limit reached, showing the best networks found.\n";
+    }
+    if (!result.met_tolerance) {
+        session.out << "No network within " << 100 * options.tolerance << "% - closest networks:\n";
+    }
+    for (const NetworkSolution& solution : result.solutions) {
+        session.out << solution.parts << " parts: " << solution.expression << " = " << solution.value
+                  << " ohms (" << 100 * solution.error << "%)\n";
+    }
+}
 
-  
+void get_npv_and_color_code_for_resistor(Session& session, double resistance) {
+    // Find the closest NPV resistor
+    NpvResult npv = npv_and_color_code(resistance);
 
-    if (digit_to_color.find(first_digit) != digit_to_color.end() &&
-        digit_to_color.find(second_digit) != digit_to_color.end() &&
-        multiplier_to_color.find(magnitude) != multiplier_to_color.end()) {
-        std::string first_band = digit_to_color[first_digit];
-        std::string second_band = digit_to_color[second_digit];
-        std::string multiplier_band = multiplier_to_color[magnitude];
+    session.out << "Nearest NPV resistor: " << npv.value << " ohms\n";
 
+    if (npv.has_color_code) {
         // Outputs the color code of the input resistor
-        std::cout << "Color Code: [" << first_band << ", " << second_band << ", " << multiplier_band << "]\n";
+        session.out << "Color Code: [" << digit_color_name(npv.bands.first_digit) << ", "
+                  << digit_color_name(npv.bands.second_digit) << ", "
+                  << multiplier_color_name(npv.bands.multiplier) << "]\n";
     }
     else {
-        std::cout << "Error: Unable to calculate color code for this resistor.\n";
+        session.out << "Error: Unable to calculate color code for this resistor.\n";
     }
 }
-void menu_item_2() {
+void menu_item_2(Session& session) {
     int choice;
     double inverting_input_voltage;
     double non_inverting_input_voltage;
@@ -438,36 +512,26 @@ void menu_item_2() {
     double gain;
     std::string repeat_choice, unit;
     do {
-        clearscreen();
-        std::cout << "\n>> The Op-Amp \n";
+        clearscreen(session);
+        session.out << "\n>> The Op-Amp \n";
 
         // Display a sub-menu for selecting the op-amp configuration
-        std::cout << "\nOp-Amp Configuration:\n";
-        std::cout << "1. Inverting Op-Amp\n";
-        std::cout << "2. Non-Inverting Op-Amp\n";
-        std::cout << "3. Back to main menu\n";
-        std::cout << "Select choice: ";
-        std::cin >> choice;
-
-        // Blocks invalid input until correct
-        while (std::cin.fail()) {
-            if (std::cin.fail()) {
-                std::cin.clear();
-                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                std::cout << "Invalid input. Please enter a number between 1 and 3.\n";
-                std::cout << "Enter an integer!\n";
-                std::cin >> choice;
-            }
-        }
+        session.out << "\nOp-Amp Configuration:\n";
+        session.out << "1. Inverting Op-Amp\n";
+        session.out << "2. Non-Inverting Op-Amp\n";
+        session.out << "3. Choose resistors for a target gain\n";
+        session.out << "4. Simulate a circuit netlist (AC sweep)\n";
+        session.out << "5. Back to main menu\n";
+        session.out << "Select choice: ";
+        choice = read_menu_choice(session, 5);
 
-        double raw_resist;
         std::string unit;
 
         // Perform calculations based on the user's choice
         if (choice == 1) {
             // Inverting Op-Amp
-            std::cout << "\n>> Inverting Op-Amp Configuration\n";
-            std::cout << R"(
+            session.out << "\n>> Inverting Op-Amp Configuration\n";
+            session.out << R"(
                          *----| FR |----*
                          |              |
                          |     |\       |
@@ -480,41 +544,25 @@ void menu_item_2() {
                         --- 
             )" << std::endl;
             // Validate each input
-            std::cout << "Enter the inverting input voltage (volts): ";
-            while (!(std::cin >> inverting_input_voltage)) {
-                std::cin.clear(); // Clear the error flag
-                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Discard invalid input
-                std::cout << "Invalid input. Please enter a numeric value for the inverting input voltage: ";
-            }
-
-            // Get resistance input
-            std::cout << "Enter unit for R (k for kilo-ohms, M for mega-ohms, O for ohms): ";
-            std::cin >> unit;
-            if (!validate_positive_input(raw_resist, "Enter the feedback resistor value (ohms): ")) {
-                std::cout << "Please enter a positive integer: ";
-                std::cin >> raw_resist;
-            }
-            resistor_input(raw_resist, feedback_resistor, unit);
-            if (feedback_resistor <= 0) {
-                std::cerr << "Invalid resistance input.\n";
-                return;
+            session.out << "Enter the inverting input voltage (volts): ";
+            while (!(session.in >> inverting_input_voltage)) {
+                if (session.in.eof()) {
+                    return;
+                }
+                session.in.clear(); // Clear the error flag
+                session.in.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Discard invalid input
+                session.out << "Invalid input. Please enter a numeric value for the inverting input voltage: ";
             }
 
             // Get resistance input
-            std::cout << "Enter unit for R (k for kilo-ohms, M for mega-ohms, O for ohms): ";
-            std::cin >> unit;
-            if (!validate_positive_input(input_resistor, "Enter the input resistor value (ohms): ")) {
-                std::cout << "Please enter a positive integer: ";
-                std::cin >> raw_resist;
-            }
-            resistor_input(raw_resist, input_resistor, unit);
-            if (input_resistor <= 0) {
-                std::cerr << "Invalid resistance input.\n";
+            if (!validate_positive_value(session, feedback_resistor, SI_OHM, "Enter the feedback resistor (e.g. 10k, 4k7): ") ||
+                !validate_positive_value(session, input_resistor, SI_OHM, "Enter the input resistor: ")) {
                 return;
             }
 
-            gain = -feedback_resistor / input_resistor;
-            float output_voltage = gain * inverting_input_voltage;
+            OpAmpResult result = inverting_amplifier(inverting_input_voltage, feedback_resistor, input_resistor);
+            gain = result.gain;
+            float output_voltage = result.output_voltage;
 
             // Use the absolute value of the output voltage for unit handling
             double abs_output_voltage = fabs(output_voltage);
@@ -536,13 +584,13 @@ void menu_item_2() {
             double final_output_voltage = (output_voltage < 0) ? -abs_output_voltage : abs_output_voltage;
 
             // Display results
-            std::cout << "\nThe gain of the inverting op-amp is: " << gain << "\n";
-            std::cout << "The output voltage is: " << final_output_voltage << " " << unit << "\n";
+            session.out << "\nThe gain of the inverting op-amp is: " << gain << "\n";
+            session.out << "The output voltage is: " << final_output_voltage << " " << unit << "\n";
         }
         else if (choice == 2) {
             // Non-Inverting Op-Amp
-            std::cout << "\n>> Non-Inverting Op-Amp Configuration\n";
-            std::cout << R"(
+            session.out << "\n>> Non-Inverting Op-Amp Configuration\n";
+            session.out << R"(
       
                                |\       
             Vin--| IR |--*-----|+\      
@@ -563,37 +611,18 @@ void menu_item_2() {
                                        --- 
             )" << std::endl;
             // Validate each input
-            if (!validate_positive_input(non_inverting_input_voltage, "Enter the non-inverting input voltage (volts): "))
+            if (!validate_positive_input(session, non_inverting_input_voltage, "Enter the non-inverting input voltage (volts): "))
                 return;
             // Get resistance input
-            std::cout << "Enter unit for R (k for kilo-ohms, M for mega-ohms, O for ohms): ";
-            std::cin >> unit;
-            if (!validate_positive_input(raw_resist, "Enter the feedback resistor value (ohms): ")) {
-                std::cout << "Please enter a positive integer: ";
-                std::cin >> raw_resist;
-            }
-            resistor_input(raw_resist, feedback_resistor, unit);
-            if (feedback_resistor <= 0) {
-                std::cerr << "Invalid resistance input.\n";
-                return;
-            }
-
-            // Get resistance input
-            std::cout << "Enter unit for R (k for kilo-ohms, M for mega-ohms, O for ohms): ";
-            std::cin >> unit;
-            if (!validate_positive_input(ground_resistor, "Enter the ground resistor value (ohms): ")) {
-                std::cout << "Please enter a positive integer: ";
-                std::cin >> raw_resist;
-            }
-            resistor_input(raw_resist, ground_resistor, unit);
-            if (ground_resistor <= 0) {
-                std::cerr << "Invalid resistance input.\n";
+            if (!validate_positive_value(session, feedback_resistor, SI_OHM, "Enter the feedback resistor (e.g. 10k, 4k7): ") ||
+                !validate_positive_value(session, ground_resistor, SI_OHM, "Enter the ground resistor: ")) {
                 return;
             }
 
 
-            gain = 1 + (feedback_resistor / ground_resistor);
-            float output_voltage = gain * non_inverting_input_voltage;
+            OpAmpResult result = non_inverting_amplifier(non_inverting_input_voltage, feedback_resistor, ground_resistor);
+            gain = result.gain;
+            float output_voltage = result.output_voltage;
             if (output_voltage <= 1e6 && output_voltage > 1e3) {
                 output_voltage *= 1e-3;
                 unit = "kV";
@@ -605,53 +634,142 @@ void menu_item_2() {
             else if (output_voltage <= 1e3 && output_voltage > 1) {
                 unit = "V";
             }
-            std::cout << "\nThe gain of the non-inverting op-amp is: " << gain << "\n";
+            session.out << "\nThe gain of the non-inverting op-amp is: " << gain << "\n";
 
-            std::cout << "The output voltage is: " << output_voltage << " " << unit << "\n";
+            session.out << "The output voltage is: " << output_voltage << " " << unit << "\n";
 
         }
         else if (choice == 3) {
+            choose_gain_resistors(session);
+        }
+        else if (choice == 4) {
+            simulate_ac_netlist(session);
+        }
+        else if (choice == 5) {
             return; // Exit this function
         }
         // Ask if the user wants to repeat or exit this menu item
-        std::cout << "\nWould you like to perform another calculation in this menu? (y/n): ";
-        std::cin >> repeat_choice;
-    } while (repeat_choice == "y" || repeat_choice == "Y");
+        session.out << "\nWould you like to perform another calculation in this menu? (y/n): ";
+        session.in >> repeat_choice;
+    } while ((repeat_choice == "y" || repeat_choice == "Y") && session.in);
 }
 
-void calculate_res_filter() {
-    clearscreen();
-    float  resistance_needed;
-    double raw_cap, raw_freq, frequency = 0, capacitance = 0;
-    std::string unit;
-    std::cout << "--- Resistor Calculator ---\n";
-    std::cout << "Enter unit for the capacitance (u for microfarads, n for nanofarads, p for picofarads): ";
-    std::cin >> unit;
+// Suggests preferred Rf/Rin (or Rf/Rg) pairs for a target op-amp gain
+void choose_gain_resistors(Session& session) {
+    std::string configuration, series_name;
+    double gain, min_resistance, max_resistance;
+    ESeries series;
 
-    // Get resistance input
-    if (!validate_positive_input(raw_cap, "Enter the capacitor value: "))
+    session.out << "\nInverting or non-inverting? (i/n): ";
+    session.in >> configuration;
+    if (configuration != "i" && configuration != "n") {
+        session.out << "Invalid configuration.\n";
         return;
+    }
+    if (!validate_positive_value(session, gain, SI_NO_UNIT, "Enter the target gain magnitude: ")) {
+        return;
+    }
+    if (configuration == "n" && gain <= 1) {
+        session.out << "Invalid gain (non-inverting gain must be above 1).\n";
+        return;
+    }
+    session.out << "Enter E-series (E6, E12, E24, E48, E96 or E192): ";
+    session.in >> series_name;
+    if (!parse_eseries(series_name, series)) {
+        session.out << "Unknown series, using E12.\n";
+        series = E12;
+    }
+    if (!validate_positive_input(session, min_resistance, "Enter the smallest resistor allowed (ohms): ") ||
+        !validate_positive_input(session, max_resistance, "Enter the largest resistor allowed (ohms): ")) {
+        return;
+    }
 
-    capacitor_input(raw_cap, capacitance, unit);
-    if (capacitance == 0) {
-        std::cerr << "Invalid input.\n";
+    // Non-inverting gain is 1 + Rf/Rg
+    double ratio = (configuration == "i") ? gain : gain - 1;
+    const int num_suggestions = 5;
+    ResistorRatio pairs[num_suggestions];
+    int found = best_ratio_pairs(ratio, series, min_resistance, max_resistance, num_suggestions, pairs);
+    if (found == 0) {
+        session.out << "No resistor pair in that range can reach this gain.\n";
         return;
     }
+    session.out << "\nBest resistor pairs:\n";
+    for (int i = 0; i < found; i++) {
+        double achieved = (configuration == "i") ? pairs[i].ratio : 1 + pairs[i].ratio;
+        session.out << "Rf = " << pairs[i].numerator << " ohms, " << (configuration == "i" ? "Rin" : "Rg")
+                  << " = " << pairs[i].denominator << " ohms, gain = " << achieved
+                  << " (" << 100 * (achieved - gain) / gain << "%)\n";
+    }
+}
 
-    std::cout << "Enter unit for the cutoff frequency(k for Kilo Hz, M for Mega Hz, H for Hz): ";
-    std::cin >> unit;
+// Small-signal frequency response of a SPICE-style netlist at one node, five points a decade
+void simulate_ac_netlist(Session& session) {
+    std::string path, node_name;
+    double start, stop;
+    session.out << "Netlist lines look like \"R1 in out 10k\", \"C1 out 0 10n\", \"V1 in 0 AC 1\" or\n"
+              << "\"O1 out in+ in- 100k 1M\" (op-amp with open-loop gain and gain-bandwidth; node 0 is ground).\n";
+    session.out << "Enter netlist file: ";
+    session.in >> path;
+
+    std::ifstream file(path);
+    AcCircuit circuit;
+    std::string error;
+    if (!file) {
+        session.out << "Error: cannot open " << path << "\n";
+        return;
+    }
+    if (!parse_ac_netlist(file, circuit, error)) {
+        session.out << "Error: " << error << "\n";
+        return;
+    }
+    session.out << "Enter the output node: ";
+    session.in >> node_name;
+    int node = ac_node(circuit, node_name);
+    if (node < 0) {
+        session.out << "Error: unknown node.\n";
+        return;
+    }
+    if (!validate_positive_input(session, start, "Enter the start frequency (Hz): ") ||
+        !validate_positive_input(session, stop, "Enter the stop frequency (Hz): ")) {
+        return;
+    }
+    if (stop <= start) {
+        session.out << "The stop frequency must be above the start frequency.\n";
+        return;
+    }
 
-    // Get resistance input
-    if (!validate_positive_input(raw_freq, "Enter the frequency value: "))
+    AcSystem system;
+    if (!build_ac_system(circuit, std::sqrt(start * stop), system, error)) {
+        session.out << "Error: " << error << "\n";
+        return;
+    }
+    int num_points = std::max(2, static_cast<int>(5 * std::log10(stop / start)) + 1);
+    std::vector<double> freq(num_points);
+    std::vector<std::complex<double>> voltage(num_points);
+    log_frequencies(start, stop, num_points, freq.data());
+    if (ac_sweep(system, freq.data(), num_points, &node, 1, voltage.data()) < 0) {
+        session.out << "Error: the circuit is singular at some frequencies.\n";
         return;
+    }
+    session.out << "\nFrequency (Hz)    V(" << node_name << ") dB    Phase (deg)\n";
+    for (int i = 0; i < num_points; i++) {
+        session.out << freq[i] << "    " << 20 * std::log10(std::abs(voltage[i])) << "    "
+                  << std::arg(voltage[i]) * 180 / PI << "\n";
+    }
+}
 
-    Fc_input(raw_freq, frequency, unit);
-    if (frequency == 0) {
-        std::cerr << "Invalid input.\n";
+void calculate_res_filter(Session& session) {
+    clearscreen(session);
+    float  resistance_needed;
+    double frequency = 0, capacitance = 0;
+    std::string unit;
+    session.out << "--- Resistor Calculator ---\n";
+    if (!validate_positive_value(session, capacitance, SI_FARAD, "Enter the capacitor value (e.g. 100n, 4.7uF): ") ||
+        !validate_positive_value(session, frequency, SI_HERTZ, "Enter the cutoff frequency (e.g. 1k, 2.5kHz): ")) {
         return;
     }
 
-    resistance_needed = 1 / (2 * 3.14 * capacitance * frequency);
+    resistance_needed = required_resistance(capacitance, frequency);
     if (resistance_needed > 1e3) {
         resistance_needed = resistance_needed / 1e3;
         unit = "kOhms";
@@ -664,43 +782,22 @@ void calculate_res_filter() {
         resistance_needed;
         unit = "Ohms";
     }
-    std::cout << "Required resistance = " << resistance_needed << " " << unit << "\n";
+    session.out << "Required resistance = " << resistance_needed << " " << unit << "\n";
 
 }
 
-void calculate_cap_filter() {
-    clearscreen();
+void calculate_cap_filter(Session& session) {
+    clearscreen(session);
     float  capacitance_needed;
-    double raw_freq, raw_resist, resistance = 0, frequency = 0;
+    double resistance = 0, frequency = 0;
     std::string unit;
-    std::cout << "--- Capacitor Calculator ---\n";
-    std::cout << "Enter unit for the resistance (k for kilo-ohms, M for mega-ohms, O for ohms): ";
-    std::cin >> unit;
-
-    // Get resistance input
-    if (!validate_positive_input(raw_resist, "Enter the resistor value: "))
-        return;
-
-    resistor_input(raw_resist, resistance, unit);
-    if (resistance == 0) {
-        std::cerr << "Invalid resistance input.\n";
+    session.out << "--- Capacitor Calculator ---\n";
+    if (!validate_positive_value(session, resistance, SI_OHM, "Enter the resistor value (e.g. 10k, 4k7): ") ||
+        !validate_positive_value(session, frequency, SI_HERTZ, "Enter the cutoff frequency (e.g. 1k, 2.5kHz): ")) {
         return;
     }
 
-    std::cout << "Enter unit for the cutoff frequency (k for Kilo Hz, M for Mega Hz, H for Hz): ";
-    std::cin >> unit;
-
-    // Get resistance input
-    if (!validate_positive_input(raw_freq, "Enter the frequency value: "))
-        return;
-
-    Fc_input(raw_freq, frequency, unit);
-    if (frequency == 0) {
-        std::cerr << "Invalid input.\n";
-        return;
-    }
-
-    capacitance_needed = 1 / (2 * 3.14 * resistance * frequency);
+    capacitance_needed = required_capacitance(resistance, frequency);
     // Determine the unit of capacitance
     if (1e-9 < capacitance_needed >= 1e-6) {
         capacitance_needed *= 1e6;
@@ -714,184 +811,180 @@ void calculate_cap_filter() {
         capacitance_needed *= 1e12;
         unit = "pF"; // Picofarads
     }
-    std::cout << "Required capacitance = " << capacitance_needed << " " << unit << "\n";
+    session.out << "Required capacitance = " << capacitance_needed << " " << unit << "\n";
 }
 
-void calculate_coff_freq_filter() {
-    clearscreen();
-    double raw_cap, raw_resist, resistance = 0, capacitance = 0;
-    std::string unit;
+void calculate_coff_freq_filter(Session& session) {
+    clearscreen(session);
+    double resistance = 0, capacitance = 0;
     float cutoff_frequency;
-    std::cout << "--- Cutoff Frequency Calculator ---\n";
-    std::cout << "Enter unit for the capacitance (u for microfarads, n for nanofarads, p for picofarads): ";
-    std::cin >> unit;
-
-    // Get capacitance input
-    if (!validate_positive_input(raw_cap, "Enter the capacitor value: "))
-        return;
-
-    capacitor_input(raw_cap, capacitance, unit);
-    if (capacitance == 0) {
-        std::cerr << "Invalid input.\n";
+    session.out << "--- Cutoff Frequency Calculator ---\n";
+    if (!validate_positive_value(session, capacitance, SI_FARAD, "Enter the capacitor value (e.g. 100n, 4.7uF): ") ||
+        !validate_positive_value(session, resistance, SI_OHM, "Enter the resistor value (e.g. 10k, 4k7): ")) {
         return;
     }
 
-    std::cout << "Enter unit for the resistance(k for kilo-ohms, M for mega-ohms, O for ohms): ";
-    std::cin >> unit;
+    cutoff_frequency = calculate_cutoff_frequency(resistance, capacitance, 1.0);
+    session.out << "Cutoff frequency = " << cutoff_frequency << " Hz\n";
+}
+
+// Suggests real E-series R and C pairs for a target cutoff frequency
+void choose_rc_pair(Session& session) {
+    clearscreen(session);
+    double frequency = 0, min_r, max_r;
+    std::string r_series_name, c_series_name;
+    ESeries r_series, c_series;
 
-    // Get resistance input
-    if (!validate_positive_input(raw_resist, "Enter the resistor value: "))
+    session.out << "--- Preferred R and C Finder ---\n";
+    if (!validate_positive_value(session, frequency, SI_HERTZ, "Enter the cutoff frequency (e.g. 1k, 2.5kHz): "))
         return;
 
-    resistor_input(raw_resist, resistance, unit);
-    if (resistance == 0) {
-        std::cerr << "Invalid resistance input.\n";
+    session.out << "Enter resistor E-series (e.g. E24): ";
+    session.in >> r_series_name;
+    if (!parse_eseries(r_series_name, r_series)) {
+        session.out << "Unknown series, using E24.\n";
+        r_series = E24;
+    }
+    session.out << "Enter capacitor E-series (e.g. E6 or E12): ";
+    session.in >> c_series_name;
+    if (!parse_eseries(c_series_name, c_series)) {
+        session.out << "Unknown series, using E6.\n";
+        c_series = E6;
+    }
+    if (!validate_positive_input(session, min_r, "Enter the smallest resistor allowed (ohms): ") ||
+        !validate_positive_input(session, max_r, "Enter the largest resistor allowed (ohms): ")) {
         return;
     }
 
-    cutoff_frequency = calculate_cutoff_frequency(resistance, capacitance, 1.0);
-    std::cout << "Cutoff frequency = " << cutoff_frequency << " Hz\n";
+    // Capacitors from 10 pF to 10 uF
+    const int num_suggestions = 5;
+    RcPair pairs[num_suggestions];
+    int found = best_rc_pairs(frequency, r_series, c_series, min_r, max_r, 10e-12, 10e-6, num_suggestions, pairs);
+    if (found == 0) {
+        session.out << "No R and C pair in that range reaches this cutoff frequency.\n";
+        return;
+    }
+    session.out << "\nBest R and C pairs:\n";
+    for (int i = 0; i < found; i++) {
+        session.out << "R = " << pairs[i].r << " ohms, C = " << pairs[i].c * 1e9 << " nF, cutoff = "
+                  << pairs[i].cutoff_freq << " Hz (" << 100 * pairs[i].error << "%)\n";
+    }
 }
 
-void lowpassfilter() {
-    clearscreen();
-    std::cout << "Selected low Pass Filter:\n";
-    std::cout << "          +----- R ---------------o V_out\n";
-    std::cout << "          ^                |      ^ \n";
-    std::cout << "    V_in  |                C      | \n";
-    std::cout << "          |                |      |\n";
-    std::cout << "          +-----------------------o\n";
+void lowpassfilter(Session& session) {
+    clearscreen(session);
+    session.out << "Selected low Pass Filter:\n";
+    session.out << "          +----- R ---------------o V_out\n";
+    session.out << "          ^                |      ^ \n";
+    session.out << "    V_in  |                C      | \n";
+    session.out << "          |                |      |\n";
+    session.out << "          +-----------------------o\n";
     int choice;
     do {
-        std::cout << "1. Calculate resistance\n";
-        std::cout << "2. Calculate capacitance\n";
-        std::cout << "3. Calculate cutoff frequency\n";
-        std::cout << "4. Back to Filter Menu\n";
-        std::cout << "Select an option: ";
-        std::cin >> choice;
-
-        // Blocks invalid input until correct
-        while (std::cin.fail()) {
-            if (std::cin.fail()) {
-                std::cin.clear();
-                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                std::cout << "Invalid input. Please enter a number between 1 and 3.\n";
-                std::cout << "Enter an integer!\n";
-                std::cin >> choice;
-            }
-        }
+        session.out << "1. Calculate resistance\n";
+        session.out << "2. Calculate capacitance\n";
+        session.out << "3. Calculate cutoff frequency\n";
+        session.out << "4. Choose preferred R and C for a cutoff frequency\n";
+        session.out << "5. Back to Filter Menu\n";
+        session.out << "Select an option: ";
+        choice = read_menu_choice(session, 5);
 
         switch (choice) {
         case 1:
-            calculate_res_filter();
+            calculate_res_filter(session);
             break;
         case 2:
-            calculate_cap_filter();
+            calculate_cap_filter(session);
             break;
         case 3:
-            calculate_coff_freq_filter();
+            calculate_coff_freq_filter(session);
             break;
         case 4:
-            std::cout << "Returning to Filter Menu...\n";
+            choose_rc_pair(session);
+            break;
+        case 5:
+            session.out << "Returning to Filter Menu...\n";
             break;
         default:
-            std::cout << "Invalid option. Try again.\n";
+            session.out << "Invalid option. Try again.\n";
             return;
         }
-    } while (choice != 4);
+    } while (choice != 5);
 }
 
-void highpassfilter() {
-    clearscreen();
-    std::cout << "Selected high pass filter:\n";
-    std::cout << "          +----- C ---------------o V_out\n";
-    std::cout << "          ^                |      ^ \n";
-    std::cout << "    V_in  |                R      | \n";
-    std::cout << "          |                |      |\n";
-    std::cout << "          +-----------------------o\n";
+void highpassfilter(Session& session) {
+    clearscreen(session);
+    session.out << "Selected high pass filter:\n";
+    session.out << "          +----- C ---------------o V_out\n";
+    session.out << "          ^                |      ^ \n";
+    session.out << "    V_in  |                R      | \n";
+    session.out << "          |                |      |\n";
+    session.out << "          +-----------------------o\n";
     int choice;
     do {
-        std::cout << "1. Calculate resistance\n";
-        std::cout << "2. Calculate capacitance\n";
-        std::cout << "3. Calculate cutoff frequency\n";
-        std::cout << "4. Back to Filter Menu\n";
-        std::cout << "Select an option: ";
-        std::cin >> choice;
-
-        // Blocks invalid input until correct
-        while (std::cin.fail()) {
-            if (std::cin.fail()) {
-                std::cin.clear();
-                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                std::cout << "Invalid input. Please enter a number between 1 and 3.\n";
-                std::cout << "Enter an integer!\n";
-                std::cin >> choice;
-            }
-        }
+        session.out << "1. Calculate resistance\n";
+        session.out << "2. Calculate capacitance\n";
+        session.out << "3. Calculate cutoff frequency\n";
+        session.out << "4. Choose preferred R and C for a cutoff frequency\n";
+        session.out << "5. Back to Filter Menu\n";
+        session.out << "Select an option: ";
+        choice = read_menu_choice(session, 5);
 
         switch (choice) {
         case 1:
-            calculate_res_filter();
+            calculate_res_filter(session);
             break;
         case 2:
-            calculate_cap_filter();
+            calculate_cap_filter(session);
             break;
         case 3:
-            calculate_coff_freq_filter();
+            calculate_coff_freq_filter(session);
             break;
         case 4:
-            std::cout << "Returning to Main Menu...\n";
+            choose_rc_pair(session);
+            break;
+        case 5:
+            session.out << "Returning to Main Menu...\n";
             break;
         default:
-            std::cout << "Invalid option. Try again.\n";
+            session.out << "Invalid option. Try again.\n";
         }
-    } while (choice != 4);
+    } while (choice != 5);
 }
 
-void menu_item_3() {
+void menu_item_3(Session& session) {
     int choice;
     do {
-        clearscreen();
+        clearscreen(session);
         // Sub menu item 3
-        std::cout << "\n--- Filter Calculator ---\n";
-        std::cout << "Are you building a High pass filter or a Low pass filter?\n";
-        std::cout << "1. Low Pass Filter\n";
-        std::cout << "2. High Pass Filter\n";
-        std::cout << "3. Exit to Main Menu\n";
-        std::cout << "Select an option: ";
-        std::cin >> choice;
-
-        // Blocks invalid input until correct
-        while (std::cin.fail()) {
-            if (std::cin.fail()) {
-                std::cin.clear();
-                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                std::cout << "Invalid input. Please enter a number between 1 and 3.\n";
-                std::cout << "Enter an integer!\n";
-                std::cin >> choice;
-            }
-        }
+        session.out << "\n--- Filter Calculator ---\n";
+        session.out << "Are you building a High pass filter or a Low pass filter?\n";
+        session.out << "1. Low Pass Filter\n";
+        session.out << "2. High Pass Filter\n";
+        session.out << "3. Exit to Main Menu\n";
+        session.out << "Select an option: ";
+        choice = read_menu_choice(session, 3);
 
         switch (choice) {
         case 1:
-            lowpassfilter();
+            lowpassfilter(session);
             break;
         case 2:
-            highpassfilter();
+            highpassfilter(session);
             break;
         case 3:
-            std::cout << "Returning to main menu...\n";
+            session.out << "Returning to main menu...\n";
             break;
         default:
-            std::cout << "Invalid option. Try again.\n";
+            session.out << "Invalid option. Try again.\n";
         }
     } while (choice != 3); // Repeat the menu until the user chooses to exit
-    //  std::cout << "\n>> High or Low pass RC Filters\n";
+    //  session.out << "\n>> High or Low pass RC Filters\n";
 }
 
 // Sallen Key circuit diagram
-void print_sallen_key_diagram() {
-    std::cout << R"(
+void print_sallen_key_diagram(Session& session) {
+    session.out << R"(
 |-------------------------------------Sallen-Key Filter Circuit Diagram:---------------------------------------|
 |                                                                                                              |    
 |                                              |-----|                                                         |
@@ -928,264 +1021,262 @@ void print_sallen_key_diagram() {
 }
 
 // Asks the user to input circuit components
-void get_component_values(double& r, double& c, double& ra, double& rb) {
-    std::cout << "\nEnter values for Resistors and Capacitors:\n";
-    double raw_resist, raw_cap;
-    std::string unit;
-
+void get_component_values(Session& session, double& r, double& c, double& ra, double& rb) {
+    session.out << "\nEnter values for Resistors and Capacitors:\n";
 
-    // Get resistance input
-    std::cout << "Enter unit for R (k for kilo-ohms, M for mega-ohms, O for ohms): ";
-    std::cin >> unit;
-    if (!validate_positive_input(raw_resist, "Enter the resistance of R = R1 = R2 : ")) {
-        std::cout << "Please enter a positive integer: ";
-        std::cin >> raw_resist;
+    // Each value may carry a prefix and unit, e.g. 10k, 4k7, 100nF
+    if (!validate_positive_value(session, r, SI_OHM, "Enter the resistance of R = R1 = R2 : ") ||
+        !validate_positive_value(session, c, SI_FARAD, "Enter the capacitance C = C1 = C2 : ") ||
+        !validate_positive_value(session, rb, SI_OHM, "Enter the resistance of RB : ")) {
+        return;
     }
-    resistor_input(raw_resist, r, unit);
 
-    std::cout << "\nEnter unit for C (u for microfarads, n for nanofarads, p for picofarads): ";
-    std::cin >> unit;
 
-    // Get resistance input
-    if (!validate_positive_input(raw_cap, "Enter the capacitance C = C1 = C2  "))
-        return;
+}
 
-    capacitor_input(raw_cap, c, unit);
-    if (c <= 0) {
-        std::cerr << " \nInvalid capacitance input.";
+// Shows the preferred RA/RB pair closest to a stage gain, near the chosen RB
+void print_best_ra_rb(Session& session, double gain, double rb) {
+    ResistorRatio pair;
+    if (best_ratio_pairs(gain - 1, E12, rb / 10, rb * 10, 1, &pair) == 0) {
         return;
     }
-    // Get resistance input
-    std::cout << "\nEnter unit for RB (k for kilo-ohms, M for mega-ohms, O for ohms): ";
-    std::cin >> unit;
-    if (!validate_positive_input(raw_resist, "Enter the resistance of RB : ")) {
-        std::cout << "Please enter a positive integer: ";
-        std::cin >> raw_resist;
-    }
-    resistor_input(raw_resist, rb, unit);
-
-
+    session.out << "\nBest E12 pair for this gain: RA = " << pair.numerator << " ohms, RB = " << pair.denominator
+              << " ohms (gain " << 1 + pair.ratio << ", " << 100 * (1 + pair.ratio - gain) / gain << "%)\n";
 }
 
 // Butterworth filter calculator
-void butterworth_filter(int num_poles, double r, double c, double ra, double rb, int pole_pair_index) {
-    std::cout << "\nPerforming calculations for Butterworth with " << num_poles << " poles, Pole Pair " << pole_pair_index << "...\n";
-    press_to_continue();
+void butterworth_filter(Session& session, int num_poles, double r, double c, double ra, double rb, int pole_pair_index) {
+    session.out << "\nPerforming calculations for Butterworth with " << num_poles << " poles, Pole Pair " << pole_pair_index << "...\n";
+    press_to_continue(session);
 
-    std::vector<double> gains;
-    if (num_poles == 2) {
-        gains = { 1.586 };
-    }
-    else if (num_poles == 4) {
-        gains = { 1.152, 2.325 };
-    }
-    else if (num_poles == 6) {
-        gains = { 1.068, 1.586, 2.483 };
+    PolePairData pairs[MAX_POLE_PAIRS];
+    if (pole_table(BUTTERWORTH, num_poles, pairs) < pole_pair_index) {
+        session.err << "No Butterworth data for " << num_poles << " poles.\n";
+        return;
     }
 
-    double gain = gains[pole_pair_index - 1]; // Adjust for zero-based index
-    std::cout << "The filter gain for Pole Pair " << pole_pair_index << " is " << gain << '\n';
+    double gain = pairs[pole_pair_index - 1].gain; // Adjust for zero-based index
+    session.out << "The filter gain for Pole Pair " << pole_pair_index << " is " << gain << '\n';
+
+    // Odd orders end in a first-order RC section driving a follower: no RA/RB
+    if (pairs[pole_pair_index - 1].q == 0) {
+        session.out << "Pole Pair " << pole_pair_index << " is a first-order RC section (RA shorted, RB left open).\n";
+        display_cutoff_frequency(session, calculate_cutoff_frequency(r, c));
+        return;
+    }
 
     // Ensure gain is valid for calculation
     if (gain <= 1.0) {
-        std::cerr << "Invalid gain value (" << gain << "). Must be greater than 1.\n";
+        session.err << "Invalid gain value (" << gain << "). Must be greater than 1.\n";
         return;
     }
 
     // Calculate `ra` using `rb` and gain
-    ra = rb * (gain - 1);
+    SallenKeyStage stage = sallen_key_stage(pairs[pole_pair_index - 1], r, c, rb);
+    ra = stage.ra;
 
     // Display component values
-    std::cout << "\nResistor RA: " << ra << "\n";
-    get_npv_and_color_code_for_resistor(ra);
+    session.out << "\nResistor RA: " << ra << "\n";
+    get_npv_and_color_code_for_resistor(session, ra);
 
-    std::cout << "\nResistor RB: " << rb << " \n";
-    get_npv_and_color_code_for_resistor(rb);
+    session.out << "\nResistor RB: " << rb << " \n";
+    get_npv_and_color_code_for_resistor(session, rb);
+    print_best_ra_rb(session, gain, rb);
 
-    // Calculate and display the cutoff frequency for this pole pair
-    double cutoff_freq = calculate_cutoff_frequency(r, c);
-    display_cutoff_frequency(cutoff_freq);
-}
-
-// Function to fetch gains and factors based on Chebyshev type and poles
-void chebyshev_filter_data(int num_poles, int type, std::vector<float>& gains, std::vector<float>& factors_low, std::vector<float>& factors_high) {
-
-    if (type == 2) { // 0.5 dB Chebyshev
-        // Characteristics for each pole
-        if (num_poles == 2) {
-            gains = { 1.842 };
-            factors_low = { 1.231 };
-            factors_high = { 0.812 };
-        }
-        else if (num_poles == 4) {
-            gains = { 1.582, 2.660 };
-            factors_low = { 0.597, 1.031 };
-            factors_high = { 1.675, 0.970 };
-        }
-        else if (num_poles == 6) {
-            gains = { 1.537, 2.448, 2.846 };
-            factors_low = { 0.396, 0.768, 1.011 };
-            factors_high = { 2.525, 1.302, 0.989 };
-        }
-    }
-    else if (type == 3) { // 2 dB Chebyshev
-        if (num_poles == 2) {
-            gains = { 2.114 };
-            factors_low = { 0.907 };
-            factors_high = { 1.103 };
-        }
-        else if (num_poles == 4) {
-            gains = { 1.924, 2.782 };
-            factors_low = { 0.471, 0.964 };
-            factors_high = { 2.123, 1.037 };
-        }
-        else if (num_poles == 6) {
-            gains = { 1.891, 2.648, 2.904 };
-            factors_low = { 0.316, 0.730, 0.983 };
-            factors_high = { 3.165, 1.370, 1.017 };
-        }
-    }
+    // Display the cutoff frequency for this pole pair
+    display_cutoff_frequency(session, stage.cutoff_freq);
 }
 
 // Chebyshev filter calculator
-void chebyshev_filter(int num_poles, int type, const std::string& filter_type, double r, double c, double ra, double rb, int pole_pair_index) {
-    std::vector<float> gains, factors_low, factors_high;
+void chebyshev_filter(Session& session, int num_poles, int type, double r, double c, double ra, double rb, int pole_pair_index) {
+    PolePairData pairs[MAX_POLE_PAIRS];
 
     // Fetch appropriate gains and cutoff factors based on the filter type and number of poles
-    chebyshev_filter_data(num_poles, type, gains, factors_low, factors_high);
+    int num_pairs = pole_table(static_cast<FilterFamily>(type), num_poles, pairs);
 
-    // Determine the factors based on filter type (low-pass or high-pass)
-    std::vector<float> factors = (filter_type == "low") ? factors_low : factors_high;
-    std::cout << "\nPerforming calculations for Chebyshev with " << num_poles << " poles, Pole Pair " << pole_pair_index << "...\n";
-    press_to_continue();
+    session.out << "\nPerforming calculations for Chebyshev with " << num_poles << " poles, Pole Pair " << pole_pair_index << "...\n";
+    press_to_continue(session);
 
-    double gain = gains[pole_pair_index - 1]; // Adjust for zero-based index
-    std::cout << "The filter gain for Pole Pair " << pole_pair_index << " is " << gain << '\n';
+    if (num_pairs < pole_pair_index) {
+        session.err << "No Chebyshev data for " << num_poles << " poles.\n";
+        return;
+    }
+
+    double gain = pairs[pole_pair_index - 1].gain; // Adjust for zero-based index
+    session.out << "The filter gain for Pole Pair " << pole_pair_index << " is " << gain << '\n';
+
+    // Odd orders end in a first-order RC section driving a follower: no RA/RB
+    if (pairs[pole_pair_index - 1].q == 0) {
+        session.out << "Pole Pair " << pole_pair_index << " is a first-order RC section (RA shorted, RB left open).\n";
+        display_cutoff_frequency(session, calculate_cutoff_frequency(r, c));
+        return;
+    }
 
     // Ensure gain is valid for calculation
     if (gain <= 1.0) {
-        std::cerr << "Invalid gain value (" << gain << "). Must be greater than 1.\n";
+        session.err << "Invalid gain value (" << gain << "). Must be greater than 1.\n";
         return;
     }
 
     // Calculate `ra` using `rb` and gain
-    ra = rb * (gain - 1);
+    SallenKeyStage stage = sallen_key_stage(pairs[pole_pair_index - 1], r, c, rb);
+    ra = stage.ra;
 
     // Display component values for this pole pair
-    std::cout << "\nResistor RA: " << ra << "\n";
-    get_npv_and_color_code_for_resistor(ra);
+    session.out << "\nResistor RA: " << ra << "\n";
+    get_npv_and_color_code_for_resistor(session, ra);
 
-    std::cout << "\nResistor RB: " << rb << " \n";
-    get_npv_and_color_code_for_resistor(rb);
+    session.out << "\nResistor RB: " << rb << " \n";
+    get_npv_and_color_code_for_resistor(session, rb);
+    print_best_ra_rb(session, gain, rb);
+
+    // Display the cutoff frequency for this pole pair
+    display_cutoff_frequency(session, stage.cutoff_freq);
+}
+
+// Optimises preferred R, C, RA and RB for every pole pair at once
+void optimise_cascade(Session& session, FilterFamily family, int num_poles, const std::string& filter_type) {
+    CascadeOptions options;
+    options.ripple_db = family_ripple(family);
+    options.num_poles = num_poles;
+    options.high_pass = (filter_type == "high");
+
+    if (!validate_positive_value(session, options.cutoff_freq, SI_HERTZ, "Enter the cutoff frequency (e.g. 1k, 2.5kHz): "))
+        return;
+    session.out << "Enter the most distinct part values allowed (0 for no limit): ";
+    session.in >> options.max_distinct_values;
+    if (session.in.fail()) {
+        session.in.clear();
+        options.max_distinct_values = 0;
+    }
 
-    // Calculate and display the cutoff frequency for this pole pair
-    double cutoff_freq = calculate_cutoff_frequency(r * factors_low[pole_pair_index - 1], c * factors_high[pole_pair_index - 1]);
-    display_cutoff_frequency(cutoff_freq);
+    CascadeDesign design = optimise_sallen_key_cascade(options);
+    if (design.num_stages == 0) {
+        session.out << "\nNo E24/E12 design meets these limits.\n";
+        return;
+    }
+    print_sallen_key_diagram(session);
+    for (int i = 0; i < design.num_stages; i++) {
+        const CascadeStage& stage = design.stages[i];
+        session.out << "\n--- Pole Pair " << (i + 1) << " ---\n";
+        session.out << "  R1 = R2 = " << stage.r << " ohms, C1 = C2 = " << stage.c << " farads\n";
+        session.out << "  RA = " << stage.ra << " ohms, RB = " << stage.rb << " ohms\n";
+        session.out << "  f0 = " << stage.achieved_freq << " Hz (target " << stage.target_freq << " Hz), "
+                  << "Q = " << stage.achieved_q << " (target " << stage.target_q << ")\n";
+    }
+    session.out << "\nDistinct part values: " << design.distinct_values
+              << ", total squared log error: " << design.total_error << "\n";
 }
 
 // Menu item 4
-void menu_item_4() {
+void menu_item_4(Session& session) {
     int choice = 0;
     std::string filter_type, repeat_choice;
     double r = 0, c = 0, ra = 0, rb = 0;
 
     do {
-        clearscreen();
-        std::cout << "\n>> Menu 4: Sallen-Key Filter Configuration\n";
+        clearscreen(session);
+        session.out << "\n>> Menu 4: Sallen-Key Filter Configuration\n";
 
         // Display filter type submenu
-        std::cout << "\n-- Select Filter Type: --\n";
-        std::cout << "1. Butterworth\n";
-        std::cout << "2. 0.5 dB Chebyshev\n";
-        std::cout << "3. 2 dB Chebyshev\n";
-        std::cout << "4. Back to main menu\n";
-        std::cout << "Select choice: ";
-        std::cin >> choice;
-      // Validate choice
-        while (std::cin.fail() || choice < 1 || choice > 4) {
-            std::cin.clear();
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            std::cout << "Invalid input. Please enter a number between 1 and 4: ";
-            std::cin >> choice;
-        }
+        session.out << "\n-- Select Filter Type: --\n";
+        session.out << "1. Butterworth\n";
+        session.out << "2. 0.5 dB Chebyshev\n";
+        session.out << "3. 2 dB Chebyshev\n";
+        session.out << "4. Back to main menu\n";
+        session.out << "Select choice: ";
+        choice = read_menu_choice(session, 4);
 
 
         // User input for the number of poles
         int num_poles;
-        std::cout << "\n Enter the number of poles (2, 4, or 6): ";
-        std::cin >> num_poles;
+        session.out << "\n Enter the number of poles (1 to " << MAX_FILTER_ORDER << "): ";
+        session.in >> num_poles;
 
-        if (num_poles != 2 && num_poles != 4 && num_poles != 6) {
-            std::cout << "\nInvalid input. Only 2, 4, or 6 poles are allowed.\n";
+        if (session.in.fail() || num_poles < 1 || num_poles > MAX_FILTER_ORDER) {
+            session.out << "\nInvalid input. Only 1 to " << MAX_FILTER_ORDER << " poles are allowed.\n";
             return;
         }
 
         // Filter type selection
-        std::cout << "\nEnter whether the filter is 'high' or 'low' pass: ";
-        std::cin >> filter_type;
+        session.out << "\nEnter whether the filter is 'high' or 'low' pass: ";
+        session.in >> filter_type;
 
         // Convert input to lowercase
         std::transform(filter_type.begin(), filter_type.end(), filter_type.begin(), ::tolower);
 
         if (filter_type != "high" && filter_type != "low") {
-            std::cout << "\nInvalid filter type. Please specify 'high' or 'low'.\n";
+            session.out << "\nInvalid filter type. Please specify 'high' or 'low'.\n";
             return;
         }
 
 
   
-        // Number of pole pairs
-        int diagram_count = num_poles / 2;
+        session.out << "\n1. Enter R, C and RB for each pole pair\n";
+        session.out << "2. Pick preferred parts for the whole filter automatically\n";
+        session.out << "Select choice: ";
+        int design_choice;
+        session.in >> design_choice;
+        if (!session.in.fail() && design_choice == 2) {
+            optimise_cascade(session, static_cast<FilterFamily>(choice), num_poles, filter_type);
+            session.out << "\nWould you like to perform another calculation in this menu? (y/n): ";
+            session.in >> repeat_choice;
+            continue;
+        }
+        session.in.clear();
+
+        // Number of pole pairs, plus the first-order section of an odd order
+        int diagram_count = (num_poles + 1) / 2;
 
         // Loop through each pole pair
         for (int i = 0; i < diagram_count; ++i) {
-            std::cout << "\n--- Configuration for Pole Pair " << (i + 1) << " ---\n";
+            session.out << "\n--- Configuration for Pole Pair " << (i + 1) << " ---\n";
 
             double r = 0, c = 0, ra = 0, rb = 0;
-            std::cout << "\nEnter component values for Pole Pair " << (i + 1) << ":\n";
-            get_component_values(r, c, ra, rb);
+            session.out << "\nEnter component values for Pole Pair " << (i + 1) << ":\n";
+            get_component_values(session, r, c, ra, rb);
 
             // Display the Sallen-Key diagram
-            std::cout << "\nGenerating a Sallen-Key " << filter_type << " filter diagram...\n";
-            print_sallen_key_diagram();
+            session.out << "\nGenerating a Sallen-Key " << filter_type << " filter diagram...\n";
+            print_sallen_key_diagram(session);
 
             // Call the selected filter function with current pole pair data
             if (choice == 1) { // Butterworth
-                butterworth_filter(num_poles, r, c, ra, rb, i + 1); // Pass pole pair index (i + 1)
+                butterworth_filter(session, num_poles, r, c, ra, rb, i + 1); // Pass pole pair index (i + 1)
             }
             else if (choice == 2) { // 0.5 dB Chebyshev
-                chebyshev_filter(num_poles, 2, filter_type, r, c, ra, rb, i + 1); // Pass pole pair index (i + 1)
+                chebyshev_filter(session, num_poles, 2, r, c, ra, rb, i + 1); // Pass pole pair index (i + 1)
             }
             else if (choice == 3) { // 2 dB Chebyshev
-                chebyshev_filter(num_poles, 3, filter_type, r, c, ra, rb, i + 1); // Pass pole pair index (i + 1)
+                chebyshev_filter(session, num_poles, 3, r, c, ra, rb, i + 1); // Pass pole pair index (i + 1)
             }
 
             if (filter_type == "high") {
-                std::cout << "\n  Z1 = C1 = " << c << " farads\n";
-                std::cout << "  Z2 = C2 = " << c << " farads\n";
-                std::cout << "  Z3 = R1 = " << r << " ohms\n";
-                std::cout << "  Z4 = R2 = " << r << " ohms\n";
+                session.out << "\n  Z1 = C1 = " << c << " farads\n";
+                session.out << "  Z2 = C2 = " << c << " farads\n";
+                session.out << "  Z3 = R1 = " << r << " ohms\n";
+                session.out << "  Z4 = R2 = " << r << " ohms\n";
             }
             else { // Low-pass filter
-                std::cout << "\n  Z1 = R1 = " << r << " ohms\n";
-                std::cout << "  Z2 = R2 = " << r << " ohms\n";
-                std::cout << "  Z3 = C1 = " << c << " farads\n";
-                std::cout << "  Z4 = C2 = " << c << " farads\n";
+                session.out << "\n  Z1 = R1 = " << r << " ohms\n";
+                session.out << "  Z2 = R2 = " << r << " ohms\n";
+                session.out << "  Z3 = C1 = " << c << " farads\n";
+                session.out << "  Z4 = C2 = " << c << " farads\n";
             }
 
             // Display the resistor color codes for R1 & R2
-            std::cout << "\nResistor R1 & R2:\n";
-            get_npv_and_color_code_for_resistor(r);
+            session.out << "\nResistor R1 & R2:\n";
+            get_npv_and_color_code_for_resistor(session, r);
 
             // Separator for clarity
-            std::cout << "\n----------------------------\n";
+            session.out << "\n----------------------------\n";
         }
 
         // Prompt to repeat or exit
-        std::cout << "\nWould you like to perform another calculation in this menu? (y/n): ";
-        std::cin >> repeat_choice;
+        session.out << "\nWould you like to perform another calculation in this menu? (y/n): ";
+        session.in >> repeat_choice;
 
-    } while (repeat_choice == "y" || repeat_choice == "Y");
+    } while ((repeat_choice == "y" || repeat_choice == "Y") && session.in);
 
-    std::cout << "\nReturning to the main menu...\n";
+    session.out << "\nReturning to the main menu...\n";
 }
@@ -1,42 +1,69 @@
 #ifndef FUNCS_H
 #define FUNCS_H
 
-void menu_item_1();
-void menu_item_2();
-void menu_item_3();
-void menu_item_4();
+#include <iostream>
+#include "calc.h"
+#include "si_value.h"
+
+// One user's run through the menus. Every menu function reads and writes only through
+// its session, so sessions on different threads (one per terminal or connection) don't
+// share any stream or state.
+struct Session {
+    std::istream& in;
+    std::ostream& out;
+    std::ostream& err;          // error messages; can be the same stream as out
+    bool clear_screen = true;   // clear between screens, false for logs and pipes
+    bool running = true;        // false once the user exits or the input runs out
+
+    Session(std::istream& in, std::ostream& out, std::ostream& err) : in(in), out(out), err(err) {}
+};
+
+// Runs the main menu until the user picks Exit or the input runs out
+void run_session(Session& session);
+
+void menu_item_1(Session& session);
+void menu_item_2(Session& session);
+void menu_item_3(Session& session);
+void menu_item_4(Session& session);
 
 // General Menu functions
-void Fc_input(double raw_freq, double& frequency, const std::string& unit);
-void capacitor_input(double raw_cap, double& capacitance, const std::string& unit);
-void resistor_input(double raw_resist, double& resistance, const std::string& unit);
-void display_cutoff_frequency(float cutoff_freq);
-double calculate_cutoff_frequency(double r, double c, double factor);
+int read_menu_choice(Session& session, int num_items);
+bool validate_positive_value(Session& session, double& value, SiUnit unit, const std::string& prompt);
+void display_cutoff_frequency(Session& session, float cutoff_freq);
 
-void go_back_to_main();
-bool validate_positive_input(double& value, const std::string& prompt);
-void clearscreen();
-void press_to_continue();
+void go_back_to_main(Session& session);
+bool validate_positive_input(Session& session, double& value, const std::string& prompt);
+void clearscreen(Session& session);
+void press_to_continue(Session& session);
 
 // Menu item 1 functions
-void calculate_resistor_from_color_code();
-void combine_resistors();
-void get_npv_and_color_code_for_resistor(double resistance);
-void find_nearest_npv_resistor();
+void calculate_resistor_from_color_code(Session& session);
+void combine_resistors(Session& session);
+void combine_network_expression(Session& session);
+void solve_netlist_file(Session& session);
+void get_npv_and_color_code_for_resistor(Session& session, double resistance);
+void find_nearest_npv_resistor(Session& session);
+void design_resistor_network(Session& session);
+
+// Menu item 2 functions
+void choose_gain_resistors(Session& session);
+void simulate_ac_netlist(Session& session);
 
 // Menu item 3 functions
-void calculate_res_filter();
-void calculate_cap_filter();
-void calculate_coff_freq_filter();
-void lowpassfilter();
-void highpassfilter();
+void calculate_res_filter(Session& session);
+void calculate_cap_filter(Session& session);
+void calculate_coff_freq_filter(Session& session);
+void choose_rc_pair(Session& session);
+void lowpassfilter(Session& session);
+void highpassfilter(Session& session);
 
 //Menu item 4 functions
-void print_sallen_key_diagram();
-void get_component_values(double& r, double& c, double& ra, double& rb);
-void butterworth_filter(int num_poles, double r, double c, double ra, double rb, int pole_pair_index);
-void chebyshev_filter_data(int num_poles, int type, std::vector<float>& gains, std::vector<float>& factors_low, std::vector<float>& factors_high);
-void chebyshev_filter(int num_poles, int type, const std::string& filter_type, double r, double c, double ra, double rb, int pole_pair_index);
+void print_sallen_key_diagram(Session& session);
+void get_component_values(Session& session, double& r, double& c, double& ra, double& rb);
+void print_best_ra_rb(Session& session, double gain, double rb);
+void butterworth_filter(Session& session, int num_poles, double r, double c, double ra, double rb, int pole_pair_index);
+void optimise_cascade(Session& session, FilterFamily family, int num_poles, const std::string& filter_type);
+void chebyshev_filter(Session& session, int num_poles, int type, double r, double c, double ra, double rb, int pole_pair_index);
 
 #endif
 
@@ -1,101 +1,160 @@
 #include <iostream>
-#include <regex> // needed to parse inputs
 #include "funcs.h" // sub functions go in here
+#include "batch.h" // non-interactive batch mode
+#include "cli.h" // one-shot commands
+#include "daemon.h" // long-running socket server
+#include "catalog.h" // parts catalog files
+#include "rows.h" // bulk CSV/JSONL row jobs
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
 #include <string>
 #include <map>
 #include <vector>
 #include <cmath>
 
 
-void main_menu();       // runs in the main loop
-void print_main_menu(); // output the main menu description
-
-int get_user_input(); // get a valid integer choice from the user input
-void select_menu_item(
-    int input);         // run the desired code based on the users choice
-void go_back_to_main(); // print message to prompt user to return to main menu
-bool is_integer(std::string num); // check input is
-
 int main(int argc, char const *argv[]) {
-  // this will run forever until we hit the exit(1); line in select_menu_item()
-  while (1) {
-    main_menu();
+  // ENGINUITY_MEMO=<file> keeps expensive design results on disk across runs and processes
+  const char* memo_path = std::getenv("ENGINUITY_MEMO");
+  std::string memo_error;
+  if (argc >= 2 && memo_path && *memo_path && !open_batch_memo(memo_path, memo_error)) {
+    std::cerr << "warning: " << memo_error << "\n";
   }
-  return 0;
-}
-
-void main_menu() {
-  print_main_menu();
-  int input = get_user_input();
-  select_menu_item(input);
-}
 
-int get_user_input() {
-  int input;
-  std::string input_string;
-  bool valid_input = false;
-  int menu_items = 5;
+  // ENGINUITY_CATALOG=<file> limits "stock" requests to the parts in a catalog built with --build-catalog
+  const char* catalog_path = std::getenv("ENGINUITY_CATALOG");
+  std::string catalog_error;
+  if (argc >= 2 && catalog_path && *catalog_path && !open_batch_catalog(catalog_path, catalog_error)) {
+    std::cerr << "warning: " << catalog_error << "\n";
+  }
 
-  do {
-    std::cout << "\nSelect item: ";
-    std::cin >> input_string;
-    valid_input = is_integer(input_string);
-    // if input is not an integer, print an error message
-    if (valid_input == false) {
-      std::cout << "Enter an integer!\n";
-    } else { // if it is an int, check whether in range
-      input = std::stoi(input_string); // convert to int
-      if (input >= 1 && input <= menu_items) {
-        valid_input = true;
-      } else {
-        std::cout << "Invalid menu item!\n";
-        valid_input = false;
+  // --build-catalog <csv> <file> converts a parts list into the mapped catalog format
+  if (argc >= 2 && std::string(argv[1]) == "--build-catalog") {
+    if (argc != 4) {
+      std::cerr << "usage: enginuity --build-catalog <parts.csv | -> <catalog>\n";
+      return 2;
+    }
+    std::ifstream csv;
+    if (std::string(argv[2]) != "-") {
+      csv.open(argv[2]);
+      if (!csv) {
+        std::cerr << "Cannot open " << argv[2] << "\n";
+        return 1;
       }
     }
-  } while (valid_input == false);
-
-  return input;
-}
-
-void select_menu_item(int input) {
-  switch (input) {
-  case 1:
-    menu_item_1();
-    go_back_to_main();
-    break;
-  case 2:
-    menu_item_2();
-    go_back_to_main();
-    break;
-  case 3:
-    menu_item_3();
-    go_back_to_main();
-    break;
-  case 4:
-    menu_item_4();
-    go_back_to_main();
-    break;
-  default:
-    std::cout << "Bye!\n";
-    exit(1);
-    break;
+    long long count;
+    std::string error;
+    if (!build_catalog(csv.is_open() ? csv : std::cin, argv[3], count, error)) {
+      std::cerr << "error: " << error << "\n";
+      return 1;
+    }
+    std::cerr << count << " parts\n";
+    return 0;
+  }
+  // --batch [file] runs one calculation per line from a file (or stdin) without the menus
+  if (argc >= 2 && std::string(argv[1]) == "--batch") {
+    std::ios::sync_with_stdio(false);
+    if (argc < 3 || std::string(argv[2]) == "-") {
+      return run_batch(std::cin, std::cout) == 0 ? 0 : 1;
+    }
+    std::ifstream jobs(argv[2]);
+    if (!jobs) {
+      std::cerr << "Cannot open " << argv[2] << "\n";
+      return 1;
+    }
+    return run_batch(jobs, std::cout) == 0 ? 0 : 1;
+  }
+  // --rows <npv | cutoff | decode> [file] runs one calculation over every row of a CSV or JSONL file on every core
+  if (argc >= 2 && std::string(argv[1]) == "--rows") {
+    RowOptions options;
+    std::string path = "-", error;
+    bool ok = argc >= 3 && parse_row_job(argv[2], options.job);
+    for (int i = 3; ok && i < argc; i++) {
+      std::string arg = argv[i];
+      if ((arg == "--columns" || arg == "--keys") && i + 1 < argc) {
+        std::string list = argv[++i];
+        for (size_t start = 0; start <= list.size();) {
+          size_t comma = std::min(list.find(',', start), list.size());
+          std::string field = list.substr(start, comma - start);
+          if (arg == "--keys") {
+            options.keys.push_back(field);
+          }
+          else {
+            options.columns.push_back(std::atoi(field.c_str()));
+          }
+          start = comma + 1;
+        }
+      }
+      else if (arg == "--series" && i + 1 < argc) {
+        ok = parse_eseries(argv[++i], options.series);
+      }
+      else if (arg == "--threads" && i + 1 < argc) {
+        options.num_threads = std::atoi(argv[++i]);
+      }
+      else if (arg == "-" || arg[0] != '-') {
+        path = arg;
+      }
+      else {
+        ok = false;
+      }
+    }
+    if (!ok) {
+      std::cerr << "usage: enginuity --rows <npv | cutoff | decode> [file | -] [--columns 1,2] [--keys r,c] [--series E12] [--threads n]\n";
+      return 2;
+    }
+    if (!default_row_fields(options, error)) {
+      std::cerr << "error: " << error << "\n";
+      return 2;
+    }
+    std::ios::sync_with_stdio(false);
+    RowStats stats;
+    if (!run_rows(path, options, std::cout, stats, error)) {
+      std::cerr << "error: " << error << "\n";
+      return 1;
+    }
+    std::cout.flush();
+    if (stats.errors > 0) {
+      std::cerr << stats.errors << " of " << stats.rows << " rows failed\n";
+    }
+    return stats.errors > 0 || !std::cout ? 1 : 0;
+  }
+  // --daemon [socket] [--tcp port] [--threads n] [--cache bytes] serves batch requests until SIGINT or SIGTERM
+  if (argc >= 2 && std::string(argv[1]) == "--daemon") {
+    DaemonOptions options;
+    const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+    options.socket_path = std::string(runtime_dir ? runtime_dir : "/tmp") + "/enginuity.sock";
+    for (int i = 2; i < argc; i++) {
+      std::string arg = argv[i];
+      double bytes;
+      if ((arg == "--tcp" || arg == "--threads") && i + 1 < argc) {
+        (arg == "--tcp" ? options.tcp_port : options.num_threads) = std::atoi(argv[++i]);
+      }
+      else if (arg == "--cache" && i + 1 < argc && parse_value(argv[++i], bytes) && bytes >= 0) {
+        set_batch_cache_capacity(static_cast<size_t>(bytes));
+      }
+      else if (!arg.empty() && arg[0] != '-') {
+        options.socket_path = arg;
+      }
+      else {
+        std::cerr << "usage: enginuity --daemon [socket] [--tcp port] [--threads n] [--cache bytes]\n";
+        return 2;
+      }
+    }
+    if (options.tcp_port < 0 || options.tcp_port > 65535 || options.num_threads < 0) {
+      std::cerr << "error: invalid --tcp or --threads value\n";
+      return 2;
+    }
+    return run_daemon(options, std::cerr);
+  }
+  // Any other arguments are one command, e.g. "enginuity rc cutoff --r 10k --c 100n"
+  if (argc >= 2) {
+    std::ios::sync_with_stdio(false);
+    return run_cli(argc - 1, argv + 1, std::cout, std::cerr);
   }
-}
-
-void print_main_menu() {
-    std::cout << "\n------------------- Enginuity -------------------\n";
-    std::cout << "|\t\t\t\t\t\t|\n";
-    std::cout << "|\t1. Resistor Calculator           \t|\n";
-    std::cout << "|\t2. Op Amp Configurator           \t|\n";
-    std::cout << "|\t3. RC Filter Calculator          \t|\n";
-    std::cout << "|\t4. Sallen Key Filter Configurator\t|\n";
-    std::cout << "|\t5. Exit\t\t\t\t\t|\n";
-    std::cout << "|\t\t\t\t\t\t|\n";
-    std::cout << "-------------------------------------------------\n";
-}
 
-// https://codereview.stackexchange.com/questions/162569/checking-if-each-char-in-a-string-is-a-decimal-digit
-bool is_integer(std::string num) {
-  return std::regex_match(num, std::regex("[+-]?[0-9]+"));
+  // The menus on this terminal; other front ends can run their own sessions alongside
+  Session session(std::cin, std::cout, std::cerr);
+  run_session(session);
+  return 0;
 }
-
@@ -0,0 +1,375 @@
+#include <cerrno>
+#include <cstring>
+#include "memo_store.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char MEMO_MAGIC[8] = { 'E', 'N', 'G', 'M', 'E', 'M', 'O', '\0' };
+const uint32_t MEMO_FORMAT_VERSION = 1;  // layout of the header and records below
+const uint32_t MEMO_MAX_FIELD = 1 << 24; // longest key or value; a longer length means a torn record
+const int MEMO_OPEN_ATTEMPTS = 4;        // reopens while other processes keep replacing the file
+
+struct MemoFileHeader {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t algorithm_version;
+    uint64_t reserved[2];
+};
+
+// Followed by the key and value bytes, then zeros up to a multiple of 8
+struct MemoRecordHeader {
+    uint32_t key_length;
+    uint32_t value_length;
+    uint64_t checksum;
+};
+
+static inline uint64_t record_size(uint64_t key_length, uint64_t value_length) {
+    return (sizeof(MemoRecordHeader) + key_length + value_length + 7) & ~static_cast<uint64_t>(7);
+}
+
+// FNV-1a, continuing from hash
+static uint64_t hash_bytes(const char* bytes, size_t length, uint64_t hash = 14695981039346656037ull) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= static_cast<unsigned char>(bytes[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t record_checksum(const char* key, uint32_t key_length, const char* value, uint32_t value_length) {
+    uint64_t hash = hash_bytes(key, key_length, hash_bytes(reinterpret_cast<const char*>(&key_length), sizeof(key_length)));
+    return hash_bytes(value, value_length, hash_bytes(reinterpret_cast<const char*>(&value_length), sizeof(value_length), hash));
+}
+
+static bool header_matches(const char* data, uint64_t size, uint32_t algorithm_version) {
+    if (size < sizeof(MemoFileHeader)) {
+        return false;
+    }
+    MemoFileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    return std::memcmp(header.magic, MEMO_MAGIC, sizeof(MEMO_MAGIC)) == 0 &&
+           header.format_version == MEMO_FORMAT_VERSION && header.algorithm_version == algorithm_version;
+}
+
+static bool write_all(int fd, const char* bytes, uint64_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t written = pwrite(fd, bytes, length, static_cast<off_t>(offset));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        length -= written;
+        offset += written;
+    }
+    return true;
+}
+
+MemoStore::~MemoStore() {
+    close();
+}
+
+bool MemoStore::open(const std::string& file, uint32_t version, std::string& error) {
+    close();
+    std::lock_guard<std::mutex> guard(mutex);
+    path = file;
+    algorithm_version = version;
+    lock_fd = ::open((path + ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    return open_file(error);
+}
+
+void MemoStore::close() {
+    std::lock_guard<std::mutex> guard(mutex);
+    close_file();
+    if (lock_fd >= 0) {
+        ::close(lock_fd);
+        lock_fd = -1;
+    }
+}
+
+bool MemoStore::is_open() {
+    std::lock_guard<std::mutex> guard(mutex);
+    return fd >= 0;
+}
+
+bool MemoStore::read_only() {
+    std::lock_guard<std::mutex> guard(mutex);
+    return !writable;
+}
+
+void MemoStore::close_file() {
+    unmap();
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    index.clear();
+    current = false;
+    scanned = 0;
+}
+
+void MemoStore::unmap() {
+    if (data) {
+        munmap(const_cast<char*>(data), mapped);
+    }
+    data = nullptr;
+    mapped = 0;
+}
+
+// Whole-file lock shared by every process writing the store; nested calls only count
+void MemoStore::lock_file() {
+    if (lock_depth++ == 0) {
+        while (flock(lock_fd, LOCK_EX) < 0 && errno == EINTR) {
+        }
+    }
+}
+
+void MemoStore::unlock_file() {
+    if (--lock_depth == 0) {
+        flock(lock_fd, LOCK_UN);
+    }
+}
+
+// Function to (re)open the file at path and index it. A writer replaces a file it can't
+// use (new, foreign or another version) with a fresh store, then opens that.
+bool MemoStore::open_file(std::string& error) {
+    for (int attempt = 0; attempt < MEMO_OPEN_ATTEMPTS; attempt++) {
+        close_file();
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        writable = fd >= 0 && lock_fd >= 0;
+        if (fd < 0) {
+            fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        }
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0 || !remap(info.st_size)) {
+            error = "cannot open " + path + ": " + std::strerror(errno);
+            close_file();
+            return false;
+        }
+        inode = info.st_ino;
+        current = header_matches(data, mapped, algorithm_version);
+        scanned = sizeof(MemoFileHeader);
+        if (current) {
+            scan();
+            return true;
+        }
+        if (!writable) {
+            return true; // stays empty until a writer rebuilds it
+        }
+        lock_file();
+        struct stat now;
+        bool replaced = ::stat(path.c_str(), &now) != 0 || now.st_ino != info.st_ino;
+        bool rebuilt = replaced || rebuild(0);
+        unlock_file();
+        if (!rebuilt) {
+            error = "cannot rebuild " + path + ": " + std::strerror(errno);
+            close_file();
+            return false;
+        }
+    }
+    error = path + " keeps being replaced";
+    close_file();
+    return false;
+}
+
+bool MemoStore::remap(uint64_t size) {
+    if (size == mapped) {
+        return true;
+    }
+    unmap();
+    if (size == 0) {
+        return true;
+    }
+    void* bytes = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (bytes == MAP_FAILED) {
+        return false;
+    }
+    data = static_cast<const char*>(bytes);
+    mapped = size;
+    return true;
+}
+
+// Function to index the records after scanned, stopping at one that is torn or still being written
+void MemoStore::scan() {
+    while (scanned + sizeof(MemoRecordHeader) <= mapped) {
+        const char* record = data + scanned;
+        MemoRecordHeader header;
+        std::memcpy(&header, record, sizeof(header));
+        if (header.key_length > MEMO_MAX_FIELD || header.value_length > MEMO_MAX_FIELD) {
+            break;
+        }
+        uint64_t size = record_size(header.key_length, header.value_length);
+        const char* key = record + sizeof(header);
+        if (scanned + size > mapped ||
+            header.checksum != record_checksum(key, header.key_length, key + header.key_length, header.value_length)) {
+            break;
+        }
+        index.emplace(hash_bytes(key, header.key_length), scanned);
+        scanned += size;
+    }
+}
+
+// Function to catch up with other processes: reopen if the file was replaced, index new
+// records if it grew, and look again at a record that was still being written last time
+bool MemoStore::refresh() {
+    struct stat info;
+    if (::stat(path.c_str(), &info) == 0 && static_cast<uint64_t>(info.st_ino) != inode) {
+        std::string error;
+        return open_file(error);
+    }
+    if (fstat(fd, &info) != 0) {
+        return false;
+    }
+    if (static_cast<uint64_t>(info.st_size) > mapped && !remap(info.st_size)) {
+        close_file();
+        return false;
+    }
+    if (current && scanned < mapped) {
+        scan();
+    }
+    return true;
+}
+
+// Function to write a fresh store holding this version's records before valid_end, and
+// rename it over the old file; the caller holds the file lock
+bool MemoStore::rebuild(uint64_t valid_end) {
+    std::string temporary = path + ".tmp" + std::to_string(getpid());
+    int out = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        return false;
+    }
+    MemoFileHeader header{};
+    std::memcpy(header.magic, MEMO_MAGIC, sizeof(MEMO_MAGIC));
+    header.format_version = MEMO_FORMAT_VERSION;
+    header.algorithm_version = algorithm_version;
+    bool ok = write_all(out, reinterpret_cast<const char*>(&header), sizeof(header), 0);
+    if (ok && current && valid_end > sizeof(header)) {
+        ok = write_all(out, data + sizeof(header), valid_end - sizeof(header), sizeof(header));
+    }
+    ok = ::close(out) == 0 && ok;
+    ok = ok && rename(temporary.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        unlink(temporary.c_str());
+    }
+    return ok;
+}
+
+bool MemoStore::lookup(const std::string& key, uint64_t hash, std::string* value) {
+    auto range = index.equal_range(hash);
+    for (auto entry = range.first; entry != range.second; ++entry) {
+        const char* record = data + entry->second;
+        MemoRecordHeader header;
+        std::memcpy(&header, record, sizeof(header));
+        const char* stored = record + sizeof(header);
+        if (header.key_length == key.size() && std::memcmp(stored, key.data(), key.size()) == 0) {
+            if (value) {
+                value->assign(stored + header.key_length, header.value_length);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MemoStore::find(const std::string& key, std::string& value) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (fd < 0) {
+        return false;
+    }
+    uint64_t hash = hash_bytes(key.data(), key.size());
+    // Another process may have stored it since the last look
+    if ((current && lookup(key, hash, &value)) || (refresh() && current && lookup(key, hash, &value))) {
+        hits++;
+        return true;
+    }
+    misses++;
+    return false;
+}
+
+bool MemoStore::append(const std::string& key, const std::string& value) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (fd < 0 || !writable || key.size() > MEMO_MAX_FIELD || value.size() > MEMO_MAX_FIELD) {
+        return false;
+    }
+    lock_file();
+    bool ok = refresh() && current;
+    if (ok && !lookup(key, hash_bytes(key.data(), key.size()), nullptr)) {
+        // Nobody else writes while we hold the lock and refresh() has just rescanned, so
+        // bytes after the last whole record are what a crashed writer left; keep the whole
+        // records only
+        if (scanned < mapped) {
+            std::string error;
+            ok = rebuild(scanned) && open_file(error) && current;
+        }
+        if (ok) {
+            uint32_t key_length = static_cast<uint32_t>(key.size()), value_length = static_cast<uint32_t>(value.size());
+            MemoRecordHeader header{ key_length, value_length,
+                                     record_checksum(key.data(), key_length, value.data(), value_length) };
+            std::string record(record_size(key_length, value_length), '\0');
+            std::memcpy(&record[0], &header, sizeof(header));
+            std::memcpy(&record[sizeof(header)], key.data(), key_length);
+            std::memcpy(&record[sizeof(header) + key_length], value.data(), value_length);
+            ok = write_all(fd, record.data(), record.size(), mapped);
+            if (ok) {
+                appends++;
+                refresh();
+            }
+        }
+    }
+    unlock_file();
+    return ok;
+}
+
+MemoStoreStats MemoStore::stats() {
+    std::lock_guard<std::mutex> guard(mutex);
+    MemoStoreStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.appends = appends;
+    stats.entries = static_cast<long long>(index.size());
+    stats.bytes = static_cast<long long>(mapped);
+    return stats;
+}
+
+#else
+
+MemoStore::~MemoStore() {
+}
+
+bool MemoStore::open(const std::string&, uint32_t, std::string& error) {
+    error = "the memo store needs mmap";
+    return false;
+}
+
+void MemoStore::close() {
+}
+
+bool MemoStore::is_open() {
+    return false;
+}
+
+bool MemoStore::read_only() {
+    return true;
+}
+
+bool MemoStore::find(const std::string&, std::string&) {
+    return false;
+}
+
+bool MemoStore::append(const std::string&, const std::string&) {
+    return false;
+}
+
+MemoStoreStats MemoStore::stats() {
+    return MemoStoreStats();
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef MEMO_STORE_H
+#define MEMO_STORE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Persistent memo of expensive, deterministic results (normalised query -> result) that
+// survives restarts and is shared by every process pointed at the same file.
+//
+// The file is a header followed by appended records, each a key and value length, a
+// checksum and the bytes. Readers map it read-only and index the records by key hash;
+// when the file grows they map it again and index only the new records. Writers append
+// under an flock on "<file>.lock" and never modify written bytes, so a reader can never
+// see a record change under it.
+//
+// The header carries an algorithm version. A store written by another version (or left
+// with a torn record by a crash) is rebuilt: a writer copies what is still valid into a
+// new file and renames it over the old one, and readers notice the new inode and reopen.
+// Numbers are stored in native byte order, so a store belongs to one architecture.
+
+struct MemoStoreStats {
+    long long hits = 0;
+    long long misses = 0;
+    long long appends = 0;
+    long long entries = 0;
+    long long bytes = 0;    // file size
+};
+
+class MemoStore {
+public:
+    MemoStore() = default;
+    ~MemoStore();
+    MemoStore(const MemoStore&) = delete;
+    MemoStore& operator=(const MemoStore&) = delete;
+
+    // Opens or creates the store; falls back to read-only if the file can't be written.
+    // A store from another algorithm version is rebuilt empty (or, read-only, ignored).
+    bool open(const std::string& path, uint32_t algorithm_version, std::string& error);
+    void close();
+    bool is_open();
+    bool read_only();
+
+    bool find(const std::string& key, std::string& value);
+    // Adds a result unless the key is already stored; false if read-only or the write failed
+    bool append(const std::string& key, const std::string& value);
+    MemoStoreStats stats();
+
+private:
+    bool open_file(std::string& error);
+    void close_file();
+    void lock_file();
+    void unlock_file();
+    bool refresh();
+    bool remap(uint64_t size);
+    void scan();
+    bool rebuild(uint64_t valid_end);
+    bool lookup(const std::string& key, uint64_t hash, std::string* value);
+    void unmap();
+
+    std::mutex mutex;
+    std::string path;
+    uint32_t algorithm_version = 0;
+    int fd = -1;
+    int lock_fd = -1;           // "<file>.lock", flocked by writers
+    int lock_depth = 0;
+    bool writable = false;
+    bool current = false;       // the header matches this algorithm version
+    uint64_t inode = 0;
+    const char* data = nullptr; // the whole file, read-only
+    uint64_t mapped = 0;
+    uint64_t scanned = 0;       // records before this offset are indexed
+    std::unordered_multimap<uint64_t, uint64_t> index; // key hash -> record offset
+    long long hits = 0;
+    long long misses = 0;
+    long long appends = 0;
+};
+
+#endif
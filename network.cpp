@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <cstring>
+#include "network.h"
+#include "si_value.h"
+
+int add_network_resistor(ResistorNetwork& network, double value) {
+    if (!(value >= 0)) {
+        return -1;
+    }
+    network.nodes.push_back({ value, -1, -1, NETWORK_RESISTOR });
+    network.parts++;
+    return static_cast<int>(network.nodes.size()) - 1;
+}
+
+int add_network_combination(ResistorNetwork& network, NetworkNodeKind kind, int left, int right) {
+    int count = static_cast<int>(network.nodes.size());
+    if (kind == NETWORK_RESISTOR || left < 0 || left >= count || right < 0 || right >= count) {
+        return -1;
+    }
+    network.nodes.push_back({ 0, left, right, kind });
+    return count;
+}
+
+double evaluate_network(ResistorNetwork& network) {
+    if (network.root < 0) {
+        return -1;
+    }
+    // Children precede parents, so one pass in index order sees every child first
+    for (NetworkNode& node : network.nodes) {
+        if (node.kind == NETWORK_RESISTOR) {
+            continue;
+        }
+        double a = network.nodes[node.left].value, b = network.nodes[node.right].value;
+        if (node.kind == NETWORK_SERIES) {
+            node.value = a + b;
+        }
+        else {
+            // A zero-ohm branch shorts the pair
+            node.value = (a == 0 || b == 0) ? 0 : a * b / (a + b);
+        }
+    }
+    return network.nodes[network.root].value;
+}
+
+// Function to add a leaf from its text: an SI value or a name
+static bool add_operand(ResistorNetwork& network, const char* start, const char* end,
+                        const std::map<std::string, double>& names, std::string& error) {
+    // Numbers are parsed in place; only names and errors need a string
+    double value;
+    if (!parse_si_value(start, end, value, SI_OHM)) {
+        auto name = names.find(std::string(start, end));
+        if (name == names.end()) {
+            error = "unknown value '" + std::string(start, end) + "'";
+            return false;
+        }
+        value = name->second;
+    }
+    if (add_network_resistor(network, value) < 0) {
+        error = "negative resistance '" + std::string(start, end) + "'";
+        return false;
+    }
+    return true;
+}
+
+static inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static void clear_network(ResistorNetwork& network) {
+    network.nodes.clear();
+    network.root = -1;
+    network.parts = 0;
+}
+
+// Operator precedence for the shunting-yard parser; '(' never reduces
+static inline int precedence(char op) {
+    return op == '|' ? 2 : op == '+' ? 1 : 0;
+}
+
+bool parse_network_expression(const std::string& text, const std::map<std::string, double>& names,
+                              ResistorNetwork& network, std::string& error) {
+    clear_network(network);
+    // Every operator joins two nodes, so the operator characters bound the node count and stack depths
+    size_t operator_chars = std::count_if(text.begin(), text.end(), [](char c) { return c == '+' || c == '|' || c == '('; });
+    network.nodes.reserve(1 + 2 * operator_chars);
+
+    std::vector<int> operands;
+    std::vector<char> operators; // '(', '+' or '|' (for "||")
+    operands.reserve(1 + operator_chars);
+    operators.reserve(operator_chars);
+    auto reduce = [&network, &operands, &operators]() {
+        int right = operands.back();
+        operands.pop_back();
+        int left = operands.back();
+        operands.back() = add_network_combination(network, operators.back() == '+' ? NETWORK_SERIES : NETWORK_PARALLEL,
+                                                  left, right);
+        operators.pop_back();
+    };
+
+    const char* begin = text.c_str();
+    const char* end = begin + text.size();
+    const char* p = begin;
+    auto at = [&p, begin]() {
+        return " at position " + std::to_string(p - begin + 1);
+    };
+    bool expect_operand = true;
+    bool ok = true;
+    while (ok) {
+        while (p < end && is_space(*p)) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+        if (expect_operand) {
+            if (*p == '(') {
+                operators.push_back('(');
+                p++;
+                continue;
+            }
+            // A value runs to the next space, bracket or operator; a '+' right after
+            // the 'e' of a number such as 1e+3 is part of its exponent
+            const char* start = p;
+            while (p < end && !is_space(*p) && *p != '(' && *p != ')' && *p != '|' &&
+                   (*p != '+' || (p - start > 1 && (p[-1] == 'e' || p[-1] == 'E') && p[-2] >= '0' && p[-2] <= '9'))) {
+                p++;
+            }
+            if (p == start) {
+                error = "expected a value" + at();
+                ok = false;
+            }
+            else {
+                ok = add_operand(network, start, p, names, error);
+                operands.push_back(static_cast<int>(network.nodes.size()) - 1);
+                expect_operand = false;
+            }
+        }
+        else if (*p == ')') {
+            while (!operators.empty() && operators.back() != '(') {
+                reduce();
+            }
+            if (operators.empty()) {
+                error = "unmatched ')'" + at();
+                ok = false;
+            }
+            else {
+                operators.pop_back();
+                p++;
+            }
+        }
+        else if (*p == '+' || (*p == '|' && p + 1 < end && p[1] == '|')) {
+            char op = *p;
+            while (!operators.empty() && precedence(operators.back()) >= precedence(op)) {
+                reduce();
+            }
+            operators.push_back(op);
+            p += op == '+' ? 1 : 2;
+            expect_operand = true;
+        }
+        else {
+            error = "expected '+', '||' or ')'" + at();
+            ok = false;
+        }
+    }
+
+    if (ok && expect_operand) {
+        error = operands.empty() && operators.empty() ? "empty expression" : "expression ends without a value";
+        ok = false;
+    }
+    while (ok && !operators.empty()) {
+        if (operators.back() == '(') {
+            error = "unmatched '('";
+            ok = false;
+        }
+        else {
+            reduce();
+        }
+    }
+    if (!ok) {
+        clear_network(network);
+        return false;
+    }
+    network.root = operands.back();
+    return true;
+}
+
+bool parse_network_json(const std::string& text, const std::map<std::string, double>& names,
+                        ResistorNetwork& network, std::string& error) {
+    clear_network(network);
+    network.nodes.reserve(1 + 2 * std::count(text.begin(), text.end(), ','));
+
+    // One frame per open object: its kind and the children folded together so far
+    struct Frame {
+        NetworkNodeKind kind;
+        int folded;
+    };
+    std::vector<Frame> open;
+
+    const char* begin = text.c_str();
+    const char* end = begin + text.size();
+    const char* p = begin;
+    auto skip_space = [&p, end]() {
+        while (p < end && is_space(*p)) {
+            p++;
+        }
+    };
+    auto expect = [&p, &skip_space, end, begin, &error](char c) {
+        skip_space();
+        if (p == end || *p != c) {
+            error = std::string("expected '") + c + "' at position " + std::to_string(p - begin + 1);
+            return false;
+        }
+        p++;
+        return true;
+    };
+
+    bool ok = true;
+    while (ok) {
+        // One array element: an object opens a frame, anything else is a resistor
+        skip_space();
+        if (p == end) {
+            error = "unexpected end of input";
+            ok = false;
+            break;
+        }
+        if (*p == ']') {
+            error = "empty array at position " + std::to_string(p - begin + 1);
+            ok = false;
+            break;
+        }
+        if (*p == '{') {
+            p++;
+            if (!expect('"')) {
+                ok = false;
+                break;
+            }
+            const char* key = p;
+            while (p < end && *p != '"') {
+                p++;
+            }
+            size_t length = p - key;
+            if (p == end) {
+                error = "unterminated key";
+                ok = false;
+                break;
+            }
+            if (length == 6 && std::strncmp(key, "series", 6) == 0) {
+                open.push_back({ NETWORK_SERIES, -1 });
+            }
+            else if (length == 8 && std::strncmp(key, "parallel", 8) == 0) {
+                open.push_back({ NETWORK_PARALLEL, -1 });
+            }
+            else {
+                error = "unknown key '" + std::string(key, length) + "', expected series or parallel";
+                ok = false;
+                break;
+            }
+            p++;
+            ok = expect(':') && expect('[');
+            continue;
+        }
+        const char* start = p;
+        const char* stop;
+        if (*p == '"') {
+            start = ++p;
+            while (p < end && *p != '"') {
+                p++;
+            }
+            stop = p;
+            if (p < end) {
+                p++;
+            }
+        }
+        else {
+            while (p < end && !is_space(*p) && *p != ',' && *p != ']' && *p != '}') {
+                p++;
+            }
+            stop = p;
+        }
+        if (!add_operand(network, start, stop, names, error)) {
+            ok = false;
+            break;
+        }
+        int node = static_cast<int>(network.nodes.size()) - 1;
+
+        // Fold the finished element into its array, closing every array and object it ends
+        for (;;) {
+            if (open.empty()) {
+                network.root = node;
+                skip_space();
+                if (p != end) {
+                    error = "unexpected text after the network at position " + std::to_string(p - begin + 1);
+                    ok = false;
+                }
+                break;
+            }
+            Frame& frame = open.back();
+            frame.folded = frame.folded < 0 ? node : add_network_combination(network, frame.kind, frame.folded, node);
+            skip_space();
+            if (p < end && *p == ',') {
+                p++;
+                break;
+            }
+            if (!expect(']') || !expect('}')) {
+                ok = false;
+                break;
+            }
+            node = frame.folded;
+            open.pop_back();
+        }
+        if (network.root >= 0) {
+            break;
+        }
+    }
+
+    if (!ok) {
+        clear_network(network);
+        return false;
+    }
+    return true;
+}
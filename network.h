@@ -0,0 +1,50 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Series/parallel resistor networks of any size, e.g. "(4k7 + 10k) || (22k + (1M || 470k))"
+// or the JSON tree {"parallel": [{"series": ["4k7", 10e3]}, "22k"]}.
+// Nodes live in one flat vector and refer to each other by index. Both parsers are
+// iterative and every node is added after its children, so evaluation is a single
+// forward pass and a tree with millions of nodes needs no recursion.
+
+enum NetworkNodeKind : unsigned char {
+    NETWORK_RESISTOR,
+    NETWORK_SERIES,
+    NETWORK_PARALLEL
+};
+
+struct NetworkNode {
+    double value; // ohms; set for series/parallel nodes by evaluate_network()
+    int left;     // child indices, -1 for a resistor
+    int right;
+    NetworkNodeKind kind;
+};
+
+struct ResistorNetwork {
+    std::vector<NetworkNode> nodes; // children always come before their parent
+    int root = -1;
+    int parts = 0;                  // resistor count
+};
+
+// Both return the new node's index; -1 for a negative value or a child that doesn't exist yet
+int add_network_resistor(ResistorNetwork& network, double value);
+int add_network_combination(ResistorNetwork& network, NetworkNodeKind kind, int left, int right);
+
+// Values are SI numbers ("4k7", "10M", "220") or names looked up in names (e.g. R1).
+// "||" binds tighter than "+", so "1k + 2k || 2k" is 2k. On failure the network is
+// cleared and error says what went wrong and where.
+bool parse_network_expression(const std::string& text, const std::map<std::string, double>& names,
+                              ResistorNetwork& network, std::string& error);
+// Every object has one key, "series" or "parallel", holding a non-empty array of
+// numbers, value strings or further objects
+bool parse_network_json(const std::string& text, const std::map<std::string, double>& names,
+                        ResistorNetwork& network, std::string& error);
+
+// Equivalent resistance of the root, -1 for an empty network
+double evaluate_network(ResistorNetwork& network);
+
+#endif
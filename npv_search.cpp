@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "npv_search.h"
+#include "calc.h"
+
+// Function to insert a candidate into a ranked list of at most k pairs
+static void keep_best(ResistorPair* best, int& kept, int k, double r1, double r2, double value, double target) {
+    double error = (value - target) / target;
+    if (kept == k && std::abs(error) >= std::abs(best[kept - 1].error)) {
+        return;
+    }
+    int i = (kept < k) ? kept++ : kept - 1;
+    while (i > 0 && std::abs(best[i - 1].error) > std::abs(error)) {
+        best[i] = best[i - 1];
+        i--;
+    }
+    best[i] = { r1, r2, value, error };
+}
+
+// True once a pair with this error can no longer make the ranking
+static bool is_worse(const ResistorPair* best, int kept, int k, double value, double target) {
+    return kept == k && std::abs(value - target) / target >= std::abs(best[kept - 1].error);
+}
+
+// Series pairs: for each r1 the ideal r2 = target - r1 falls as r1 rises, so one pointer
+// sweeps down the table. Around it the error grows monotonically in both directions,
+// so each r1 only walks out until a pair can no longer beat the current k-th best.
+int best_series_pairs(double target, const double* values, int n, int k, ResistorPair* best) {
+    if (target <= 0 || k <= 0 || n <= 0) {
+        return 0;
+    }
+    int kept = 0;
+    int p = n - 1;
+
+    for (int i = 0; i < n; i++) {
+        double r1 = values[i];
+        // r1 <= r2, so every remaining pair is at least 2 * r1
+        if (2 * r1 > target && is_worse(best, kept, k, 2 * r1, target)) {
+            break;
+        }
+        double ideal = target - r1;
+        while (p > 0 && values[p] > ideal) {
+            p--;
+        }
+        // Walk down from the crossing point
+        for (int j = p; j >= i; j--) {
+            double value = r1 + values[j];
+            if (is_worse(best, kept, k, value, target)) {
+                break;
+            }
+            keep_best(best, kept, k, r1, values[j], value, target);
+        }
+        // Walk up from just past the crossing point
+        for (int j = (p + 1 > i) ? p + 1 : i; j < n; j++) {
+            double value = r1 + values[j];
+            if (is_worse(best, kept, k, value, target)) {
+                break;
+            }
+            keep_best(best, kept, k, r1, values[j], value, target);
+        }
+    }
+    return kept;
+}
+
+int best_series_pairs(double target, ESeries series, int k, ResistorPair* best) {
+    int n;
+    const double* values = eseries_values(series, n);
+    return best_series_pairs(target, values, n, k, best);
+}
+
+// Parallel pairs: for r1 > target the ideal r2 = r1 * target / (r1 - target) falls as r1
+// rises, so the same sweep works. With r1 <= target every pair falls short and the best
+// partner is the largest value; those r1 are visited downwards from the target and stop
+// as soon as r1 || largest can no longer make the ranking.
+int best_parallel_pairs(double target, const double* values, int n, int k, ResistorPair* best) {
+    if (target <= 0 || k <= 0 || n <= 0) {
+        return 0;
+    }
+    int kept = 0;
+    int p = n - 1;
+    int first_above = static_cast<int>(std::upper_bound(values, values + n, target) - values);
+
+    for (int i = first_above; i < n; i++) {
+        double r1 = values[i];
+        // r1 <= r2, so every remaining pair is at least r1 / 2
+        if (r1 / 2 > target && is_worse(best, kept, k, r1 / 2, target)) {
+            break;
+        }
+        double ideal = r1 * target / (r1 - target);
+        while (p > 0 && values[p] > ideal) {
+            p--;
+        }
+        for (int j = p; j >= i; j--) {
+            double value = r1 * values[j] / (r1 + values[j]);
+            if (is_worse(best, kept, k, value, target)) {
+                break;
+            }
+            keep_best(best, kept, k, r1, values[j], value, target);
+        }
+        for (int j = (p + 1 > i) ? p + 1 : i; j < n; j++) {
+            double value = r1 * values[j] / (r1 + values[j]);
+            if (is_worse(best, kept, k, value, target)) {
+                break;
+            }
+            keep_best(best, kept, k, r1, values[j], value, target);
+        }
+    }
+
+    double largest = values[n - 1];
+    for (int i = first_above - 1; i >= 0; i--) {
+        double r1 = values[i];
+        if (is_worse(best, kept, k, r1 * largest / (r1 + largest), target)) {
+            break;
+        }
+        for (int j = n - 1; j >= i; j--) {
+            double value = r1 * values[j] / (r1 + values[j]);
+            if (is_worse(best, kept, k, value, target)) {
+                break;
+            }
+            keep_best(best, kept, k, r1, values[j], value, target);
+        }
+    }
+    return kept;
+}
+
+int best_parallel_pairs(double target, ESeries series, int k, ResistorPair* best) {
+    int n;
+    const double* values = eseries_values(series, n);
+    return best_parallel_pairs(target, values, n, k, best);
+}
+
+// Ratio index: every mantissa pair of a series, with the ratio normalised into one decade
+// [1, 10). Any real pair is one of these times a power of ten, so a single sorted table of
+// n * n entries per series answers ratio queries for all decades.
+struct RatioEntry {
+    double log_ratio;      // log10 of the normalised ratio, 0 <= log_ratio < 1
+    short numerator;       // mantissa index
+    short denominator;     // mantissa index
+    short decade_shift;    // 1 when the raw mantissa ratio was below 1
+};
+
+struct RatioIndex {
+    std::vector<RatioEntry> entries;
+
+    explicit RatioIndex(ESeries series) {
+        int n = static_cast<int>(series);
+        const int* mantissas = eseries_mantissas(series);
+        entries.reserve(n * n);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                double log_ratio = std::log10(static_cast<double>(mantissas[i]) / mantissas[j]);
+                short shift = 0;
+                if (log_ratio < 0) {
+                    log_ratio += 1;
+                    shift = 1;
+                }
+                entries.push_back({ log_ratio, static_cast<short>(i), static_cast<short>(j), shift });
+            }
+        }
+        std::sort(entries.begin(), entries.end(),
+            [](const RatioEntry& a, const RatioEntry& b) { return a.log_ratio < b.log_ratio; });
+    }
+};
+
+static const RatioIndex& ratio_index(ESeries series) {
+    static const RatioIndex e6(E6), e12(E12), e24(E24), e48(E48), e96(E96), e192(E192);
+    switch (series) {
+    case E6: return e6;
+    case E12: return e12;
+    case E24: return e24;
+    case E48: return e48;
+    case E96: return e96;
+    default: return e192;
+    }
+}
+
+// Function to place a mantissa pair in real decades, closest to the middle of the window.
+// Returns false if no placement keeps both parts in range.
+static bool place_ratio(ESeries series, const RatioEntry& entry, int decade_difference,
+                        double min_resistance, double max_resistance, ResistorRatio& pair) {
+    int n = static_cast<int>(series);
+    int count;
+    const double* values = eseries_values(series, count);
+    double centre = std::sqrt(min_resistance * max_resistance);
+    bool placed = false;
+    double best_distance = 0;
+
+    for (int den_decade = 0; den_decade < ESERIES_DECADES; den_decade++) {
+        int num_decade = den_decade + decade_difference;
+        if (num_decade < 0 || num_decade >= ESERIES_DECADES) {
+            continue;
+        }
+        double numerator = values[num_decade * n + entry.numerator];
+        double denominator = values[den_decade * n + entry.denominator];
+        if (numerator < min_resistance || numerator > max_resistance ||
+            denominator < min_resistance || denominator > max_resistance) {
+            continue;
+        }
+        double distance = std::abs(std::log(numerator * denominator / (centre * centre)));
+        if (!placed || distance < best_distance) {
+            pair.numerator = numerator;
+            pair.denominator = denominator;
+            best_distance = distance;
+            placed = true;
+        }
+    }
+    return placed;
+}
+
+// Binary search for the target's position in the ratio index, then walk outwards
+// (wrapping round the decade) in order of log error until k pairs fit the window.
+int best_ratio_pairs(double ratio, ESeries series, double min_resistance, double max_resistance, int k, ResistorRatio* best) {
+    if (ratio <= 0 || k <= 0 || min_resistance > max_resistance) {
+        return 0;
+    }
+    const std::vector<RatioEntry>& entries = ratio_index(series).entries;
+    int size = static_cast<int>(entries.size());
+    double log_target = std::log10(ratio);
+    double decade = std::floor(log_target);
+    double fraction = log_target - decade;
+
+    auto position = std::lower_bound(entries.begin(), entries.end(), fraction,
+        [](const RatioEntry& entry, double value) { return entry.log_ratio < value; });
+    int up = static_cast<int>(position - entries.begin()); // first entry >= fraction
+    int down = up - 1;
+    int kept = 0;
+
+    for (int visited = 0; visited < size && kept < k; visited++) {
+        // Distances on the circle of log ratios (the index wraps at one decade)
+        int up_index = ((up % size) + size) % size;
+        int down_index = ((down % size) + size) % size;
+        double up_wrap = std::floor(static_cast<double>(up) / size);
+        double down_wrap = std::floor(static_cast<double>(down) / size);
+        double up_distance = entries[up_index].log_ratio + up_wrap - fraction;
+        double down_distance = fraction - (entries[down_index].log_ratio + down_wrap);
+
+        bool take_up = up_distance <= down_distance;
+        const RatioEntry& entry = take_up ? entries[up_index] : entries[down_index];
+        int wrap = static_cast<int>(take_up ? up_wrap : down_wrap);
+        if (take_up) {
+            up++;
+        }
+        else {
+            down--;
+        }
+
+        // numerator / denominator = normalised ratio * 10^(decade + wrap)
+        int decade_difference = static_cast<int>(decade) + wrap + entry.decade_shift;
+        ResistorRatio pair;
+        if (!place_ratio(series, entry, decade_difference, min_resistance, max_resistance, pair)) {
+            continue;
+        }
+        pair.ratio = pair.numerator / pair.denominator;
+        pair.error = (pair.ratio - ratio) / ratio;
+        best[kept++] = pair;
+    }
+    return kept;
+}
+
+// Function to insert an RC pair into a ranked list of at most k pairs
+static void keep_best_rc(RcPair* best, int& kept, int k, const RcPair& candidate) {
+    if (kept == k && std::abs(candidate.error) >= std::abs(best[kept - 1].error)) {
+        return;
+    }
+    int i = (kept < k) ? kept++ : kept - 1;
+    while (i > 0 && std::abs(best[i - 1].error) > std::abs(candidate.error)) {
+        best[i] = best[i - 1];
+        i--;
+    }
+    best[i] = candidate;
+}
+
+// Capacitor values are indexed in picofarads so they fall inside the E-series table range
+int best_rc_pairs(double cutoff_freq, ESeries r_series, ESeries c_series, double min_r, double max_r,
+                  double min_c, double max_c, int k, RcPair* best) {
+    if (cutoff_freq <= 0 || k <= 0 || min_r > max_r || min_c > max_c) {
+        return 0;
+    }
+    const double pf = 1e-12;
+    int count;
+    const double* capacitors = eseries_values(c_series, count);
+    int first = nearest_preferred_value(min_c / pf, c_series).index;
+    while (first > 0 && capacitors[first - 1] * pf >= min_c) {
+        first--;
+    }
+    int kept = 0;
+
+    for (int i = first; i < count && capacitors[i] * pf <= max_c; i++) {
+        double c = capacitors[i] * pf;
+        if (c < min_c) {
+            continue;
+        }
+        double ideal_r = 1 / (2 * PI * cutoff_freq * c);
+        PreferredValue r = nearest_preferred_value(ideal_r, r_series);
+        double candidates[2] = { r.next_down, r.next_up };
+        for (int j = 0; j < 2; j++) {
+            if ((j == 1 && candidates[1] == candidates[0]) || candidates[j] < min_r || candidates[j] > max_r) {
+                continue;
+            }
+            RcPair pair;
+            pair.r = candidates[j];
+            pair.c = c;
+            pair.cutoff_freq = calculate_cutoff_frequency(pair.r, c);
+            pair.error = (pair.cutoff_freq - cutoff_freq) / cutoff_freq;
+            keep_best_rc(best, kept, k, pair);
+        }
+    }
+    return kept;
+}
+
+// Same walk over arbitrary value lists: the neighbours of the ideal resistor come from a binary search
+int best_rc_pairs(double cutoff_freq, const double* resistors, int r_count, const double* capacitors, int c_count,
+                  double min_r, double max_r, double min_c, double max_c, int k, RcPair* best) {
+    if (cutoff_freq <= 0 || k <= 0 || r_count <= 0 || min_r > max_r || min_c > max_c) {
+        return 0;
+    }
+    int kept = 0;
+    for (const double* c = std::lower_bound(capacitors, capacitors + c_count, min_c); c < capacitors + c_count && *c <= max_c; c++) {
+        double ideal_r = 1 / (2 * PI * cutoff_freq * *c);
+        int up = static_cast<int>(std::lower_bound(resistors, resistors + r_count, ideal_r) - resistors);
+        for (int j = up - 1; j <= up; j++) {
+            if (j < 0 || j >= r_count || resistors[j] < min_r || resistors[j] > max_r) {
+                continue;
+            }
+            RcPair pair;
+            pair.r = resistors[j];
+            pair.c = *c;
+            pair.cutoff_freq = calculate_cutoff_frequency(pair.r, pair.c);
+            pair.error = (pair.cutoff_freq - cutoff_freq) / cutoff_freq;
+            keep_best_rc(best, kept, k, pair);
+        }
+    }
+    return kept;
+}
@@ -0,0 +1,52 @@
+#ifndef NPV_SEARCH_H
+#define NPV_SEARCH_H
+
+#include "eseries.h"
+
+// Searches over preferred value tables: two-resistor series/parallel combinations,
+// resistor ratios and RC filter part pairs. Results go into caller-provided arrays so nothing is allocated per query.
+
+struct ResistorPair {
+    double r1;    // r1 <= r2
+    double r2;
+    double value; // combined resistance
+    double error; // (value - target) / target
+};
+
+// Best k series (r1 + r2) or parallel (r1 || r2) pairs for a target, ranked by |error|.
+// Returns the number of pairs written to best (at most k).
+int best_series_pairs(double target, ESeries series, int k, ResistorPair* best);
+int best_parallel_pairs(double target, ESeries series, int k, ResistorPair* best);
+// Same searches over any ascending list of distinct values, e.g. the resistors in stock
+int best_series_pairs(double target, const double* values, int count, int k, ResistorPair* best);
+int best_parallel_pairs(double target, const double* values, int count, int k, ResistorPair* best);
+
+struct ResistorRatio {
+    double numerator;   // e.g. Rf or RA
+    double denominator; // e.g. Rin or RB
+    double ratio;       // numerator / denominator
+    double error;       // (ratio - target) / target
+};
+
+// Best k preferred-value pairs whose ratio is closest to the target, with both parts
+// inside [min_resistance, max_resistance]. Inverting gain G needs ratio G, non-inverting
+// and Sallen-Key gain G need ratio G - 1. Returns the number of pairs written to best.
+int best_ratio_pairs(double ratio, ESeries series, double min_resistance, double max_resistance, int k, ResistorRatio* best);
+
+struct RcPair {
+    double r;           // ohms
+    double c;           // farads
+    double cutoff_freq; // 1 / (2 pi R C)
+    double error;       // (cutoff_freq - target) / target
+};
+
+// Best k preferred R and C pairs for a first-order RC cutoff frequency, with R in
+// [min_r, max_r] and C in [min_c, max_c] (farads). For each capacitor the ideal resistor
+// is computed and only its two neighbours are checked. Returns the number of pairs written.
+int best_rc_pairs(double cutoff_freq, ESeries r_series, ESeries c_series, double min_r, double max_r,
+                  double min_c, double max_c, int k, RcPair* best);
+// Same search over ascending lists of distinct resistor and capacitor values (farads)
+int best_rc_pairs(double cutoff_freq, const double* resistors, int r_count, const double* capacitors, int c_count,
+                  double min_r, double max_r, double min_c, double max_c, int k, RcPair* best);
+
+#endif
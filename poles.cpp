@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "poles.h"
+
+// Baked tables: ripple (0 = Butterworth), order, sections { gain, factor_low, factor_high, q }
+struct BakedPoleTable {
+    double ripple_db;
+    int order;
+    PolePairData sections[4];
+};
+
+static const double baked_ripples[] = { 0, 0.5, 1, 2, 3 };
+const int BAKED_MAX_ORDER = 8;
+const size_t POLE_MEMO_ENTRIES = 256;  // computed (order, ripple) tables kept at once
+
+// Generated from compute_sections(), one row per order 1..BAKED_MAX_ORDER for each ripple
+static constexpr BakedPoleTable baked_tables[] = {
+    // Butterworth
+    { 0.0, 1, { { 1.000000, 1.000000, 1.000000, 0.000000 } } },
+    { 0.0, 2, { { 1.585786, 1.000000, 1.000000, 0.707107 } } },
+    { 0.0, 3, { { 1.000000, 1.000000, 1.000000, 0.000000 }, { 2.000000, 1.000000, 1.000000, 1.000000 } } },
+    { 0.0, 4, { { 1.152241, 1.000000, 1.000000, 0.541196 }, { 2.234633, 1.000000, 1.000000, 1.306563 } } },
+    { 0.0, 5, { { 1.000000, 1.000000, 1.000000, 0.000000 }, { 1.381966, 1.000000, 1.000000, 0.618034 }, { 2.381966, 1.000000, 1.000000, 1.618034 } } },
+    { 0.0, 6, { { 1.068148, 1.000000, 1.000000, 0.517638 }, { 1.585786, 1.000000, 1.000000, 0.707107 }, { 2.482362, 1.000000, 1.000000, 1.931852 } } },
+    { 0.0, 7, { { 1.000000, 1.000000, 1.000000, 0.000000 }, { 1.198062, 1.000000, 1.000000, 0.554958 }, { 1.753020, 1.000000, 1.000000, 0.801938 }, { 2.554958, 1.000000, 1.000000, 2.246980 } } },
+    { 0.0, 8, { { 1.038429, 1.000000, 1.000000, 0.509796 }, { 1.337061, 1.000000, 1.000000, 0.601345 }, { 1.888860, 1.000000, 1.000000, 0.899976 }, { 2.609819, 1.000000, 1.000000, 2.562915 } } },
+    // 0.5 dB Chebyshev
+    { 0.5, 1, { { 1.000000, 2.862775, 0.349311, 0.000000 } } },
+    { 0.5, 2, { { 1.842219, 1.231342, 0.812122, 0.863721 } } },
+    { 0.5, 3, { { 1.000000, 0.626456, 1.596280, 0.000000 }, { 2.413899, 1.068853, 0.935582, 1.706189 } } },
+    { 0.5, 4, { { 1.581782, 0.597002, 1.675035, 0.705110 }, { 2.659928, 1.031270, 0.969678, 2.940554 } } },
+    { 0.5, 5, { { 1.000000, 0.362320, 2.759994, 0.000000 }, { 2.150963, 0.690483, 1.448261, 1.177806 }, { 2.779976, 1.017735, 0.982574, 4.544963 } } },
+    { 0.5, 6, { { 1.537240, 0.396229, 2.523793, 0.683639 }, { 2.447629, 0.768121, 1.301878, 1.810377 }, { 2.846457, 1.011446, 0.988684, 6.512846 } } },
+    { 0.5, 7, { { 1.000000, 0.256170, 3.903658, 0.000000 }, { 2.083874, 0.503863, 1.984665, 1.091552 }, { 2.611733, 0.822729, 1.215467, 2.575546 }, { 2.886901, 1.008022, 0.992042, 8.841800 } } },
+    { 0.5, 8, { { 1.521967, 0.296736, 3.369997, 0.676575 }, { 2.379143, 0.598874, 1.669800, 1.610677 }, { 2.711456, 0.861007, 1.161430, 3.465670 }, { 2.913276, 1.005948, 0.994087, 11.530794 } } },
+    // 1 dB Chebyshev
+    { 1, 1, { { 1.000000, 1.965227, 0.508847, 0.000000 } } },
+    { 1, 2, { { 1.954544, 1.050005, 0.952376, 0.956520 } } },
+    { 1, 3, { { 1.000000, 0.494171, 2.023593, 0.000000 }, { 2.504391, 0.997098, 1.002910, 2.017720 } } },
+    { 1, 4, { { 1.725381, 0.528581, 1.891857, 0.784548 }, { 2.719026, 0.993230, 1.006817, 3.559044 } } },
+    { 1, 5, { { 1.000000, 0.289493, 3.454311, 0.000000 }, { 2.285097, 0.655208, 1.526232, 1.398792 }, { 2.820029, 0.994140, 1.005894, 5.556441 } } },
+    { 1, 6, { { 1.685713, 0.353139, 2.831749, 0.760869 }, { 2.545045, 0.746806, 1.339035, 2.198018 }, { 2.875058, 0.995355, 1.004666, 8.003691 } } },
+    { 1, 7, { { 1.000000, 0.205414, 4.868210, 0.000000 }, { 2.228951, 0.480052, 2.083107, 1.296934 }, { 2.683129, 0.808366, 1.237063, 3.155862 }, { 2.908246, 0.996333, 1.003680, 10.898657 } } },
+    { 1, 8, { { 1.672053, 0.265068, 3.772613, 0.753042 }, { 2.488879, 0.583832, 1.712823, 1.956486 }, { 2.765593, 0.850613, 1.175623, 4.266077 }, { 2.929778, 0.997066, 1.002943, 14.240451 } } },
+    // 2 dB Chebyshev
+    { 2, 1, { { 1.000000, 1.307560, 0.764783, 0.000000 } } },
+    { 2, 2, { { 2.113985, 0.907227, 1.102260, 1.128649 } } },
+    { 2, 3, { { 1.000000, 0.368911, 2.710682, 0.000000 }, { 2.608095, 0.941326, 1.062331, 2.551637 } } },
+    { 2, 4, { { 1.924094, 0.470711, 2.124448, 0.929449 }, { 2.782319, 0.963678, 1.037691, 4.593876 } } },
+    { 2, 5, { { 1.000000, 0.218308, 4.580677, 0.000000 }, { 2.436649, 0.627017, 1.594854, 1.775093 }, { 2.861731, 0.975790, 1.024810, 7.232258 } } },
+    { 2, 6, { { 1.890855, 0.316111, 3.163446, 0.901595 }, { 2.648415, 0.730027, 1.369813, 2.844262 }, { 2.904412, 0.982828, 1.017472, 10.461582 } } },
+    { 2, 7, { { 1.000000, 0.155340, 6.437500, 0.000000 }, { 2.392621, 0.460853, 2.169889, 1.646417 }, { 2.756991, 0.797114, 1.254526, 4.115081 }, { 2.929973, 0.987226, 1.012939, 14.280155 } } },
+    { 2, 8, { { 1.879369, 0.237699, 4.207008, 0.892355 }, { 2.605159, 0.571925, 1.748480, 2.532665 }, { 2.820902, 0.842486, 1.186964, 5.583523 }, { 2.946488, 0.990141, 1.009957, 18.687289 } } },
+    // 3 dB Chebyshev
+    { 3, 1, { { 1.000000, 1.002377, 0.997628, 0.000000 } } },
+    { 3, 2, { { 2.233536, 0.841396, 1.188501, 1.304693 } } },
+    { 3, 3, { { 1.000000, 0.298620, 3.348735, 0.000000 }, { 2.674018, 0.916064, 1.091626, 3.067657 } } },
+    { 3, 4, { { 2.071058, 0.442696, 2.258885, 1.076494 }, { 2.820752, 0.950309, 1.052290, 5.578868 } } },
+    { 3, 5, { { 1.000000, 0.177530, 5.632842, 0.000000 }, { 2.532174, 0.614010, 1.628637, 2.137546 }, { 2.886593, 0.967484, 1.033609, 8.817776 } } },
+    { 3, 6, { { 2.042457, 0.298001, 3.355690, 1.044340 }, { 2.710827, 0.722369, 1.384333, 3.458134 }, { 2.921753, 0.977154, 1.023380, 12.780102 } } },
+    { 3, 7, { { 1.000000, 0.126485, 7.906053, 0.000000 }, { 2.495693, 0.451944, 2.212662, 1.982918 }, { 2.800852, 0.791997, 1.262631, 5.021388 }, { 2.942741, 0.983099, 1.017192, 17.464491 } } },
+    { 3, 8, { { 2.032558, 0.224263, 4.459049, 1.033654 }, { 2.675305, 0.566473, 1.765308, 3.079813 }, { 2.853482, 0.838794, 1.192188, 6.825080 }, { 2.956275, 0.987002, 1.013169, 22.870402 } } }
+};
+
+// Function to work out the sections from the Chebyshev pole locations
+// Pole k sits at -sinh(a) sin(t) +/- j cosh(a) cos(t), t = (2k - 1) pi / 2n, a = asinh(1/eps) / n;
+// Butterworth is the limit sinh(a) = cosh(a) = 1. Frequencies are relative to the cutoff
+// (the ripple band edge for Chebyshev, the -3 dB point for Butterworth).
+static int compute_sections(int order, double ripple_db, PolePairData* sections) {
+    double sinh_a = 1, cosh_a = 1;
+    if (ripple_db > 0) {
+        double epsilon = std::sqrt(std::pow(10.0, ripple_db / 10) - 1);
+        double a = std::asinh(1 / epsilon) / order;
+        sinh_a = std::sinh(a);
+        cosh_a = std::cosh(a);
+    }
+
+    // Lowest Q first: the real pole, then the pairs from the one nearest the real axis
+    int count = 0;
+    if (order % 2 == 1) {
+        sections[count++] = { 1, sinh_a, 1 / sinh_a, 0 };
+    }
+    for (int k = order / 2; k >= 1; k--) {
+        double angle = (2 * k - 1) * PI / (2 * order);
+        double sigma = sinh_a * std::sin(angle);
+        double omega = cosh_a * std::cos(angle);
+        double w0 = std::sqrt(sigma * sigma + omega * omega);
+        double q = w0 / (2 * sigma);
+        sections[count++] = { 3 - 1 / q, w0, 1 / w0, q };
+    }
+    return count;
+}
+
+double family_ripple(FilterFamily family) {
+    switch (family) {
+    case CHEBYSHEV_0_5DB:
+        return 0.5;
+    case CHEBYSHEV_2DB:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+int filter_sections(int order, double ripple_db, PolePairData* sections) {
+    if (order < 1 || order > MAX_FILTER_ORDER || !(ripple_db >= 0 && ripple_db <= MAX_RIPPLE_DB)) {
+        return 0;
+    }
+    int count = (order + 1) / 2;
+
+    if (order <= BAKED_MAX_ORDER) {
+        for (size_t i = 0; i < sizeof(baked_ripples) / sizeof(baked_ripples[0]); i++) {
+            if (baked_ripples[i] == ripple_db) {
+                const BakedPoleTable& table = baked_tables[i * BAKED_MAX_ORDER + order - 1];
+                std::copy(table.sections, table.sections + count, sections);
+                return count;
+            }
+        }
+    }
+
+    // Everything else is computed once per (order, ripple) and kept for later calls. The
+    // ripple comes from request text, so the memo is emptied when it fills up
+    static std::mutex cache_lock;
+    static std::map<std::pair<int, double>, std::vector<PolePairData>> cache;
+    std::lock_guard<std::mutex> guard(cache_lock);
+    std::pair<int, double> key(order, ripple_db);
+    if (cache.size() >= POLE_MEMO_ENTRIES && cache.find(key) == cache.end()) {
+        cache.clear();
+    }
+    std::vector<PolePairData>& cached = cache[key];
+    if (cached.empty()) {
+        cached.resize(count);
+        compute_sections(order, ripple_db, cached.data());
+    }
+    std::copy(cached.begin(), cached.end(), sections);
+    return count;
+}
@@ -0,0 +1,24 @@
+#ifndef POLES_H
+#define POLES_H
+
+#include "calc.h"
+
+// Butterworth and Chebyshev (type I) pole tables for any order and passband ripple.
+// Each entry is one Sallen-Key section of the equal-component circuit: a pole pair with
+// gain K = 3 - 1/Q, or for odd orders one first-order RC section (gain 1, q = 0).
+// Sections are listed in order of rising Q. The common cases are baked into constexpr
+// tables; anything else is worked out from the pole locations, and the most recent
+// (order, ripple) pairs are memoised.
+
+// Largest Chebyshev passband ripple in dB; beyond it the high-Q sections need a gain
+// too close to 3 to build
+const double MAX_RIPPLE_DB = 10;
+
+// Passband ripple of a menu family in dB, 0 for Butterworth
+double family_ripple(FilterFamily family);
+
+// Fills one entry per section and returns the number of sections
+// (0 for an order outside 1..MAX_FILTER_ORDER or a ripple outside 0..MAX_RIPPLE_DB)
+int filter_sections(int order, double ripple_db, PolePairData* sections);
+
+#endif
@@ -0,0 +1,386 @@
+#include <cmath>
+#include "poles.h"
+#include "response.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RESPONSE_X86 1
+#include <immintrin.h>
+#endif
+
+bool add_biquad_stage(StageSet& stages, double b0, double b1, double b2, double a0, double a1, double a2) {
+    if (stages.num_stages >= MAX_RESPONSE_STAGES) {
+        return false;
+    }
+    int i = stages.num_stages++;
+    stages.b0[i] = b0;
+    stages.b1[i] = b1;
+    stages.b2[i] = b2;
+    stages.a0[i] = a0;
+    stages.a1[i] = a1;
+    stages.a2[i] = a2;
+    return true;
+}
+
+// RC low-pass 1 / (1 + sRC), high-pass sRC / (1 + sRC)
+bool add_rc_stage(StageSet& stages, double r, double c, bool high_pass) {
+    double tau = r * c;
+    if (high_pass) {
+        return add_biquad_stage(stages, 0, tau, 0, 1, tau, 0);
+    }
+    return add_biquad_stage(stages, 1, 0, 0, 1, tau, 0);
+}
+
+// Sallen-Key low-pass K / (1 + s/(w0 Q) + s^2/w0^2), high-pass K s^2/w0^2 / (same)
+bool add_sallen_key_stage(StageSet& stages, double f0, double q, double gain, bool high_pass) {
+    double w0 = 2 * PI * f0;
+    if (q == 0) {
+        double tau = 1 / w0;
+        return high_pass ? add_biquad_stage(stages, 0, gain * tau, 0, 1, tau, 0)
+                         : add_biquad_stage(stages, gain, 0, 0, 1, tau, 0);
+    }
+    double a2 = 1 / (w0 * w0);
+    double a1 = 1 / (w0 * q);
+    return high_pass ? add_biquad_stage(stages, 0, 0, gain * a2, 1, a1, a2)
+                     : add_biquad_stage(stages, gain, 0, 0, 1, a1, a2);
+}
+
+StageSet ideal_filter_stages(int order, double ripple_db, double cutoff_freq, bool high_pass) {
+    StageSet stages;
+    PolePairData sections[MAX_POLE_PAIRS];
+    int count = filter_sections(order, ripple_db, sections);
+    for (int i = 0; i < count; i++) {
+        double factor = high_pass ? sections[i].factor_high : sections[i].factor_low;
+        add_sallen_key_stage(stages, cutoff_freq * factor, sections[i].q, sections[i].gain, high_pass);
+    }
+    return stages;
+}
+
+StageSet cascade_stages(const CascadeDesign& design, bool high_pass) {
+    StageSet stages;
+    for (int i = 0; i < design.num_stages; i++) {
+        const CascadeStage& stage = design.stages[i];
+        double gain = stage.rb > 0 ? 1 + stage.ra / stage.rb : 1;
+        add_sallen_key_stage(stages, stage.achieved_freq, stage.achieved_q, gain, high_pass);
+    }
+    return stages;
+}
+
+void log_frequencies(double start, double stop, int num_points, double* freq) {
+    if (num_points == 1) {
+        freq[0] = start;
+        return;
+    }
+    double log_start = std::log(start);
+    double step = (std::log(stop) - log_start) / (num_points - 1);
+    for (int i = 0; i < num_points; i++) {
+        freq[i] = std::exp(log_start + step * i);
+    }
+}
+
+// Kernels: for points [begin, end) write |H| in dB, arg H in degrees (wrapped to
+// +/-180) and the group delay into gd (if not null). Per stage, with N = Nr + jNi and
+// D = Dr + jDi at s = jw, H = N conj(D) / |D|^2 and the group delay adds
+// d(arg D)/dw - d(arg N)/dw, where d(arg(R + jI))/dw = (R I' - I R') / (R^2 + I^2).
+// The vector kernels use their own log and atan2 (series after range reduction,
+// accurate to about 1e-11), since libm has no vector versions to call portably.
+
+const double DB_PER_LOG = 10 / 2.302585092994045684; // 10 log10(x) = DB_PER_LOG ln(x)
+const double DEG_PER_RAD = 180 / PI;
+
+static void sweep_scalar(const StageSet& stages, const double* freq, int begin, int end,
+                         double* magnitude_db, double* phase_deg, double* gd) {
+    for (int p = begin; p < end; p++) {
+        double w = 2 * PI * freq[p];
+        double w2 = w * w;
+        double hr = 1, hi = 0, delay = 0;
+        for (int i = 0; i < stages.num_stages; i++) {
+            double nr = stages.b0[i] - stages.b2[i] * w2;
+            double ni = stages.b1[i] * w;
+            double dr = stages.a0[i] - stages.a2[i] * w2;
+            double di = stages.a1[i] * w;
+            double inv_d = 1 / (dr * dr + di * di);
+            double n_mag = nr * nr + ni * ni;
+            delay += (dr * stages.a1[i] + di * 2 * stages.a2[i] * w) * inv_d;
+            if (n_mag > 0) {
+                delay -= (nr * stages.b1[i] + ni * 2 * stages.b2[i] * w) / n_mag;
+            }
+            double sr = (nr * dr + ni * di) * inv_d;
+            double si = (ni * dr - nr * di) * inv_d;
+            double next_r = hr * sr - hi * si;
+            hi = hr * si + hi * sr;
+            hr = next_r;
+        }
+        magnitude_db[p] = DB_PER_LOG * std::log(hr * hr + hi * hi);
+        phase_deg[p] = DEG_PER_RAD * std::atan2(hi, hr);
+        if (gd) {
+            gd[p] = delay;
+        }
+    }
+}
+
+#ifdef RESPONSE_X86
+// ln x for x > 0: x = 2^e m with m in [sqrt(1/2), sqrt(2)), ln m = 2 atanh(z), z = (m - 1) / (m + 1)
+__attribute__((target("avx2,fma")))
+static inline __m256d log_avx2(__m256d x) {
+    const __m256d one = _mm256_set1_pd(1);
+    __m256i bits = _mm256_castpd_si256(x);
+    // Exponent field to double via the 2^52 trick, AVX2 has no int64 conversion
+    __m256i exponent_bits = _mm256_or_si256(_mm256_srli_epi64(bits, 52), _mm256_set1_epi64x(0x4330000000000000LL));
+    __m256d exponent = _mm256_sub_pd(_mm256_castsi256_pd(exponent_bits), _mm256_set1_pd(4503599627370496.0 + 1023));
+    __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                                    _mm256_set1_epi64x(0x3FF0000000000000LL)));
+    __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+    exponent = _mm256_add_pd(exponent, _mm256_and_pd(big, one));
+
+    __m256d z = _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+    __m256d z2 = _mm256_mul_pd(z, z);
+    __m256d series = _mm256_set1_pd(1.0 / 15);
+    for (int k = 13; k >= 1; k -= 2) {
+        series = _mm256_fmadd_pd(series, z2, _mm256_set1_pd(1.0 / k));
+    }
+    __m256d result = _mm256_fmadd_pd(exponent, _mm256_set1_pd(0.6931471805599453094),
+                                     _mm256_mul_pd(_mm256_add_pd(z, z), series));
+    __m256d is_zero = _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_LE_OQ);
+    return _mm256_blendv_pd(result, _mm256_set1_pd(-HUGE_VAL), is_zero);
+}
+
+// atan2(y, x): atan of t = min/max in [0, 1], folded to |u| <= tan(pi/8) with
+// atan t = pi/4 + atan((t - 1) / (t + 1)), then mapped back to the right quadrant
+__attribute__((target("avx2,fma")))
+static inline __m256d atan2_avx2(__m256d y, __m256d x) {
+    const __m256d one = _mm256_set1_pd(1);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d sign_mask = _mm256_set1_pd(-0.0);
+    __m256d ax = _mm256_andnot_pd(sign_mask, x);
+    __m256d ay = _mm256_andnot_pd(sign_mask, y);
+    __m256d big = _mm256_max_pd(ax, ay);
+    __m256d t = _mm256_div_pd(_mm256_min_pd(ax, ay), _mm256_blendv_pd(big, one, _mm256_cmp_pd(big, zero, _CMP_EQ_OQ)));
+
+    __m256d fold = _mm256_cmp_pd(t, _mm256_set1_pd(0.41421356237309503), _CMP_GT_OQ);
+    __m256d u = _mm256_blendv_pd(t, _mm256_div_pd(_mm256_sub_pd(t, one), _mm256_add_pd(t, one)), fold);
+    __m256d u2 = _mm256_mul_pd(u, u);
+    __m256d series = _mm256_set1_pd(1.0 / 25);
+    for (int k = 23; k >= 1; k -= 2) {
+        series = _mm256_fmadd_pd(series, u2, _mm256_set1_pd((k % 4 == 1 ? 1.0 : -1.0) / k));
+    }
+    __m256d angle = _mm256_add_pd(_mm256_mul_pd(u, series), _mm256_and_pd(fold, _mm256_set1_pd(PI / 4)));
+
+    angle = _mm256_blendv_pd(angle, _mm256_sub_pd(_mm256_set1_pd(PI / 2), angle), _mm256_cmp_pd(ay, ax, _CMP_GT_OQ));
+    angle = _mm256_blendv_pd(angle, _mm256_sub_pd(_mm256_set1_pd(PI), angle), _mm256_cmp_pd(x, zero, _CMP_LT_OQ));
+    return _mm256_or_pd(angle, _mm256_and_pd(sign_mask, y));
+}
+
+__attribute__((target("avx2,fma")))
+static int sweep_avx2(const StageSet& stages, const double* freq, int num_points,
+                      double* magnitude_db, double* phase_deg, double* gd) {
+    const __m256d two_pi = _mm256_set1_pd(2 * PI);
+    const __m256d one = _mm256_set1_pd(1);
+    const __m256d two = _mm256_set1_pd(2);
+    const __m256d zero = _mm256_setzero_pd();
+    int p = 0;
+    for (; p + 4 <= num_points; p += 4) {
+        __m256d w = _mm256_mul_pd(two_pi, _mm256_loadu_pd(freq + p));
+        __m256d w2 = _mm256_mul_pd(w, w);
+        __m256d hr = one, hi = zero, delay = zero;
+        for (int i = 0; i < stages.num_stages; i++) {
+            __m256d b0 = _mm256_set1_pd(stages.b0[i]), b1 = _mm256_set1_pd(stages.b1[i]);
+            __m256d b2 = _mm256_set1_pd(stages.b2[i]), a0 = _mm256_set1_pd(stages.a0[i]);
+            __m256d a1 = _mm256_set1_pd(stages.a1[i]), a2 = _mm256_set1_pd(stages.a2[i]);
+            __m256d nr = _mm256_fnmadd_pd(b2, w2, b0);
+            __m256d ni = _mm256_mul_pd(b1, w);
+            __m256d dr = _mm256_fnmadd_pd(a2, w2, a0);
+            __m256d di = _mm256_mul_pd(a1, w);
+            __m256d inv_d = _mm256_div_pd(one, _mm256_fmadd_pd(dr, dr, _mm256_mul_pd(di, di)));
+            __m256d n_mag = _mm256_fmadd_pd(nr, nr, _mm256_mul_pd(ni, ni));
+
+            __m256d d_slope = _mm256_fmadd_pd(dr, a1, _mm256_mul_pd(di, _mm256_mul_pd(two, _mm256_mul_pd(a2, w))));
+            delay = _mm256_fmadd_pd(d_slope, inv_d, delay);
+            __m256d n_slope = _mm256_fmadd_pd(nr, b1, _mm256_mul_pd(ni, _mm256_mul_pd(two, _mm256_mul_pd(b2, w))));
+            __m256d has_n = _mm256_cmp_pd(n_mag, zero, _CMP_GT_OQ);
+            __m256d n_term = _mm256_div_pd(n_slope, _mm256_blendv_pd(one, n_mag, has_n));
+            delay = _mm256_sub_pd(delay, _mm256_and_pd(n_term, has_n));
+
+            __m256d sr = _mm256_mul_pd(_mm256_fmadd_pd(nr, dr, _mm256_mul_pd(ni, di)), inv_d);
+            __m256d si = _mm256_mul_pd(_mm256_fmsub_pd(ni, dr, _mm256_mul_pd(nr, di)), inv_d);
+            __m256d next_r = _mm256_fmsub_pd(hr, sr, _mm256_mul_pd(hi, si));
+            hi = _mm256_fmadd_pd(hr, si, _mm256_mul_pd(hi, sr));
+            hr = next_r;
+        }
+        __m256d mag = _mm256_fmadd_pd(hr, hr, _mm256_mul_pd(hi, hi));
+        _mm256_storeu_pd(magnitude_db + p, _mm256_mul_pd(_mm256_set1_pd(DB_PER_LOG), log_avx2(mag)));
+        _mm256_storeu_pd(phase_deg + p, _mm256_mul_pd(_mm256_set1_pd(DEG_PER_RAD), atan2_avx2(hi, hr)));
+        if (gd) {
+            _mm256_storeu_pd(gd + p, delay);
+        }
+    }
+    return p;
+}
+
+// Same maths as log_avx2, with getexp/getmant doing the split. The AVX-512 helpers
+// use the all-lanes maskz forms, as GCC warns about the plain forms' undefined source.
+const __mmask8 ALL_LANES = 0xFF;
+
+__attribute__((target("avx512f")))
+static inline __m512d log_avx512(__m512d x) {
+    const __m512d one = _mm512_set1_pd(1);
+    __m512d exponent = _mm512_maskz_getexp_pd(ALL_LANES, x);
+    __m512d m = _mm512_maskz_getmant_pd(ALL_LANES, x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero);
+    __mmask8 big = _mm512_cmp_pd_mask(m, _mm512_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+    m = _mm512_mask_mul_pd(m, big, m, _mm512_set1_pd(0.5));
+    exponent = _mm512_mask_add_pd(exponent, big, exponent, one);
+
+    __m512d z = _mm512_div_pd(_mm512_sub_pd(m, one), _mm512_add_pd(m, one));
+    __m512d z2 = _mm512_mul_pd(z, z);
+    __m512d series = _mm512_set1_pd(1.0 / 15);
+    for (int k = 13; k >= 1; k -= 2) {
+        series = _mm512_fmadd_pd(series, z2, _mm512_set1_pd(1.0 / k));
+    }
+    __m512d result = _mm512_fmadd_pd(exponent, _mm512_set1_pd(0.6931471805599453094),
+                                     _mm512_mul_pd(_mm512_add_pd(z, z), series));
+    __mmask8 is_zero = _mm512_cmp_pd_mask(x, _mm512_setzero_pd(), _CMP_LE_OQ);
+    return _mm512_mask_blend_pd(is_zero, result, _mm512_set1_pd(-HUGE_VAL));
+}
+
+// Same maths as atan2_avx2
+__attribute__((target("avx512f")))
+static inline __m512d atan2_avx512(__m512d y, __m512d x) {
+    const __m512d one = _mm512_set1_pd(1);
+    const __m512d zero = _mm512_setzero_pd();
+    __m512d ax = _mm512_abs_pd(x);
+    __m512d ay = _mm512_abs_pd(y);
+    __m512d big = _mm512_maskz_max_pd(ALL_LANES, ax, ay);
+    __m512d t = _mm512_div_pd(_mm512_maskz_min_pd(ALL_LANES, ax, ay), _mm512_mask_blend_pd(_mm512_cmp_pd_mask(big, zero, _CMP_EQ_OQ), big, one));
+
+    __mmask8 fold = _mm512_cmp_pd_mask(t, _mm512_set1_pd(0.41421356237309503), _CMP_GT_OQ);
+    __m512d u = _mm512_mask_div_pd(t, fold, _mm512_sub_pd(t, one), _mm512_add_pd(t, one));
+    __m512d u2 = _mm512_mul_pd(u, u);
+    __m512d series = _mm512_set1_pd(1.0 / 25);
+    for (int k = 23; k >= 1; k -= 2) {
+        series = _mm512_fmadd_pd(series, u2, _mm512_set1_pd((k % 4 == 1 ? 1.0 : -1.0) / k));
+    }
+    __m512d angle = _mm512_mul_pd(u, series);
+    angle = _mm512_mask_add_pd(angle, fold, angle, _mm512_set1_pd(PI / 4));
+
+    angle = _mm512_mask_sub_pd(angle, _mm512_cmp_pd_mask(ay, ax, _CMP_GT_OQ), _mm512_set1_pd(PI / 2), angle);
+    angle = _mm512_mask_sub_pd(angle, _mm512_cmp_pd_mask(x, zero, _CMP_LT_OQ), _mm512_set1_pd(PI), angle);
+    __mmask8 negative = _mm512_cmp_pd_mask(y, zero, _CMP_LT_OQ);
+    return _mm512_mask_sub_pd(angle, negative, zero, angle);
+}
+
+__attribute__((target("avx512f")))
+static int sweep_avx512(const StageSet& stages, const double* freq, int num_points,
+                        double* magnitude_db, double* phase_deg, double* gd) {
+    const __m512d two_pi = _mm512_set1_pd(2 * PI);
+    const __m512d one = _mm512_set1_pd(1);
+    const __m512d two = _mm512_set1_pd(2);
+    const __m512d zero = _mm512_setzero_pd();
+    int p = 0;
+    for (; p + 8 <= num_points; p += 8) {
+        __m512d w = _mm512_mul_pd(two_pi, _mm512_loadu_pd(freq + p));
+        __m512d w2 = _mm512_mul_pd(w, w);
+        __m512d hr = one, hi = zero, delay = zero;
+        for (int i = 0; i < stages.num_stages; i++) {
+            __m512d b0 = _mm512_set1_pd(stages.b0[i]), b1 = _mm512_set1_pd(stages.b1[i]);
+            __m512d b2 = _mm512_set1_pd(stages.b2[i]), a0 = _mm512_set1_pd(stages.a0[i]);
+            __m512d a1 = _mm512_set1_pd(stages.a1[i]), a2 = _mm512_set1_pd(stages.a2[i]);
+            __m512d nr = _mm512_fnmadd_pd(b2, w2, b0);
+            __m512d ni = _mm512_mul_pd(b1, w);
+            __m512d dr = _mm512_fnmadd_pd(a2, w2, a0);
+            __m512d di = _mm512_mul_pd(a1, w);
+            __m512d inv_d = _mm512_div_pd(one, _mm512_fmadd_pd(dr, dr, _mm512_mul_pd(di, di)));
+            __m512d n_mag = _mm512_fmadd_pd(nr, nr, _mm512_mul_pd(ni, ni));
+
+            __m512d d_slope = _mm512_fmadd_pd(dr, a1, _mm512_mul_pd(di, _mm512_mul_pd(two, _mm512_mul_pd(a2, w))));
+            delay = _mm512_fmadd_pd(d_slope, inv_d, delay);
+            __m512d n_slope = _mm512_fmadd_pd(nr, b1, _mm512_mul_pd(ni, _mm512_mul_pd(two, _mm512_mul_pd(b2, w))));
+            __mmask8 has_n = _mm512_cmp_pd_mask(n_mag, zero, _CMP_GT_OQ);
+            delay = _mm512_mask_sub_pd(delay, has_n, delay, _mm512_div_pd(n_slope, _mm512_mask_blend_pd(has_n, one, n_mag)));
+
+            __m512d sr = _mm512_mul_pd(_mm512_fmadd_pd(nr, dr, _mm512_mul_pd(ni, di)), inv_d);
+            __m512d si = _mm512_mul_pd(_mm512_fmsub_pd(ni, dr, _mm512_mul_pd(nr, di)), inv_d);
+            __m512d next_r = _mm512_fmsub_pd(hr, sr, _mm512_mul_pd(hi, si));
+            hi = _mm512_fmadd_pd(hr, si, _mm512_mul_pd(hi, sr));
+            hr = next_r;
+        }
+        __m512d mag = _mm512_fmadd_pd(hr, hr, _mm512_mul_pd(hi, hi));
+        _mm512_storeu_pd(magnitude_db + p, _mm512_mul_pd(_mm512_set1_pd(DB_PER_LOG), log_avx512(mag)));
+        _mm512_storeu_pd(phase_deg + p, _mm512_mul_pd(_mm512_set1_pd(DEG_PER_RAD), atan2_avx512(hi, hr)));
+        if (gd) {
+            _mm512_storeu_pd(gd + p, delay);
+        }
+    }
+    return p;
+}
+#endif
+
+enum SweepKernel { KERNEL_SCALAR, KERNEL_AVX2, KERNEL_AVX512 };
+
+// Function to pick the widest kernel this CPU runs, checked once
+static SweepKernel sweep_kernel() {
+#ifdef RESPONSE_X86
+    static const SweepKernel kernel = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return KERNEL_AVX512;
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return KERNEL_AVX2;
+        }
+        return KERNEL_SCALAR;
+    }();
+    return kernel;
+#else
+    return KERNEL_SCALAR;
+#endif
+}
+
+const char* sweep_kernel_name() {
+    static const char* const names[] = { "scalar", "avx2", "avx512" };
+    return names[sweep_kernel()];
+}
+
+// Function to find the exact phase of the cascade at one frequency, stage by stage
+static double stage_phase_sum(const StageSet& stages, double f) {
+    double w = 2 * PI * f;
+    double phase = 0;
+    for (int i = 0; i < stages.num_stages; i++) {
+        phase += std::atan2(stages.b1[i] * w, stages.b0[i] - stages.b2[i] * w * w);
+        phase -= std::atan2(stages.a1[i] * w, stages.a0[i] - stages.a2[i] * w * w);
+    }
+    return phase * DEG_PER_RAD;
+}
+
+void sweep_response(const StageSet& stages, const double* freq, int num_points,
+                    double* magnitude_db, double* phase_deg, double* group_delay) {
+    if (num_points <= 0) {
+        return;
+    }
+    int done = 0;
+#ifdef RESPONSE_X86
+    switch (sweep_kernel()) {
+    case KERNEL_AVX512:
+        done = sweep_avx512(stages, freq, num_points, magnitude_db, phase_deg, group_delay);
+        break;
+    case KERNEL_AVX2:
+        done = sweep_avx2(stages, freq, num_points, magnitude_db, phase_deg, group_delay);
+        break;
+    default:
+        break;
+    }
+#endif
+    sweep_scalar(stages, freq, done, num_points, magnitude_db, phase_deg, group_delay);
+
+    // The kernels only give the phase modulo 360 degrees, so each point takes the branch
+    // nearest the previous one, starting from the exact stage-by-stage phase. The jump
+    // count depends only on neighbouring wrapped values, so the loop carries just a sum.
+    double offset = 360 * std::round((stage_phase_sum(stages, freq[0]) - phase_deg[0]) / 360);
+    double wrapped_previous = phase_deg[0];
+    phase_deg[0] += offset;
+    for (int p = 1; p < num_points; p++) {
+        double wrapped = phase_deg[p];
+        offset += 360 * std::round((wrapped_previous - wrapped) / 360);
+        wrapped_previous = wrapped;
+        phase_deg[p] = wrapped + offset;
+    }
+}
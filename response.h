@@ -0,0 +1,46 @@
+#ifndef RESPONSE_H
+#define RESPONSE_H
+
+#include "calc.h"
+#include "filter_design.h"
+
+// Frequency response of cascaded analog filter stages.
+// Stages are held as structure-of-arrays biquads H(s) = (b2 s^2 + b1 s + b0) / (a2 s^2 + a1 s + a0)
+// (first-order stages have a2 = b2 = 0). A sweep walks the frequency points with the widest
+// vector kernel the CPU supports (AVX-512, AVX2 or scalar, picked once at run time) and
+// writes magnitude, phase and group delay into caller-provided arrays without allocating.
+
+const int MAX_RESPONSE_STAGES = 2 * MAX_POLE_PAIRS;
+
+struct StageSet {
+    int num_stages = 0;
+    double b0[MAX_RESPONSE_STAGES];
+    double b1[MAX_RESPONSE_STAGES];
+    double b2[MAX_RESPONSE_STAGES];
+    double a0[MAX_RESPONSE_STAGES];
+    double a1[MAX_RESPONSE_STAGES];
+    double a2[MAX_RESPONSE_STAGES];
+};
+
+// Stage builders, each returns false once the set is full
+bool add_biquad_stage(StageSet& stages, double b0, double b1, double b2, double a0, double a1, double a2);
+bool add_rc_stage(StageSet& stages, double r, double c, bool high_pass);
+// Equal-component Sallen-Key stage with gain K; q = 0 gives a first-order section
+bool add_sallen_key_stage(StageSet& stages, double f0, double q, double gain, bool high_pass);
+
+// Whole filters: the ideal pole table response, or a cascade of chosen parts
+StageSet ideal_filter_stages(int order, double ripple_db, double cutoff_freq, bool high_pass);
+StageSet cascade_stages(const CascadeDesign& design, bool high_pass);
+
+// num_points frequencies spaced evenly on a log scale from start to stop (inclusive)
+void log_frequencies(double start, double stop, int num_points, double* freq);
+
+// Magnitude in dB, phase in degrees and group delay in seconds at each frequency.
+// Phase is unwrapped from point to point, so freq must be ascending. group_delay may be null.
+void sweep_response(const StageSet& stages, const double* freq, int num_points,
+                    double* magnitude_db, double* phase_deg, double* group_delay);
+
+// Kernel chosen for this CPU: "avx512", "avx2" or "scalar"
+const char* sweep_kernel_name();
+
+#endif
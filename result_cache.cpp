@@ -0,0 +1,95 @@
+#include <functional>
+#include "result_cache.h"
+
+const size_t RESULT_CACHE_ENTRY_BYTES = 96; // list node, index slot and string headers of one entry
+
+static inline size_t entry_bytes(const std::string& key, const std::string& value) {
+    return key.size() + value.size() + RESULT_CACHE_ENTRY_BYTES;
+}
+
+ResultCache::ResultCache(size_t capacity_bytes) {
+    set_capacity(capacity_bytes);
+}
+
+ResultCache::Shard& ResultCache::shard_of(const std::string& key) {
+    // The index rehashes with the low bits, so pick the shard with the high ones
+    size_t hash = std::hash<std::string_view>()(key);
+    return shards[(hash >> (8 * sizeof(size_t) - 8)) % RESULT_CACHE_SHARDS];
+}
+
+// Function to drop least recently used entries until the shard holds at most bytes
+void ResultCache::evict_to(Shard& shard, size_t bytes) {
+    while (shard.bytes > bytes && !shard.entries.empty()) {
+        Entry& oldest = shard.entries.back();
+        shard.bytes -= entry_bytes(oldest.key, oldest.value);
+        shard.index.erase(oldest.key);
+        shard.entries.pop_back();
+        shard.evictions++;
+    }
+}
+
+bool ResultCache::find(const std::string& key, std::string& value) {
+    Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+        shard.misses++;
+        return false;
+    }
+    shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+    value = found->second->value;
+    shard.hits++;
+    return true;
+}
+
+void ResultCache::insert(const std::string& key, const std::string& value) {
+    Shard& shard = shard_of(key);
+    size_t bytes = entry_bytes(key, value);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    // One entry may take at most a quarter of its shard, so a huge result can't flush the rest
+    if (bytes > shard.capacity / 4) {
+        return;
+    }
+    auto found = shard.index.find(key);
+    if (found != shard.index.end()) {
+        Entry& entry = *found->second;
+        shard.bytes = shard.bytes - entry_bytes(entry.key, entry.value) + bytes;
+        entry.value = value;
+        shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+    }
+    else {
+        evict_to(shard, shard.capacity - bytes);
+        shard.entries.push_front({ key, value });
+        shard.index.emplace(shard.entries.front().key, shard.entries.begin());
+        shard.bytes += bytes;
+    }
+    shard.insertions++;
+    evict_to(shard, shard.capacity);
+}
+
+void ResultCache::set_capacity(size_t capacity_bytes) {
+    total_capacity = capacity_bytes;
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.capacity = capacity_bytes / RESULT_CACHE_SHARDS;
+        evict_to(shard, shard.capacity);
+    }
+}
+
+size_t ResultCache::capacity() const {
+    return total_capacity;
+}
+
+ResultCacheStats ResultCache::stats() {
+    ResultCacheStats total;
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total.hits += shard.hits;
+        total.misses += shard.misses;
+        total.insertions += shard.insertions;
+        total.evictions += shard.evictions;
+        total.entries += static_cast<long long>(shard.entries.size());
+        total.bytes += static_cast<long long>(shard.bytes);
+    }
+    return total;
+}
@@ -0,0 +1,64 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+const int RESULT_CACHE_SHARDS = 16;
+
+struct ResultCacheStats {
+    long long hits = 0;
+    long long misses = 0;
+    long long insertions = 0;
+    long long evictions = 0;   // entries dropped to make room
+    long long entries = 0;
+    long long bytes = 0;       // keys, values and per-entry overhead
+};
+
+// Bounded string -> string LRU cache for results of repeated queries. Keys are spread
+// over independently locked shards by hash, so concurrent callers rarely wait on each
+// other; each shard evicts its least recently used entries once it holds more than its
+// share of the byte budget.
+class ResultCache {
+public:
+    explicit ResultCache(size_t capacity_bytes);
+
+    // Copies the value into value and marks the entry most recently used
+    bool find(const std::string& key, std::string& value);
+    // Adds or replaces an entry; values too big for a shard are not kept
+    void insert(const std::string& key, const std::string& value);
+    // New byte budget, evicting down to it right away; 0 empties the cache and keeps it empty
+    void set_capacity(size_t capacity_bytes);
+    size_t capacity() const;
+    ResultCacheStats stats();
+
+private:
+    struct Entry {
+        std::string key;
+        std::string value;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> entries;   // most recently used first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index; // views of the keys in entries
+        size_t bytes = 0;
+        size_t capacity = 0;
+        long long hits = 0;
+        long long misses = 0;
+        long long insertions = 0;
+        long long evictions = 0;
+    };
+
+    Shard& shard_of(const std::string& key);
+    static void evict_to(Shard& shard, size_t bytes);
+
+    Shard shards[RESULT_CACHE_SHARDS];
+    std::atomic<size_t> total_capacity{ 0 };
+};
+
+#endif
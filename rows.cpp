@@ -0,0 +1,475 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include "calc.h"
+#include "color_code.h"
+#include "si_value.h"
+#include "rows.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const size_t ROW_CHUNK_BYTES = 1 << 20; // input per chunk; a chunk runs on to the next newline
+const int ROW_CHUNKS_AHEAD = 4;         // unwritten chunks allowed per worker
+
+bool parse_row_job(const std::string& name, RowJob& job) {
+    if (name == "npv") {
+        job = ROW_NPV;
+    }
+    else if (name == "cutoff") {
+        job = ROW_CUTOFF;
+    }
+    else if (name == "decode") {
+        job = ROW_DECODE;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+bool default_row_fields(RowOptions& options, std::string& error) {
+    size_t needed = options.job == ROW_CUTOFF ? 2 : 1;
+    if (options.columns.empty()) {
+        options.columns = options.job == ROW_CUTOFF ? std::vector<int>{ 1, 2 } : std::vector<int>{ 1 };
+    }
+    if (options.keys.empty()) {
+        options.keys = options.job == ROW_NPV ? std::vector<std::string>{ "value" }
+                     : options.job == ROW_CUTOFF ? std::vector<std::string>{ "r", "c" } : std::vector<std::string>{ "bands" };
+    }
+    bool any = options.job == ROW_DECODE;
+    if ((any ? options.columns.size() < needed : options.columns.size() != needed) ||
+        (any ? options.keys.size() < needed : options.keys.size() != needed)) {
+        error = options.job == ROW_CUTOFF ? "cutoff takes two fields, r and c" : "npv takes one field";
+        return false;
+    }
+    for (int column : options.columns) {
+        if (column < 1) {
+            error = "columns start at 1";
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline const char* skip_spaces(const char* p, const char* last) {
+    while (p < last && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    return p;
+}
+
+static inline const char* trim_end(const char* first, const char* last) {
+    while (last > first && (last[-1] == ' ' || last[-1] == '\t')) {
+        last--;
+    }
+    return last;
+}
+
+// Function to find a CSV field by 1-based column, without the spaces and quotes around
+// it; commas inside quotes don't split
+static bool csv_field(const char* first, const char* last, int column, const char*& field_first, const char*& field_last) {
+    const char* p = first;
+    for (int index = 1;; index++) {
+        const char* start = p;
+        bool quoted = false;
+        while (p < last && (quoted || *p != ',')) {
+            quoted ^= *p++ == '"';
+        }
+        if (index == column) {
+            field_first = skip_spaces(start, p);
+            field_last = trim_end(field_first, p);
+            if (field_last - field_first >= 2 && *field_first == '"' && field_last[-1] == '"') {
+                field_first++;
+                field_last--;
+            }
+            return true;
+        }
+        if (p == last) {
+            return false;
+        }
+        p++;
+    }
+}
+
+// Function to skip a JSON string starting at its opening quote; returns the closing quote, or last
+static const char* json_string_end(const char* p, const char* last) {
+    for (p++; p < last && *p != '"'; p++) {
+        if (*p == '\\') {
+            p++;
+        }
+    }
+    return std::min(p, last);
+}
+
+// Function to find a value of a JSON object by key, on its top level. Strings come back
+// without their quotes, arrays and objects with their brackets.
+static bool json_field(const char* first, const char* last, const std::string& key, const char*& value_first, const char*& value_last) {
+    const char* p = skip_spaces(first, last);
+    if (p == last || *p != '{') {
+        return false;
+    }
+    p = skip_spaces(p + 1, last);
+    while (p < last && *p == '"') {
+        const char* name = p + 1;
+        const char* name_end = json_string_end(p, last);
+        p = skip_spaces(name_end + 1, last);
+        if (p >= last || *p != ':') {
+            return false;
+        }
+        p = skip_spaces(p + 1, last);
+        const char* start = p;
+        if (p < last && *p == '"') {
+            p = json_string_end(p, last);
+            value_first = start + 1;
+            value_last = p;
+            p = std::min(p + 1, last);
+        }
+        else {
+            int depth = 0;
+            for (; p < last && (depth > 0 || (*p != ',' && *p != '}')); p++) {
+                if (*p == '"') {
+                    p = json_string_end(p, last);
+                }
+                else if (*p == '[' || *p == '{') {
+                    depth++;
+                }
+                else if (*p == ']' || *p == '}') {
+                    depth--;
+                }
+            }
+            value_first = start;
+            value_last = trim_end(start, p);
+        }
+        if (static_cast<size_t>(name_end - name) == key.size() && std::memcmp(name, key.data(), key.size()) == 0) {
+            return true;
+        }
+        p = skip_spaces(p, last);
+        if (p >= last || *p != ',') {
+            return false;
+        }
+        p = skip_spaces(p + 1, last);
+    }
+    return false;
+}
+
+// Function to add the colour names in text to bands, each run of letters being one name;
+// false on an unknown colour or too many bands
+static bool read_bands(const char* first, const char* last, BandColor* bands, int& count) {
+    auto is_letter = [](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); };
+    const char* p = first;
+    while (p < last) {
+        while (p < last && !is_letter(*p)) {
+            p++;
+        }
+        const char* start = p;
+        while (p < last && is_letter(*p)) {
+            p++;
+        }
+        if (p == start) {
+            break;
+        }
+        if (count == MAX_BANDS || (bands[count++] = parse_band_color(start, p - start)) == INVALID_COLOR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct RowResult {
+    double values[2];
+    PackedBands bands;
+};
+
+// Function to run the job on one row; returns an error message, or nullptr with the result filled in
+static const char* compute_row(const char* first, const char* last, bool json, const RowOptions& options, RowResult& result) {
+    size_t num_fields = json ? options.keys.size() : options.columns.size();
+    const char* field_first[2];
+    const char* field_last[2];
+    BandColor bands[MAX_BANDS];
+    int num_bands = 0;
+    for (size_t i = 0; i < num_fields; i++) {
+        const char* value_first;
+        const char* value_last;
+        bool found = json ? json_field(first, last, options.keys[i], value_first, value_last)
+                          : csv_field(first, last, options.columns[i], value_first, value_last);
+        if (!found) {
+            return "missing field";
+        }
+        if (options.job == ROW_DECODE) {
+            if (!read_bands(value_first, value_last, bands, num_bands)) {
+                return "invalid colour bands";
+            }
+        }
+        else if (i < 2) {
+            field_first[i] = value_first;
+            field_last[i] = value_last;
+        }
+    }
+
+    switch (options.job) {
+    case ROW_NPV: {
+        double resistance;
+        if (!parse_si_value(field_first[0], field_last[0], resistance, SI_OHM) || !(resistance > 0)) {
+            return "invalid resistance";
+        }
+        PreferredValue npv = nearest_preferred_value(resistance, options.series);
+        // Series with three significant digits are 1% parts with 5-band codes
+        int mantissa, exponent;
+        eseries_decimal(options.series, npv.index, mantissa, exponent);
+        result.values[0] = npv.nearest;
+        result.bands = options.series >= E48 ? encode_color_bands(mantissa, exponent, 5, BROWN)
+                                             : encode_color_bands(mantissa, exponent, 3, NO_BAND);
+        return nullptr;
+    }
+    case ROW_CUTOFF: {
+        double r, c;
+        if (!parse_si_value(field_first[0], field_last[0], r, SI_OHM) || !(r > 0) ||
+            !parse_si_value(field_first[1], field_last[1], c, SI_FARAD) || !(c > 0)) {
+            return "invalid r or c";
+        }
+        result.values[0] = calculate_cutoff_frequency(r, c);
+        return nullptr;
+    }
+    case ROW_DECODE: {
+        ResistorCode code;
+        if (!decode_color_bands(pack_color_bands(bands, num_bands), code)) {
+            return "invalid colour bands";
+        }
+        result.values[0] = code.resistance;
+        result.values[1] = code.tolerance;
+        return nullptr;
+    }
+    }
+    return "unknown job";
+}
+
+// Same digits as an ostream's default format, without the stream
+static inline void append_number(std::string& out, double value) {
+    char digits[32];
+    out.append(digits, std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6).ptr);
+}
+
+static void append_bands(std::string& out, PackedBands bands) {
+    for (int i = 0; i < packed_band_count(bands); i++) {
+        if (i > 0) {
+            out += '-';
+        }
+        out += band_color_name(packed_band(bands, i));
+    }
+}
+
+// Function to write the result fields, each after a comma
+static void append_result(std::string& out, bool json, RowJob job, const RowResult& result) {
+    switch (job) {
+    case ROW_NPV:
+        out += json ? ",\"npv\":" : ",";
+        append_number(out, result.values[0]);
+        out += json ? ",\"bands\":\"" : ",";
+        append_bands(out, result.bands);
+        out += json ? "\"" : "";
+        break;
+    case ROW_CUTOFF:
+        out += json ? ",\"fc\":" : ",";
+        append_number(out, result.values[0]);
+        break;
+    case ROW_DECODE:
+        out += json ? ",\"ohms\":" : ",";
+        append_number(out, result.values[0]);
+        out += json ? ",\"tolerance\":" : ",";
+        append_number(out, json ? result.values[1] : 100 * result.values[1]);
+        out += json ? "" : "%";
+        break;
+    }
+}
+
+// Function to run one line, without its newline, into out
+static void run_row(const char* first, const char* last, bool& header_allowed, const RowOptions& options,
+                    std::string& out, long long& rows, long long& errors) {
+    const char* p = skip_spaces(first, last);
+    if (p == last || *p == '#') {
+        out.append(first, last);
+        return;
+    }
+    bool json = *p == '{';
+    RowResult result{};
+    const char* message = compute_row(first, last, json, options, result);
+    bool header = message && header_allowed && !json;
+    header_allowed = false;
+    if (header) {
+        static const char* const names[] = { ",npv,bands", ",fc", ",ohms,tolerance" };
+        out.append(first, last);
+        out += names[options.job];
+        return;
+    }
+    rows++;
+    // JSON results go inside the object, before its closing brace
+    const char* insert = last;
+    if (json) {
+        const char* end = trim_end(p, last);
+        insert = end > p && end[-1] == '}' ? end - 1 : last;
+    }
+    out.append(first, insert);
+    size_t result_start = out.size();
+    if (message) {
+        errors++;
+        out += json ? ",\"error\":\"" : ",error: ";
+        out += message;
+        out += json ? "\"" : "";
+    }
+    else {
+        append_result(out, json, options.job, result);
+    }
+    // An empty object takes the fields without the leading comma
+    if (json && trim_end(p, insert) == p + 1) {
+        out.erase(result_start, 1);
+    }
+    out.append(insert, last);
+}
+
+static void run_chunk(const char* first, const char* last, bool header_allowed, const RowOptions& options,
+                      std::string& out, long long& rows, long long& errors) {
+    out.reserve(out.size() + (last - first) * 2);
+    while (first < last) {
+        const char* newline = static_cast<const char*>(std::memchr(first, '\n', last - first));
+        const char* end = newline ? newline : last;
+        run_row(first, end > first && end[-1] == '\r' ? end - 1 : end, header_allowed, options, out, rows, errors);
+        out += '\n';
+        first = newline ? newline + 1 : last;
+    }
+}
+
+void run_rows(const char* text, size_t length, const RowOptions& options, std::ostream& out, RowStats& stats) {
+    // Chunks end just after a newline, so every line is in one chunk
+    std::vector<size_t> starts(1, 0);
+    for (size_t at = ROW_CHUNK_BYTES; at < length;) {
+        const char* newline = static_cast<const char*>(std::memchr(text + at, '\n', length - at));
+        if (!newline || static_cast<size_t>(newline - text) + 1 >= length) {
+            break;
+        }
+        starts.push_back(newline - text + 1);
+        at = starts.back() + ROW_CHUNK_BYTES;
+    }
+    starts.push_back(length);
+    int num_chunks = static_cast<int>(starts.size()) - 1;
+    int num_threads = options.num_threads > 0 ? options.num_threads
+                                              : static_cast<int>(std::thread::hardware_concurrency());
+    num_threads = std::max(1, std::min(num_threads, num_chunks));
+
+    // Whichever worker finishes the next chunk to write becomes the writer and writes every
+    // chunk that is ready in order; the others hand over their text and go on
+    std::atomic<int> next_chunk(0);
+    std::atomic<long long> rows(0), errors(0);
+    std::mutex mutex;
+    std::condition_variable written;
+    std::vector<std::string> finished(num_chunks);
+    std::vector<char> ready(num_chunks, 0);
+    int next_write = 0;
+    bool writing = false;
+    const int max_ahead = ROW_CHUNKS_AHEAD * num_threads;
+    auto work = [&]() {
+        std::string buffer;
+        long long chunk_rows = 0, chunk_errors = 0;
+        for (int chunk = next_chunk++; chunk < num_chunks; chunk = next_chunk++) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                written.wait(lock, [&] { return chunk < next_write + max_ahead; });
+            }
+            buffer.clear();
+            run_chunk(text + starts[chunk], text + starts[chunk + 1], chunk == 0, options, buffer, chunk_rows, chunk_errors);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            finished[chunk].swap(buffer);
+            ready[chunk] = 1;
+            if (writing) {
+                continue;
+            }
+            writing = true;
+            while (next_write < num_chunks && ready[next_write]) {
+                std::string& text_out = finished[next_write];
+                lock.unlock();
+                out.write(text_out.data(), static_cast<std::streamsize>(text_out.size()));
+                lock.lock();
+                // Keep one buffer's worth of memory for the next chunk, free the rest
+                if (buffer.capacity() < text_out.capacity()) {
+                    buffer.swap(text_out);
+                }
+                std::string().swap(text_out);
+                next_write++;
+                written.notify_all();
+            }
+            writing = false;
+        }
+        rows += chunk_rows;
+        errors += chunk_errors;
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; i++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    stats.rows = rows;
+    stats.errors = errors;
+}
+
+// Function to read all of a stream, for input that can't be mapped
+static bool read_all(std::istream& in, std::string& text) {
+    text.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+bool run_rows(const std::string& path, const RowOptions& options, std::ostream& out, RowStats& stats, std::string& error) {
+    std::string text;
+    if (path == "-") {
+        if (!read_all(std::cin, text)) {
+            error = "cannot read stdin";
+            return false;
+        }
+        run_rows(text.data(), text.size(), options, out, stats);
+        return true;
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+    size_t length = static_cast<size_t>(info.st_size);
+    void* bytes = length > 0 && S_ISREG(info.st_mode) ? mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    if (bytes != MAP_FAILED) {
+        ::close(fd);
+        // Chunks are taken roughly front to back, so let the kernel read ahead
+        madvise(bytes, length, MADV_SEQUENTIAL);
+        run_rows(static_cast<const char*>(bytes), length, options, out, stats);
+        munmap(bytes, length);
+        return true;
+    }
+    ::close(fd);
+#endif
+    // Pipes, empty files and systems without mmap
+    std::ifstream in(path, std::ios::binary);
+    if (!in || !read_all(in, text)) {
+        error = "cannot read " + path;
+        return false;
+    }
+    run_rows(text.data(), text.size(), options, out, stats);
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef ROWS_H
+#define ROWS_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "eseries.h"
+
+// Bulk row jobs for BOM-sized files (10^7 rows and up): every row gets the same
+// calculation and comes back as the input row with the result fields appended.
+//
+//   npv      a resistance          -> nearest preferred value and its colour bands
+//   cutoff   a resistance and C    -> RC cutoff frequency
+//   decode   colour bands          -> resistance and tolerance
+//
+// Rows are CSV lines or JSONL objects, told apart line by line. CSV fields are picked by
+// 1-based column number, JSON fields by key; values take SI notation ("4k7", "100nF")
+// and bands are any colour names in the field ("brown black red", "brown-black-red" or
+// ["brown","black","red"]). Results go after the last CSV field or before the closing
+// brace: ",4700,yellow-violet-red" or ,"npv":4700,"bands":"yellow-violet-red". A first
+// line whose fields don't parse is taken as a CSV header and gets the result names;
+// blank lines and '#' comments pass through, and other bad rows get an error field.
+//
+// The file is memory-mapped (stdin is read into memory), cut into newline-aligned
+// chunks and the chunks are run on every core. Finished chunks are written in input
+// order, and workers stay at most a few chunks ahead of the writer, so memory use does
+// not grow with the file.
+
+enum RowJob {
+    ROW_NPV,
+    ROW_CUTOFF,
+    ROW_DECODE
+};
+
+struct RowOptions {
+    RowJob job = ROW_NPV;
+    std::vector<int> columns;              // CSV columns, 1-based; empty for the job's default
+    std::vector<std::string> keys;         // JSON keys; empty for the job's default
+    ESeries series = E12;
+    int num_threads = 0;                   // 0 uses every core
+};
+
+struct RowStats {
+    long long rows = 0;
+    long long errors = 0;    // rows that got an error field
+};
+
+bool parse_row_job(const std::string& name, RowJob& job);
+// Fills in the default columns (npv 1, cutoff 1 and 2, decode 1) and keys (npv "value",
+// cutoff "r" and "c", decode "bands"), and checks the count the job needs
+bool default_row_fields(RowOptions& options, std::string& error);
+
+// Runs the job over a file ("-" for stdin); false if the input can't be read
+bool run_rows(const std::string& path, const RowOptions& options, std::ostream& out, RowStats& stats, std::string& error);
+// Same over text already in memory
+void run_rows(const char* text, size_t length, const RowOptions& options, std::ostream& out, RowStats& stats);
+
+#endif
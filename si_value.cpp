@@ -0,0 +1,216 @@
+#include <charconv>
+#include <cstring>
+#include "si_value.h"
+
+const int SI_MAX_DIGITS = 40;         // longest digit string the decimal rewrite takes
+const int SI_MAX_EXPONENT = 100000;   // written exponents are clamped to this, far beyond double range
+
+static inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline const char* skip_spaces(const char* p, const char* last) {
+    while (p < last && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+        p++;
+    }
+    return p;
+}
+
+// Function to match a literal at p, moving p past it
+static inline bool match(const char*& p, const char* last, const char* literal) {
+    size_t length = std::strlen(literal);
+    if (static_cast<size_t>(last - p) < length || std::memcmp(p, literal, length) != 0) {
+        return false;
+    }
+    p += length;
+    return true;
+}
+
+// Function to read an SI prefix as a power of ten; R (and r) is the ohm decimal point of "4R7"
+static bool read_prefix(const char*& p, const char* last, int& power, SiUnit& unit) {
+    if (match(p, last, "meg") || match(p, last, "Meg") || match(p, last, "MEG")) {
+        power = 6;
+        return true;
+    }
+    if (match(p, last, "\xC2\xB5") || match(p, last, "\xCE\xBC")) { // micro sign and Greek mu
+        power = -6;
+        return true;
+    }
+    if (p == last) {
+        return false;
+    }
+    switch (*p) {
+    case 'f': power = -15; break;
+    case 'p': power = -12; break;
+    case 'n': power = -9; break;
+    case 'u': power = -6; break;
+    case 'm': power = -3; break;
+    case 'k': case 'K': power = 3; break;
+    case 'M': power = 6; break;
+    case 'G': power = 9; break;
+    case 'T': power = 12; break;
+    case 'R': case 'r': power = 0; unit = SI_OHM; break;
+    default: return false;
+    }
+    p++;
+    return true;
+}
+
+// Function to read a unit name; longer names are tried before their prefixes (Hz before H)
+static bool read_unit(const char*& p, const char* last, SiUnit& unit) {
+    if (match(p, last, "\xCE\xA9") || match(p, last, "ohms") || match(p, last, "ohm") ||
+        match(p, last, "Ohms") || match(p, last, "Ohm")) {
+        unit = SI_OHM;
+    }
+    else if (match(p, last, "Hz") || match(p, last, "hz") || match(p, last, "HZ")) {
+        unit = SI_HERTZ;
+    }
+    else if (match(p, last, "F")) {
+        unit = SI_FARAD;
+    }
+    else if (match(p, last, "H")) {
+        unit = SI_HENRY;
+    }
+    else if (match(p, last, "V")) {
+        unit = SI_VOLT;
+    }
+    else if (match(p, last, "A")) {
+        unit = SI_AMPERE;
+    }
+    else if (match(p, last, "s")) {
+        unit = SI_SECOND;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+bool parse_si_value(const char* first, const char* last, double& value, SiUnit expected) {
+    const char* p = skip_spaces(first, last);
+    bool negative = false;
+    if (p < last && (*p == '+' || *p == '-')) {
+        negative = *p == '-';
+        p++;
+    }
+    const char* whole = p;
+    while (p < last && is_digit(*p)) {
+        p++;
+    }
+    const char* whole_end = p;
+    const char* fraction = p;
+    const char* fraction_end = p;
+    bool has_point = p < last && *p == '.';
+    if (has_point) {
+        fraction = ++p;
+        while (p < last && is_digit(*p)) {
+            p++;
+        }
+        fraction_end = p;
+    }
+    if (whole == whole_end && fraction == fraction_end) {
+        return false;
+    }
+
+    int exponent = 0;
+    bool has_exponent = false;
+    if (p < last && (*p == 'e' || *p == 'E')) {
+        const char* digits = p + 1;
+        bool negative_exponent = digits < last && *digits == '-';
+        if (digits < last && (*digits == '+' || *digits == '-')) {
+            digits++;
+        }
+        const char* end = digits;
+        while (end < last && is_digit(*end)) {
+            end++;
+        }
+        if (end == digits) {
+            return false;
+        }
+        // Leading digits beyond the clamp can only mean overflow or underflow
+        for (const char* d = digits; d < end && exponent <= SI_MAX_EXPONENT; d++) {
+            exponent = exponent * 10 + (*d - '0');
+        }
+        exponent = negative_exponent ? -exponent : exponent;
+        has_exponent = true;
+        p = end;
+    }
+
+    // Prefix, then the "4k7" fraction digits, then the unit
+    SiUnit unit = SI_NO_UNIT;
+    int power = 0;
+    p = skip_spaces(p, last);
+    const char* before_prefix = p;
+    if (read_prefix(p, last, power, unit)) {
+        if (p < last && is_digit(*p) && !has_point && !has_exponent && before_prefix == whole_end) {
+            fraction = p;
+            while (p < last && is_digit(*p)) {
+                p++;
+            }
+            fraction_end = p;
+        }
+        p = skip_spaces(p, last);
+    }
+    if (p < last) {
+        SiUnit written;
+        if (!read_unit(p, last, written) || (unit == SI_OHM && written != SI_OHM)) {
+            return false;
+        }
+        unit = written;
+        p = skip_spaces(p, last);
+    }
+    if (p != last || (expected != SI_ANY_UNIT && unit != SI_NO_UNIT && unit != expected)) {
+        return false;
+    }
+
+    // Rewrite as <digits>e<exponent> so from_chars rounds once, e.g. "4k7" -> "47e2".
+    // Zeros at either end carry no digits, so "0.000001" and "1.000000" stay short.
+    while (fraction_end > fraction && fraction_end[-1] == '0') {
+        fraction_end--;
+    }
+    while (whole < whole_end && *whole == '0') {
+        whole++;
+    }
+    int scale = exponent + power - static_cast<int>(fraction_end - fraction);
+    if (whole == whole_end) {
+        while (fraction < fraction_end && *fraction == '0') {
+            fraction++;
+        }
+    }
+    long whole_length = whole_end - whole, fraction_length = fraction_end - fraction;
+    if (whole_length + fraction_length > SI_MAX_DIGITS) {
+        return false;
+    }
+    char buffer[SI_MAX_DIGITS + 16];
+    char* out = buffer;
+    std::memcpy(out, whole, whole_length);
+    out += whole_length;
+    std::memcpy(out, fraction, fraction_length);
+    out += fraction_length;
+    if (out == buffer) {
+        *out++ = '0';
+    }
+    *out++ = 'e';
+    out = std::to_chars(out, buffer + sizeof(buffer), scale).ptr;
+    std::from_chars_result result = std::from_chars(buffer, out, value);
+    if (result.ec != std::errc() || result.ptr != out) {
+        return false;
+    }
+    if (negative) {
+        value = -value;
+    }
+    return true;
+}
+
+const char* si_unit_name(SiUnit unit) {
+    switch (unit) {
+    case SI_OHM: return "ohms";
+    case SI_FARAD: return "F";
+    case SI_HENRY: return "H";
+    case SI_HERTZ: return "Hz";
+    case SI_VOLT: return "V";
+    case SI_AMPERE: return "A";
+    case SI_SECOND: return "s";
+    default: return "";
+    }
+}
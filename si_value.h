@@ -0,0 +1,37 @@
+#ifndef SI_VALUE_H
+#define SI_VALUE_H
+
+#include <string>
+
+// Component values in the notation printed on parts and schematics: "4k7", "2.2M", "100n",
+// "47pF", "1.5kHz", "10 Ω", "470R", "1e-6", "3.3 meg". Digits after a prefix are the
+// fraction ("4k7" is 4.7k). m is milli and M or meg is mega; u, µ and μ are all micro.
+// The digits and prefix are rewritten as one decimal string for std::from_chars, so
+// "100n" is exactly the double nearest 1e-7, and nothing is allocated.
+
+enum SiUnit {
+    SI_ANY_UNIT,  // accept whichever unit is written
+    SI_NO_UNIT,   // a bare number or prefix
+    SI_OHM,       // Ω, ohm, ohms, or the R of "4R7"
+    SI_FARAD,     // F
+    SI_HENRY,     // H
+    SI_HERTZ,     // Hz
+    SI_VOLT,      // V
+    SI_AMPERE,    // A
+    SI_SECOND     // s
+};
+
+// Parses all of [first, last), spaces allowed around the number and suffix. Fails on
+// anything else left over, or on a unit other than expected (a value without a unit is
+// always accepted).
+bool parse_si_value(const char* first, const char* last, double& value, SiUnit expected = SI_ANY_UNIT);
+
+// Parses a value such as "10k", "100n", "4k7" or "2.2M" into base units
+inline bool parse_value(const std::string& text, double& value) {
+    return parse_si_value(text.data(), text.data() + text.size(), value);
+}
+
+// Unit symbol for messages, e.g. "ohms" or "Hz"; empty for SI_ANY_UNIT and SI_NO_UNIT
+const char* si_unit_name(SiUnit unit);
+
+#endif
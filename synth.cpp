@@ -0,0 +1,415 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "synth.h"
+
+enum NetworkOp {
+    OP_SERIES,
+    OP_PARALLEL
+};
+
+// One side of a split: a single part, or a two-part sub-network r1 op r2
+struct Operand {
+    double value;
+    double r1;
+    double r2;
+    int parts;
+    NetworkOp pair_op;
+};
+
+struct PathStep {
+    NetworkOp op;
+    const Operand* operand;
+};
+
+// A top-level branch of one depth, handed out to the workers
+struct SearchTask {
+    NetworkOp op;
+    const Operand* operand;
+};
+
+struct TaskQueue {
+    std::mutex lock;
+    std::deque<SearchTask> tasks;
+};
+
+static double combine(NetworkOp op, double a, double b) {
+    return (op == OP_SERIES) ? a + b : a * b / (a + b);
+}
+
+std::string format_resistance(double value) {
+    static const char prefixes[] = { 'm', 0, 'k', 'M', 'G' };
+    int group = 1;
+    double scaled = value;
+    while (scaled >= 1000 && group < 4) {
+        scaled /= 1000;
+        group++;
+    }
+    while (scaled < 1 && group > 0) {
+        scaled *= 1000;
+        group--;
+    }
+    std::ostringstream text;
+    text.precision(4);
+    text << scaled;
+    if (prefixes[group] != 0) {
+        text << prefixes[group];
+    }
+    return text.str();
+}
+
+static std::string operand_expression(const Operand& operand) {
+    if (operand.parts == 1) {
+        return format_resistance(operand.r1);
+    }
+    return format_resistance(operand.r1) + (operand.pair_op == OP_SERIES ? " + " : " || ") + format_resistance(operand.r2);
+}
+
+// State shared by every worker of one synthesis run
+struct SearchContext {
+    double target;
+    SynthesisOptions options;
+    double min_leaf;
+    double max_leaf;
+    std::vector<Operand> leaves; // ascending by value
+    std::vector<Operand> pairs;  // ascending by value
+
+    std::mutex best_lock;
+    std::vector<NetworkSolution> best;    // ranked by |error|
+    std::atomic<double> budget;           // |error| a new solution has to beat
+    std::atomic<bool> stop;
+    std::chrono::steady_clock::time_point deadline;
+    std::atomic<long long> nodes;
+
+    // Function to offer a finished network to the ranking
+    void record(double value, int parts, const PathStep* path, int length, double leaf) {
+        double error = (value - target) / target;
+        if (std::abs(error) >= budget.load(std::memory_order_relaxed)) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(best_lock);
+        int k = options.max_solutions;
+        if (static_cast<int>(best.size()) == k && std::abs(error) >= std::abs(best.back().error)) {
+            return;
+        }
+        // The same network can be reached through different orderings
+        for (const NetworkSolution& solution : best) {
+            if (solution.parts == parts && std::abs(solution.value - value) <= 1e-12 * value) {
+                return;
+            }
+        }
+
+        // Rebuild the expression from the innermost part outwards
+        std::string expression = format_resistance(leaf);
+        bool composite = false;
+        NetworkOp inner_op = OP_SERIES;
+        for (int i = length - 1; i >= 0; i--) {
+            const PathStep& step = path[i];
+            std::string left = operand_expression(*step.operand);
+            if (step.operand->parts > 1) {
+                left = "(" + left + ")";
+            }
+            if (composite && inner_op != step.op) {
+                expression = "(" + expression + ")";
+            }
+            expression = left + (step.op == OP_SERIES ? " + " : " || ") + expression;
+            composite = true;
+            inner_op = step.op;
+        }
+
+        NetworkSolution solution = { value, error, parts, expression };
+        auto position = std::upper_bound(best.begin(), best.end(), solution,
+            [](const NetworkSolution& a, const NetworkSolution& b) { return std::abs(a.error) < std::abs(b.error); });
+        best.insert(position, solution);
+        if (static_cast<int>(best.size()) > k) {
+            best.pop_back();
+        }
+        if (static_cast<int>(best.size()) == k) {
+            budget.store(std::abs(best.back().error), std::memory_order_relaxed);
+        }
+    }
+};
+
+// Depth-first branch-and-bound over one worker's share of the tree
+class SearchWorker {
+public:
+    explicit SearchWorker(SearchContext& context) : nodes(0), ctx(context), total_parts(0) {}
+
+    void run_task(const SearchTask& task, int parts) {
+        total_parts = parts;
+        explore(ctx.target, parts, 1.0, task.op, *task.operand, 0);
+    }
+
+    long long nodes;
+
+private:
+    SearchContext& ctx;
+    int total_parts;
+    PathStep path[SYNTH_MAX_PARTS];
+
+    bool out_of_time() {
+        if (ctx.stop.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        if ((++nodes & 1023) == 0 && std::chrono::steady_clock::now() > ctx.deadline) {
+            ctx.stop.store(true);
+            return true;
+        }
+        return false;
+    }
+
+    // Evaluates the network along the path with the given final part
+    double evaluate(int length, double leaf) const {
+        double value = leaf;
+        for (int i = length - 1; i >= 0; i--) {
+            value = combine(path[i].op, path[i].operand->value, value);
+        }
+        return value;
+    }
+
+    // Absolute error allowed at a node whose value moves the root by `sensitivity` per ohm
+    double node_budget(double sensitivity) const {
+        return ctx.budget.load(std::memory_order_relaxed) * ctx.target / sensitivity * 1.1;
+    }
+
+    // Splits target into `operand op rest` and searches the rest
+    void explore(double target, int parts, double sensitivity, NetworkOp op, const Operand& operand, int length) {
+        int rest = parts - operand.parts;
+        double x = operand.value;
+        double residual, child_sensitivity;
+        if (op == OP_SERIES) {
+            residual = target - x;
+            child_sensitivity = sensitivity;
+        }
+        else {
+            residual = x * target / (x - target);
+            child_sensitivity = sensitivity * (target / residual) * (target / residual);
+        }
+        if (!(residual > 0)) {
+            return;
+        }
+        // The rest can't go below all-parallel or above all-series of the extreme parts
+        double slack = node_budget(child_sensitivity);
+        if (residual + slack < ctx.min_leaf / rest || residual - slack > ctx.max_leaf * rest) {
+            return;
+        }
+        path[length] = { op, &operand };
+        search(residual, rest, child_sensitivity, op, operand, length + 1);
+    }
+
+    void search(double target, int parts, double sensitivity, NetworkOp prev_op, const Operand& prev, int length) {
+        if (out_of_time()) {
+            return;
+        }
+        if (parts == 1) {
+            // Last part: look the value up instead of enumerating it
+            double budget = node_budget(sensitivity);
+            PreferredValue npv = nearest_preferred_value(target, ctx.options.series);
+            double candidates[2] = { npv.next_down, npv.next_up };
+            for (int i = 0; i < 2; i++) {
+                double leaf = candidates[i];
+                if (i == 1 && leaf == candidates[0]) {
+                    break;
+                }
+                if (std::abs(leaf - target) > budget || leaf < ctx.min_leaf || leaf > ctx.max_leaf) {
+                    continue;
+                }
+                // Same-op chains of single parts are kept in descending order
+                if (prev.parts == 1 && leaf > prev.value) {
+                    continue;
+                }
+                ctx.record(evaluate(length, leaf), total_parts, path, length, leaf);
+            }
+            return;
+        }
+
+        for (int o = 0; o < 2; o++) {
+            NetworkOp op = (o == 0) ? OP_SERIES : OP_PARALLEL;
+            for (int kind = 0; kind < 2; kind++) {
+                // Pairs only split off when the rest has at least two parts as well
+                if (kind == 1 && parts < 4) {
+                    break;
+                }
+                const std::vector<Operand>& operands = (kind == 0) ? ctx.leaves : ctx.pairs;
+                auto begin = operands.begin();
+                auto end = operands.end();
+                auto by_value = [](const Operand& a, double v) { return a.value < v; };
+                if (op == OP_SERIES) {
+                    end = std::lower_bound(begin, end, target, by_value);
+                }
+                else {
+                    begin = std::upper_bound(begin, end, target, [](double v, const Operand& a) { return v < a.value; });
+                }
+                bool ordered = (kind == 0 && op == prev_op && prev.parts == 1);
+                for (auto it = begin; it != end; ++it) {
+                    if (ordered && it->value > prev.value) {
+                        break;
+                    }
+                    if (parts - it->parts < 1) {
+                        continue;
+                    }
+                    explore(target, parts, sensitivity, op, *it, length);
+                    if (ctx.stop.load(std::memory_order_relaxed)) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+};
+
+// Function to search every network of exactly `parts` parts on all worker threads
+static void search_depth(SearchContext& ctx, int parts, int num_threads) {
+    if (parts == 1) {
+        PreferredValue npv = nearest_preferred_value(ctx.target, ctx.options.series);
+        double candidates[2] = { npv.next_down, npv.next_up };
+        for (double leaf : candidates) {
+            if (leaf >= ctx.min_leaf && leaf <= ctx.max_leaf) {
+                ctx.record(leaf, 1, nullptr, 0, leaf);
+            }
+        }
+        return;
+    }
+
+    // Top-level branches, dealt round-robin; idle workers steal from the back of other queues
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    for (int i = 0; i < num_threads; i++) {
+        queues.emplace_back(new TaskQueue());
+    }
+    int next = 0;
+    for (int o = 0; o < 2; o++) {
+        NetworkOp op = (o == 0) ? OP_SERIES : OP_PARALLEL;
+        for (const Operand& operand : ctx.leaves) {
+            queues[next++ % num_threads]->tasks.push_back({ op, &operand });
+        }
+        if (parts >= 4) {
+            for (const Operand& operand : ctx.pairs) {
+                queues[next++ % num_threads]->tasks.push_back({ op, &operand });
+            }
+        }
+    }
+
+    auto next_task = [&queues, num_threads](int worker, SearchTask& task) {
+        for (int i = 0; i < num_threads; i++) {
+            TaskQueue& queue = *queues[(worker + i) % num_threads];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            }
+            else {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            }
+            return true;
+        }
+        return false;
+    };
+
+    auto work = [&ctx, &next_task, parts](int worker) {
+        SearchWorker searcher(ctx);
+        SearchTask task;
+        while (!ctx.stop.load(std::memory_order_relaxed) && next_task(worker, task)) {
+            searcher.run_task(task, parts);
+        }
+        ctx.nodes += searcher.nodes;
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; i++) {
+        threads.emplace_back(work, i);
+    }
+    work(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+SynthesisResult synthesize_network(double target, const SynthesisOptions& options) {
+    SynthesisResult result;
+    result.met_tolerance = false;
+    result.timed_out = false;
+    result.nodes_visited = 0;
+    if (target <= 0 || options.max_solutions <= 0) {
+        return result;
+    }
+
+    SearchContext ctx;
+    ctx.target = target;
+    ctx.options = options;
+    ctx.options.max_parts = std::max(1, std::min(options.max_parts, SYNTH_MAX_PARTS));
+    ctx.budget = std::numeric_limits<double>::infinity();
+    ctx.stop = false;
+    ctx.nodes = 0;
+    ctx.deadline = std::chrono::steady_clock::now() +
+        std::chrono::microseconds(static_cast<long long>(options.time_budget_ms * 1000));
+
+    // Candidate parts inside the impedance window around the target
+    int count;
+    const double* values = eseries_values(options.series, count);
+    double low = target / options.max_ratio;
+    double high = target * options.max_ratio;
+    for (int i = 0; i < count; i++) {
+        if (values[i] >= low && values[i] <= high) {
+            ctx.leaves.push_back({ values[i], values[i], 0, 1, OP_SERIES });
+        }
+    }
+    if (ctx.leaves.empty()) {
+        return result;
+    }
+    ctx.min_leaf = ctx.leaves.front().value;
+    ctx.max_leaf = ctx.leaves.back().value;
+    if (ctx.options.max_parts >= 4) {
+        for (size_t i = 0; i < ctx.leaves.size(); i++) {
+            for (size_t j = i; j < ctx.leaves.size(); j++) {
+                double a = ctx.leaves[i].value, b = ctx.leaves[j].value;
+                ctx.pairs.push_back({ a + b, a, b, 2, OP_SERIES });
+                ctx.pairs.push_back({ a * b / (a + b), a, b, 2, OP_PARALLEL });
+            }
+        }
+        std::sort(ctx.pairs.begin(), ctx.pairs.end(),
+            [](const Operand& a, const Operand& b) { return a.value < b.value; });
+    }
+
+    int num_threads = options.num_threads > 0 ? options.num_threads
+                                              : static_cast<int>(std::thread::hardware_concurrency());
+    num_threads = std::max(1, num_threads);
+
+    // Iterative deepening: stop at the first part count that meets the tolerance
+    for (int parts = 1; parts <= ctx.options.max_parts && !ctx.stop; parts++) {
+        search_depth(ctx, parts, num_threads);
+        if (!ctx.best.empty() && std::abs(ctx.best.front().error) <= options.tolerance) {
+            result.met_tolerance = true;
+            break;
+        }
+    }
+
+    result.solutions = ctx.best;
+    if (result.met_tolerance) {
+        // Hits first, fewest parts first; misses keep their error order after them
+        double tolerance = options.tolerance;
+        std::stable_sort(result.solutions.begin(), result.solutions.end(),
+            [tolerance](const NetworkSolution& a, const NetworkSolution& b) {
+                bool a_hit = std::abs(a.error) <= tolerance, b_hit = std::abs(b.error) <= tolerance;
+                if (a_hit != b_hit) {
+                    return a_hit;
+                }
+                return a_hit && a.parts < b.parts;
+            });
+    }
+    result.timed_out = ctx.stop;
+    result.nodes_visited = ctx.nodes;
+    return result;
+}
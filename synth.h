@@ -0,0 +1,44 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <string>
+#include <vector>
+#include "eseries.h"
+
+// Resistor network synthesis: finds series/parallel trees of up to 5 preferred values
+// that hit a target resistance. The search runs depth by depth (1 part, 2 parts, ...)
+// so the first depth that meets the tolerance gives the lowest part count. Each depth
+// is a branch-and-bound search spread over worker threads with work stealing.
+
+const int SYNTH_MAX_PARTS = 5;
+
+struct SynthesisOptions {
+    ESeries series = E24;
+    int max_parts = 4;            // 1 to SYNTH_MAX_PARTS
+    double tolerance = 1e-3;      // relative error that counts as a hit
+    double max_ratio = 1000;      // parts stay within target / max_ratio .. target * max_ratio
+    int max_solutions = 5;
+    int num_threads = 0;          // 0 uses every core
+    double time_budget_ms = 1000; // wall-clock limit, the best found so far is returned
+};
+
+struct NetworkSolution {
+    double value;
+    double error;           // (value - target) / target
+    int parts;
+    std::string expression; // e.g. "4.7k + (220 || 10k)"
+};
+
+struct SynthesisResult {
+    std::vector<NetworkSolution> solutions; // lowest part count first, then lowest error
+    bool met_tolerance;
+    bool timed_out;
+    long long nodes_visited;
+};
+
+SynthesisResult synthesize_network(double target, const SynthesisOptions& options);
+
+// Function to print a resistance compactly, e.g. 4700 -> "4.7k"
+std::string format_resistance(double value);
+
+#endif
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "calc.h"
+#include "tolerance.h"
+
+const int MC_MAX_PARTS = 6;
+const long long MC_CHUNK_TRIALS = 16384; // trials summarised together, independent of the thread count
+const int MC_HISTOGRAM_BINS = 2000;
+const double MC_HISTOGRAM_SPAN = 0.5;    // histogram covers nominal +/- 50%
+
+// SplitMix64 finaliser
+static uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Function to get a uniform number in [0, 1) for one (seed, trial, draw) counter
+static double counter_uniform(uint64_t seed, uint64_t trial, uint64_t draw) {
+    uint64_t bits = mix64(mix64(seed ^ mix64(trial)) + draw * 0xD1B54A32D192ED03ULL);
+    return static_cast<double>(bits >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Function to draw one part value; part selects its own block of draw counters
+static double draw_part(double nominal, const PartTolerance& tolerance, uint64_t seed, uint64_t trial, int part) {
+    if (tolerance.tolerance <= 0) {
+        return nominal;
+    }
+    uint64_t draw = static_cast<uint64_t>(part) * 64;
+    if (tolerance.distribution == UNIFORM_TOLERANCE) {
+        return nominal * (1 + tolerance.tolerance * (2 * counter_uniform(seed, trial, draw) - 1));
+    }
+    // Box-Muller, redrawn (rarely) until inside 3 sigma
+    for (int attempt = 0; attempt < 32; attempt++) {
+        double u1 = counter_uniform(seed, trial, draw + 2 * attempt);
+        double u2 = counter_uniform(seed, trial, draw + 2 * attempt + 1);
+        double z = std::sqrt(-2 * std::log(1 - u1)) * std::cos(2 * PI * u2);
+        if (std::fabs(z) <= 3) {
+            return nominal * (1 + tolerance.tolerance * z / 3);
+        }
+    }
+    return nominal;
+}
+
+// Running mean/variance (Welford) and range of every metric over one chunk of trials
+struct ChunkStats {
+    long long count = 0;
+    long long passed = 0;
+    double mean[MC_MAX_METRICS] = {};
+    double m2[MC_MAX_METRICS] = {};
+    double min[MC_MAX_METRICS];
+    double max[MC_MAX_METRICS];
+
+    void add(const double* values, int num_metrics) {
+        count++;
+        for (int m = 0; m < num_metrics; m++) {
+            double delta = values[m] - mean[m];
+            mean[m] += delta / count;
+            m2[m] += delta * (values[m] - mean[m]);
+            min[m] = count == 1 ? values[m] : std::min(min[m], values[m]);
+            max[m] = count == 1 ? values[m] : std::max(max[m], values[m]);
+        }
+    }
+
+    // Chan's pairwise update, applied in chunk order so the sums never depend on threads
+    void merge(const ChunkStats& other, int num_metrics) {
+        if (other.count == 0) {
+            return;
+        }
+        long long total = count + other.count;
+        for (int m = 0; m < num_metrics; m++) {
+            double delta = other.mean[m] - mean[m];
+            m2[m] += other.m2[m] + delta * delta * count * other.count / total;
+            mean[m] += delta * other.count / total;
+            min[m] = count == 0 ? other.min[m] : std::min(min[m], other.min[m]);
+            max[m] = count == 0 ? other.max[m] : std::max(max[m], other.max[m]);
+        }
+        count = total;
+        passed += other.passed;
+    }
+};
+
+// Function to map a value to its histogram bin, relative to the nominal
+static int histogram_bin(double value, double nominal) {
+    double scale = nominal != 0 ? std::fabs(nominal) : 1;
+    double position = ((value - nominal) / scale + MC_HISTOGRAM_SPAN) / (2 * MC_HISTOGRAM_SPAN);
+    int bin = static_cast<int>(position * MC_HISTOGRAM_BINS);
+    return std::max(0, std::min(MC_HISTOGRAM_BINS - 1, bin));
+}
+
+// Function to read a percentile (0..1) back out of a histogram as the bin centre
+static double histogram_percentile(const long long* counts, long long total, double fraction, double nominal) {
+    long long wanted = static_cast<long long>(std::ceil(fraction * total));
+    long long seen = 0;
+    int bin = 0;
+    for (; bin < MC_HISTOGRAM_BINS - 1; bin++) {
+        seen += counts[bin];
+        if (seen >= wanted) {
+            break;
+        }
+    }
+    double scale = nominal != 0 ? std::fabs(nominal) : 1;
+    double relative = (bin + 0.5) / MC_HISTOGRAM_BINS * 2 * MC_HISTOGRAM_SPAN - MC_HISTOGRAM_SPAN;
+    return nominal + relative * scale;
+}
+
+// Empty result for invalid inputs
+static MonteCarloResult invalid_result() {
+    MonteCarloResult result;
+    result.num_metrics = 0;
+    result.trials = 0;
+    result.passed = 0;
+    result.yield = 0;
+    return result;
+}
+
+// Runs the trials of one design. evaluate(parts, metrics) turns drawn part values into
+// metric values with the calc.h formulas; is_capacitor picks each part's tolerance.
+template <typename Evaluate>
+static MonteCarloResult run_trials(int num_parts, const double* nominal_parts, const bool* is_capacitor,
+                                   int num_metrics, const MetricSpec* specs,
+                                   const MonteCarloOptions& options, Evaluate evaluate) {
+    MonteCarloResult result = invalid_result();
+    if (options.trials <= 0) {
+        return result;
+    }
+
+    double nominal[MC_MAX_METRICS];
+    evaluate(nominal_parts, nominal);
+
+    long long num_chunks = (options.trials + MC_CHUNK_TRIALS - 1) / MC_CHUNK_TRIALS;
+    std::vector<ChunkStats> chunks(num_chunks);
+    int num_threads = options.num_threads > 0 ? options.num_threads
+                                              : static_cast<int>(std::thread::hardware_concurrency());
+    num_threads = static_cast<int>(std::max(1LL, std::min<long long>(num_threads, num_chunks)));
+    std::vector<std::vector<long long>> histograms(num_threads,
+                                                   std::vector<long long>(MC_MAX_METRICS * MC_HISTOGRAM_BINS, 0));
+    std::atomic<long long> next_chunk(0);
+
+    auto work = [&](int thread_index) {
+        long long* histogram = histograms[thread_index].data();
+        double parts[MC_MAX_PARTS];
+        double values[MC_MAX_METRICS];
+        for (long long chunk = next_chunk++; chunk < num_chunks; chunk = next_chunk++) {
+            ChunkStats& stats = chunks[chunk];
+            long long end = std::min(options.trials, (chunk + 1) * MC_CHUNK_TRIALS);
+            for (long long trial = chunk * MC_CHUNK_TRIALS; trial < end; trial++) {
+                for (int p = 0; p < num_parts; p++) {
+                    parts[p] = draw_part(nominal_parts[p], is_capacitor[p] ? options.capacitor : options.resistor,
+                                         options.seed, static_cast<uint64_t>(trial), p);
+                }
+                evaluate(parts, values);
+                bool pass = true;
+                for (int m = 0; m < num_metrics; m++) {
+                    pass = pass && values[m] >= specs[m].min && values[m] <= specs[m].max;
+                    histogram[m * MC_HISTOGRAM_BINS + histogram_bin(values[m], nominal[m])]++;
+                }
+                stats.add(values, num_metrics);
+                stats.passed += pass ? 1 : 0;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; i++) {
+        threads.emplace_back(work, i);
+    }
+    work(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    ChunkStats total;
+    for (const ChunkStats& chunk : chunks) {
+        total.merge(chunk, num_metrics);
+    }
+    std::vector<long long> counts(MC_HISTOGRAM_BINS);
+    for (int m = 0; m < num_metrics; m++) {
+        for (int bin = 0; bin < MC_HISTOGRAM_BINS; bin++) {
+            counts[bin] = 0;
+            for (const std::vector<long long>& histogram : histograms) {
+                counts[bin] += histogram[m * MC_HISTOGRAM_BINS + bin];
+            }
+        }
+        MetricStats& stats = result.metrics[m];
+        stats.nominal = nominal[m];
+        stats.mean = total.mean[m];
+        stats.stddev = total.count > 1 ? std::sqrt(total.m2[m] / (total.count - 1)) : 0;
+        stats.min = total.min[m];
+        stats.max = total.max[m];
+        // Bin centres can fall just outside the sampled range, so keep them inside it
+        auto percentile = [&](double fraction) {
+            double value = histogram_percentile(counts.data(), total.count, fraction, nominal[m]);
+            return std::min(stats.max, std::max(stats.min, value));
+        };
+        stats.percentile_1 = percentile(0.01);
+        stats.median = percentile(0.5);
+        stats.percentile_99 = percentile(0.99);
+    }
+    result.num_metrics = num_metrics;
+    result.trials = total.count;
+    result.passed = total.passed;
+    result.yield = static_cast<double>(total.passed) / total.count;
+    return result;
+}
+
+MonteCarloResult monte_carlo_rc(double r, double c, const MetricSpec& cutoff_spec, const MonteCarloOptions& options) {
+    if (r <= 0 || c <= 0) {
+        return invalid_result();
+    }
+    const double parts[] = { r, c };
+    const bool is_capacitor[] = { false, true };
+    return run_trials(2, parts, is_capacitor, 1, &cutoff_spec, options,
+        [](const double* p, double* metrics) {
+            metrics[0] = calculate_cutoff_frequency(p[0], p[1], 1.0);
+        });
+}
+
+MonteCarloResult monte_carlo_inverting(double vin, double feedback_resistor, double input_resistor,
+                                       const MetricSpec& vout_spec, const MonteCarloOptions& options) {
+    if (feedback_resistor <= 0 || input_resistor <= 0) {
+        return invalid_result();
+    }
+    const double parts[] = { feedback_resistor, input_resistor };
+    const bool is_capacitor[] = { false, false };
+    const MetricSpec specs[] = { MetricSpec(), vout_spec };
+    return run_trials(2, parts, is_capacitor, 2, specs, options,
+        [vin](const double* p, double* metrics) {
+            OpAmpResult result = inverting_amplifier(vin, p[0], p[1]);
+            metrics[0] = result.gain;
+            metrics[1] = result.output_voltage;
+        });
+}
+
+MonteCarloResult monte_carlo_non_inverting(double vin, double feedback_resistor, double ground_resistor,
+                                           const MetricSpec& vout_spec, const MonteCarloOptions& options) {
+    if (feedback_resistor <= 0 || ground_resistor <= 0) {
+        return invalid_result();
+    }
+    const double parts[] = { feedback_resistor, ground_resistor };
+    const bool is_capacitor[] = { false, false };
+    const MetricSpec specs[] = { MetricSpec(), vout_spec };
+    return run_trials(2, parts, is_capacitor, 2, specs, options,
+        [vin](const double* p, double* metrics) {
+            OpAmpResult result = non_inverting_amplifier(vin, p[0], p[1]);
+            metrics[0] = result.gain;
+            metrics[1] = result.output_voltage;
+        });
+}
+
+// Unity-feedback Sallen-Key with gain K, parts R1, R2, C1, C2, RA, RB:
+//   low-pass  (R1, R2 in series, C1 to the output, C2 to ground)
+//     w0/Q = 1/(R1 C1) + 1/(R2 C1) + (1 - K)/(R2 C2)
+//   high-pass (C1, C2 in series, R1 to the output, R2 to ground)
+//     w0/Q = 1/(R2 C1) + 1/(R2 C2) + (1 - K)/(R1 C1)
+// and w0 = 1/sqrt(R1 R2 C1 C2). With equal parts both give Q = 1/(3 - K).
+MonteCarloResult monte_carlo_sallen_key(double r, double c, double ra, double rb, bool high_pass,
+                                        const MetricSpec& f0_spec, const MetricSpec& q_spec,
+                                        const MonteCarloOptions& options) {
+    if (r <= 0 || c <= 0 || ra < 0 || rb <= 0) {
+        return invalid_result();
+    }
+    const double parts[] = { r, r, c, c, ra, rb };
+    const bool is_capacitor[] = { false, false, true, true, false, false };
+    const MetricSpec specs[] = { f0_spec, q_spec, MetricSpec() };
+    return run_trials(6, parts, is_capacitor, 3, specs, options,
+        [high_pass](const double* p, double* metrics) {
+            double r1 = p[0], r2 = p[1], c1 = p[2], c2 = p[3];
+            double gain = 1 + p[4] / p[5];
+            double w0 = 1 / std::sqrt(r1 * r2 * c1 * c2);
+            double damping = high_pass ? 1 / (r2 * c1) + 1 / (r2 * c2) + (1 - gain) / (r1 * c1)
+                                       : 1 / (r1 * c1) + 1 / (r2 * c1) + (1 - gain) / (r2 * c2);
+            metrics[0] = w0 / (2 * PI);
+            metrics[1] = w0 / damping; // negative or infinite once the stage is unstable
+            metrics[2] = gain;
+        });
+}
@@ -0,0 +1,73 @@
+#ifndef TOLERANCE_H
+#define TOLERANCE_H
+
+#include <cmath>
+
+// Monte Carlo tolerance analysis of the RC, op-amp and Sallen-Key designs.
+// Every trial draws each part within its tolerance and re-runs the same formulas as the
+// menus. Random numbers come from a counter-based generator keyed by (seed, trial, draw),
+// and trials are summarised in fixed chunks merged in chunk order, so a given seed gives
+// bit-identical results whatever the number of threads.
+
+enum ToleranceDistribution {
+    UNIFORM_TOLERANCE = 1,  // flat across +/- tolerance
+    GAUSSIAN_TOLERANCE = 2  // tolerance is 3 sigma, truncated at +/- tolerance
+};
+
+struct PartTolerance {
+    double tolerance; // relative, e.g. 0.05 for 5%
+    ToleranceDistribution distribution;
+};
+
+struct MonteCarloOptions {
+    long long trials = 100000;
+    unsigned long long seed = 1;
+    int num_threads = 0; // 0 uses every core
+    PartTolerance resistor = { 0.01, GAUSSIAN_TOLERANCE };
+    PartTolerance capacitor = { 0.10, GAUSSIAN_TOLERANCE };
+};
+
+// Pass window for one output, unlimited by default
+struct MetricSpec {
+    double min = -HUGE_VAL;
+    double max = HUGE_VAL;
+};
+
+// Percentiles come from a histogram of value / nominal - 1 with 0.05% bins over +/- 50%
+struct MetricStats {
+    double nominal;
+    double mean;
+    double stddev;
+    double min;
+    double max;
+    double percentile_1;
+    double median;
+    double percentile_99;
+};
+
+const int MC_MAX_METRICS = 3;
+
+struct MonteCarloResult {
+    int num_metrics; // 0 for invalid inputs
+    MetricStats metrics[MC_MAX_METRICS];
+    long long trials;
+    long long passed; // trials with every metric inside its spec
+    double yield;
+};
+
+// RC filter: metric 0 is the cutoff frequency
+MonteCarloResult monte_carlo_rc(double r, double c, const MetricSpec& cutoff_spec, const MonteCarloOptions& options);
+
+// Op-amps: metric 0 is the gain, metric 1 the output voltage
+MonteCarloResult monte_carlo_inverting(double vin, double feedback_resistor, double input_resistor,
+                                       const MetricSpec& vout_spec, const MonteCarloOptions& options);
+MonteCarloResult monte_carlo_non_inverting(double vin, double feedback_resistor, double ground_resistor,
+                                           const MetricSpec& vout_spec, const MonteCarloOptions& options);
+
+// One equal-component Sallen-Key stage with R1, R2, C1, C2, RA and RB drawn separately:
+// metric 0 is f0, metric 1 is Q and metric 2 the stage gain 1 + RA/RB
+MonteCarloResult monte_carlo_sallen_key(double r, double c, double ra, double rb, bool high_pass,
+                                        const MetricSpec& f0_spec, const MetricSpec& q_spec,
+                                        const MonteCarloOptions& options);
+
+#endif